@@ -0,0 +1,146 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "netstack.hpp"
+
+static constexpr size_t DATAGRAM_SIZE = 64;
+static constexpr size_t BATCH_SIZE = 64;
+static constexpr size_t MEDIA_SIZE = 1200;
+static constexpr size_t SEGMENTS = 40;
+
+static SOCKET BindUdp(netstack::Address& address)
+{
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    address = netstack::Address(netstack::AddressFamily::INET, "127.0.0.1", 0);
+    socklen_t length = sizeof(sockaddr_in);
+
+    netstack::SetOption(handle, netstack::options::RECEIVE_BUFFER, 8 * 1024 * 1024);
+
+    if (bind(handle, address.name(), length) != 0 || getsockname(handle, address.name(), &length) != 0)
+    {
+        std::perror("bind");
+        std::exit(1);
+    }
+
+    return handle;
+}
+
+static void Report(const char* name, const size_t packets, const std::chrono::steady_clock::time_point start)
+{
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("%-18s %10zu packets  %10.0f packets/s\n", name, packets, packets / elapsed.count());
+}
+
+static void BenchmarkSend(const size_t packets)
+{
+    netstack::Address receiverAddress, senderAddress;
+    netstack::Socket receiver(BindUdp(receiverAddress));
+    netstack::Socket sender(BindUdp(senderAddress));
+    const char datagram[DATAGRAM_SIZE] = {};
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; ++i)
+        sender.SendTo(datagram, sizeof(datagram), 0, receiverAddress.name(), receiverAddress.size());
+    Report("send per-packet", packets, start);
+
+    netstack::MessageBatch batch(BATCH_SIZE, DATAGRAM_SIZE);
+    while (batch.Push(datagram, sizeof(datagram), receiverAddress)) {}
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; i += BATCH_SIZE)
+        sender.SendBatch(batch);
+    Report("send batched", packets, start);
+}
+
+// Media sized datagrams, sent one by one, in batches, and as a single buffer the kernel segments.
+static void BenchmarkSegmented(const size_t packets)
+{
+    netstack::Address receiverAddress, senderAddress;
+    netstack::Socket receiver(BindUdp(receiverAddress));
+    netstack::Socket sender(BindUdp(senderAddress));
+    std::vector<char> buffer(MEDIA_SIZE * SEGMENTS);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; ++i)
+        sender.SendTo(buffer.data(), MEDIA_SIZE, 0, receiverAddress.name(), receiverAddress.size());
+    Report("1200B per-packet", packets, start);
+
+    netstack::MessageBatch batch(SEGMENTS, MEDIA_SIZE);
+    while (batch.Push(buffer.data(), MEDIA_SIZE, receiverAddress)) {}
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; i += SEGMENTS)
+        sender.SendBatch(batch);
+    Report("1200B batched", packets, start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; i += SEGMENTS)
+        sender.SendSegmented({ buffer.data(), buffer.size() }, MEDIA_SIZE, &receiverAddress);
+    Report("1200B segmented", packets, start);
+}
+
+template <typename Receiver>
+static void BenchmarkReceive(const char* name, const std::chrono::milliseconds duration, Receiver receive)
+{
+    netstack::Address receiverAddress, senderAddress;
+    netstack::Socket receiver(BindUdp(receiverAddress));
+    std::atomic<bool> running(true);
+
+    std::thread flooder([&]() {
+        netstack::Socket sender(BindUdp(senderAddress));
+        netstack::MessageBatch batch(BATCH_SIZE, DATAGRAM_SIZE);
+        const char datagram[DATAGRAM_SIZE] = {};
+
+        while (batch.Push(datagram, sizeof(datagram), receiverAddress)) {}
+        while (running.load(std::memory_order_relaxed))
+            sender.SendBatch(batch);
+
+        // Unblocks the receiver once it stops.
+        for (int i = 0; i < 16; ++i)
+            sender.SendBatch(batch);
+    });
+
+    size_t packets = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < duration)
+        packets += receive(receiver);
+
+    Report(name, packets, start);
+
+    running = false;
+    flooder.join();
+}
+
+int main(int argc, char** argv)
+{
+    const size_t packets = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::chrono::milliseconds duration(2000);
+
+    nsSetup();
+
+    BenchmarkSend(packets);
+    BenchmarkSegmented(packets / 4);
+
+    BenchmarkReceive("receive per-packet", duration, [](netstack::Socket& socket) {
+        char buffer[DATAGRAM_SIZE];
+        netstack::Address from;
+
+        return socket.ReceiveFrom(buffer, sizeof(buffer), from) > 0 ? 1 : 0;
+    });
+
+    netstack::MessageBatch batch(BATCH_SIZE, DATAGRAM_SIZE);
+    BenchmarkReceive("receive batched", duration, [&batch](netstack::Socket& socket) {
+        const int received = socket.ReceiveBatch(batch);
+
+        return received > 0 ? received : 0;
+    });
+
+    nsCleanup();
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+#include "netstack.hpp"
+#include "harness.hpp"
+
+// One coroutine per connection, echoing in straight-line code.
+static netstack::Task<void> Echo(netstack::AsyncSocket& socket, size_t& messages)
+{
+    char buffer[4096];
+    int received;
+
+    while ((received = co_await socket.AsyncReceive(buffer, sizeof(buffer))) > 0)
+    {
+        co_await socket.AsyncSend(buffer, received);
+        ++messages;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const size_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+    // Each connection uses a client handle, a server handle and its duplicate.
+    const size_t limit = loopback::RaiseFileLimit();
+    if (count * 3 + 32 > limit)
+    {
+        count = (limit - 32) / 3;
+        std::printf("open file limit is %zu, using %zu connections\n", limit, count);
+    }
+
+    nsSetup();
+
+    harness::Connections connections;
+    harness::Open(connections, count);
+
+    netstack::Reactor reactor;
+    std::deque<netstack::AsyncSocket> sockets;
+    size_t messages = 0;
+
+    // The coroutines own duplicates of the server handles, the originals stay with the harness.
+    for (netstack::Socket& server : connections.servers)
+    {
+        sockets.emplace_back(reactor, dup(server.handle()));
+        netstack::Spawn(Echo(sockets.back(), messages));
+    }
+
+    harness::Echo("coroutines", connections, rounds, messages, [&reactor]() { reactor.RunOnce(-1); });
+
+    nsCleanup();
+
+    return 0;
+}
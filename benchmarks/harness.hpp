@@ -0,0 +1,102 @@
+#ifndef BENCHMARKS_HARNESS_HPP
+#define BENCHMARKS_HARNESS_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <string>
+
+#include "netstack.hpp"
+#include "loopback.hpp"
+
+// Shared driver for the event loop benchmarks, so every backend is measured on the same workload.
+namespace harness
+{
+    /**
+     * @brief Both ends of a set of loopback TCP connections.
+     */
+    struct Connections
+    {
+        std::deque<netstack::Socket> clients;
+        std::deque<netstack::Socket> servers;
+    };
+
+    inline double Seconds(const std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    inline long ResidentKilobytes()
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+
+        while (std::getline(status, line))
+            if (line.compare(0, 6, "VmRSS:") == 0)
+                return std::strtol(line.c_str() + 6, nullptr, 10);
+
+        return 0;
+    }
+
+    /**
+     * @brief Opens up to the requested number of connections, limited by the open file limit.
+     */
+    inline void Open(Connections& connections, size_t count)
+    {
+        const size_t limit = loopback::RaiseFileLimit();
+
+        // Both ends of every connection live in this process.
+        if (count * 2 + 32 > limit)
+        {
+            count = (limit - 32) / 2;
+            std::printf("open file limit is %zu, using %zu connections\n", limit, count);
+        }
+
+        netstack::Address address;
+        SOCKET listener = loopback::Listen(address);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            SOCKET client, server;
+            loopback::Connect(listener, address, client, server);
+
+            connections.clients.emplace_back(client);
+            connections.servers.emplace_back(server);
+        }
+
+        nsCloseSocket(listener);
+    }
+
+    /**
+     * @brief Sends one byte on every client per round and polls the server side until all of them are echoed.
+     *
+     * @param {const size_t&} echoed - The number of messages echoed so far, advanced by the backend.
+     * @param {Poll} poll - Waits for and handles the events of the backend.
+     */
+    template <typename Poll>
+    void Echo(const char* name, Connections& connections, const size_t rounds, const size_t& echoed, Poll poll)
+    {
+        const size_t count = connections.clients.size();
+        const size_t start = echoed;
+        char byte = 'x';
+
+        const auto begin = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (netstack::Socket& client : connections.clients)
+                client.Send(&byte, 1);
+
+            while (echoed - start < (round + 1) * count)
+                poll();
+
+            for (netstack::Socket& client : connections.clients)
+                client.Receive(&byte, 1);
+        }
+
+        std::printf("%-24s %10zu connections  %10.0f messages/s\n", name, count, (echoed - start) / Seconds(begin));
+    }
+} // namespace harness
+
+#endif // BENCHMARKS_HARNESS_HPP
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <time.h>
+
+#include "netstack.hpp"
+
+// Opens and resets connections as fast as possible until told to stop.
+static void Connector(const netstack::Address& address, const std::atomic<bool>& running)
+{
+    while (running.load(std::memory_order_relaxed))
+    {
+        netstack::Socket client(netstack::AddressFamily::INET, netstack::SocketType::STREAM, netstack::SocketProtocol::TCP);
+
+        // Closing with a reset keeps the client ports out of TIME_WAIT.
+        client.SetOption(netstack::options::LINGER, linger{ 1, 0 });
+        client.Connect(address);
+    }
+}
+
+static double ThreadSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool Readable(const SOCKET handle)
+{
+    pollfd descriptor = { handle, POLLIN, 0 };
+
+    return poll(&descriptor, 1, 100) == 1;
+}
+
+// Waits for each connection, then accepts it and makes it non-blocking and closed on exec with fcntl.
+static size_t AcceptEach(netstack::TcpListener& listener, const std::atomic<bool>& running)
+{
+    netstack::Socket& socket = listener.socket();
+    socket.SetBlocking(true);
+    size_t accepted = 0;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (!Readable(socket.handle()))
+            continue;
+
+        const SOCKET connection = accept(socket.handle(), nullptr, nullptr);
+        if (!nsIsValidSocket(connection))
+            continue;
+
+        netstack::Socket::SetBlocking(connection, false);
+        fcntl(connection, F_SETFD, FD_CLOEXEC);
+        nsCloseSocket(connection);
+        ++accepted;
+    }
+
+    return accepted;
+}
+
+// Waits for the queue to fill, then drains it with accept4 in batches.
+static size_t AcceptBatches(netstack::TcpListener& listener, const std::atomic<bool>& running)
+{
+    std::vector<netstack::AcceptedConnection> connections;
+    connections.reserve(64);
+    size_t accepted = 0;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (!Readable(listener.socket().handle()))
+            continue;
+
+        accepted += listener.AcceptBatch(connections, 64);
+        connections.clear();
+    }
+
+    return accepted;
+}
+
+static void Run(const char* name, size_t (*acceptor)(netstack::TcpListener&, const std::atomic<bool>&), const size_t clients,
+    const std::chrono::milliseconds duration)
+{
+    netstack::TcpListener listener;
+    if (!listener.Listen(netstack::Address(netstack::AddressFamily::INET, "127.0.0.1", 0)))
+    {
+        std::perror("listen");
+        std::exit(1);
+    }
+
+    std::atomic<bool> accepting(true), connecting(true);
+    size_t accepted = 0;
+    double busy = 0;
+    std::thread server([&]() {
+        const double begin = ThreadSeconds();
+        accepted = acceptor(listener, accepting);
+        busy = ThreadSeconds() - begin;
+    });
+
+    std::vector<std::thread> connectors;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < clients; ++i)
+        connectors.emplace_back(Connector, std::cref(listener.address()), std::cref(connecting));
+
+    std::this_thread::sleep_for(duration);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    accepting = false;
+    server.join();
+
+    connecting = false;
+    listener.Close();
+    for (std::thread& connector : connectors)
+        connector.join();
+
+    // The CPU time of the accepting thread shows the cost per connection even when the clients are the bottleneck.
+    std::printf("%-24s %4zu clients  %10.0f accepts/s  %6.2f us CPU per accept\n", name, clients, accepted / elapsed.count(),
+        busy * 1e6 / accepted);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const size_t clients = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max<size_t>(cores, 4);
+    const std::chrono::milliseconds duration(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000);
+
+    Run("poll, accept, fcntl x2", AcceptEach, clients, duration);
+    Run("poll, accept4 batch", AcceptBatches, clients, duration);
+
+    return 0;
+}
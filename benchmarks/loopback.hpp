@@ -0,0 +1,87 @@
+#ifndef BENCHMARKS_LOOPBACK_HPP
+#define BENCHMARKS_LOOPBACK_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "netstack.hpp"
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+namespace loopback
+{
+    /**
+     * @brief Opens a TCP listener on an ephemeral IPv4 loopback port.
+     */
+    inline SOCKET Listen(netstack::Address& address, const int backlog = SOMAXCONN)
+    {
+        SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        address = netstack::Address(netstack::AddressFamily::INET, "127.0.0.1", 0);
+        socklen_t length = sizeof(sockaddr_in);
+
+        netstack::SetOption(listener, netstack::options::REUSE_ADDRESS, true);
+
+        if (bind(listener, address.name(), length) != 0 || listen(listener, backlog) != 0
+            || getsockname(listener, address.name(), &length) != 0)
+        {
+            std::perror("listen");
+            std::exit(1);
+        }
+
+        return listener;
+    }
+
+    /**
+     * @brief Connects a client to a listener and accepts it, returning both ends of the connection.
+     */
+    inline void Connect(const SOCKET listener, const netstack::Address& address, SOCKET& client, SOCKET& server)
+    {
+        client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (connect(client, address.name(), sizeof(sockaddr_in)) != 0)
+        {
+            std::perror("connect");
+            std::exit(1);
+        }
+
+        server = accept(listener, nullptr, nullptr);
+        if (!nsIsValidSocket(server))
+        {
+            std::perror("accept");
+            std::exit(1);
+        }
+    }
+
+    /**
+     * @brief Connects a single client and server over loopback.
+     */
+    inline void Connect(SOCKET& client, SOCKET& server)
+    {
+        netstack::Address address;
+        SOCKET listener = Listen(address, 1);
+
+        Connect(listener, address, client, server);
+        nsCloseSocket(listener);
+    }
+
+    /**
+     * @brief Raises the open file limit as far as allowed and returns it.
+     */
+    inline size_t RaiseFileLimit()
+    {
+#if defined(_WIN32)
+        return SIZE_MAX;
+#else
+        rlimit limit;
+        getrlimit(RLIMIT_NOFILE, &limit);
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+
+        return limit.rlim_cur;
+#endif
+    }
+} // namespace loopback
+
+#endif // BENCHMARKS_LOOPBACK_HPP
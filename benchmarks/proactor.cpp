@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "netstack.hpp"
+#include "harness.hpp"
+
+static constexpr size_t BUFFER_SIZE = 4096;
+
+// Receives on a connection and sends every chunk back, alternating between the two operations.
+struct EchoOperation : netstack::Operation
+{
+    netstack::Proactor& proactor;
+    netstack::Socket& socket;
+    char* buffer;
+    int bufferIndex;
+    size_t& messages;
+    bool sending = false;
+
+    EchoOperation(netstack::Proactor& proactor, netstack::Socket& socket, char* buffer, const int bufferIndex, size_t& messages) :
+        proactor(proactor), socket(socket), buffer(buffer), bufferIndex(bufferIndex), messages(messages) {}
+
+    void Receive()
+    {
+        sending = false;
+        if (bufferIndex >= 0)
+            proactor.ReceiveFixed(socket, bufferIndex, buffer, BUFFER_SIZE, *this);
+        else
+            proactor.Receive(socket, buffer, BUFFER_SIZE, *this);
+    }
+
+    void OnComplete(const int result) override
+    {
+        if (result <= 0)
+            return;
+
+        if (sending)
+        {
+            ++messages;
+            Receive();
+            return;
+        }
+
+        sending = true;
+        if (bufferIndex >= 0)
+            proactor.SendFixed(socket, bufferIndex, buffer, result, *this);
+        else
+            proactor.Send(socket, buffer, result, *this);
+    }
+};
+
+static void Run(const char* name, harness::Connections& connections, const size_t rounds, const bool allowIoUring, const bool registered)
+{
+    const unsigned count = (unsigned)connections.servers.size();
+    netstack::Proactor proactor(4096, registered ? count : 0, allowIoUring);
+
+    if (allowIoUring && !proactor.UsingIoUring())
+    {
+        std::printf("%-24s io_uring unavailable, skipped\n", name);
+        return;
+    }
+
+    std::vector<char> storage(count * BUFFER_SIZE);
+    if (registered)
+    {
+        netstack::MutableBuffer buffer(storage.data(), storage.size());
+        proactor.RegisterBuffers(&buffer, 1);
+    }
+
+    size_t messages = 0;
+    std::deque<EchoOperation> operations;
+    size_t index = 0;
+
+    for (netstack::Socket& server : connections.servers)
+    {
+        if (registered)
+            proactor.RegisterSocket(server);
+
+        operations.emplace_back(proactor, server, &storage[index++ * BUFFER_SIZE], registered ? 0 : -1, messages);
+        operations.back().Receive();
+    }
+
+    harness::Echo(name, connections, rounds, messages, [&proactor]() { proactor.RunOnce(-1); });
+
+    for (netstack::Socket& server : connections.servers)
+    {
+        server.Shutdown(netstack::ShutdownFlags::RECEIVE);
+        if (registered)
+            proactor.UnregisterSocket(server);
+    }
+
+    // Drains the receives cancelled by the shutdown before the operations go away.
+    while (proactor.size() > 0)
+        proactor.RunOnce(-1);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const size_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+    nsSetup();
+
+    // Each backend gets its own connections, so a shut down server side never leaks into the next run.
+    {
+        harness::Connections connections;
+        harness::Open(connections, count);
+        Run("io_uring", connections, rounds, true, false);
+    }
+    {
+        harness::Connections connections;
+        harness::Open(connections, count);
+        Run("io_uring registered", connections, rounds, true, true);
+    }
+    {
+        harness::Connections connections;
+        harness::Open(connections, count);
+        Run("fallback reactor", connections, rounds, false, false);
+    }
+
+    nsCleanup();
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "netstack.hpp"
+#include "harness.hpp"
+
+// Echoes everything received back to the sender.
+struct EchoHandler : netstack::Handler
+{
+    size_t messages = 0;
+    char buffer[4096];
+
+    void OnReadable(netstack::Socket& socket) override
+    {
+        int received;
+        while ((received = socket.Receive(buffer, sizeof(buffer))) > 0)
+        {
+            socket.Send(buffer, received);
+            ++messages;
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const size_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+    nsSetup();
+
+    harness::Connections connections;
+    harness::Open(connections, count);
+
+    netstack::Reactor reactor;
+    EchoHandler handler;
+
+    const long residentBefore = harness::ResidentKilobytes();
+    auto start = std::chrono::steady_clock::now();
+    for (netstack::Socket& server : connections.servers)
+    {
+        server.SetBlocking(false);
+        reactor.Add(server, handler, netstack::Interest::READ, netstack::Trigger::EDGE);
+    }
+    const double registration = harness::Seconds(start);
+    const long residentAfter = harness::ResidentKilobytes();
+
+    std::printf("register           %10.2f us/connection\n", registration * 1e6 / reactor.size());
+    std::printf("reactor memory     %10.1f bytes/connection\n", (residentAfter - residentBefore) * 1024.0 / reactor.size());
+
+    const int polls = 1000;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < polls; ++i)
+        reactor.RunOnce(0);
+    std::printf("idle poll          %10.2f us\n", harness::Seconds(start) * 1e6 / polls);
+
+    harness::Echo("epoll edge triggered", connections, rounds, handler.messages, [&reactor]() { reactor.RunOnce(-1); });
+
+    nsCleanup();
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "netstack.hpp"
+#include "loopback.hpp"
+
+#if defined(NETSTACK_COUNT_SYSCALLS)
+// Linked with -Wl,--wrap=recv so that every recv() issued by this binary is counted.
+static size_t recvCalls = 0;
+
+extern "C" ssize_t __real_recv(int socket, void* buffer, size_t length, int flags);
+
+extern "C" ssize_t __wrap_recv(int socket, void* buffer, size_t length, int flags)
+{
+    ++recvCalls;
+    return __real_recv(socket, buffer, length, flags);
+}
+#endif
+
+// The receive loop Socket::Receive(std::string&) used before it read into the string's spare capacity.
+static int LegacyReceive(netstack::Socket& socket, std::string& buffer)
+{
+    std::vector<char> what(CHAR_MAX);
+    int received = 0;
+    do
+    {
+        received = socket.Receive(&what[0], what.size(), 0);
+
+        buffer.append(what.cbegin(), what.cend());
+    } while (received == CHAR_MAX);
+
+    return received;
+}
+
+template <typename Receiver>
+static void Run(const char* name, const size_t megabytes, Receiver receive)
+{
+    SOCKET client, server;
+    loopback::Connect(client, server);
+
+    std::thread writer([client, megabytes]() {
+        netstack::Socket socket(client);
+        const std::string block(64 * 1024, 'x');
+
+        for (size_t sent = 0; sent < megabytes * 1024 * 1024; sent += block.size())
+            socket.Send(block);
+    });
+
+    netstack::Socket socket(server);
+    std::string buffer;
+    size_t calls = 0;
+
+#if defined(NETSTACK_COUNT_SYSCALLS)
+    recvCalls = 0;
+#endif
+    const auto start = std::chrono::steady_clock::now();
+
+    for (;;)
+    {
+        buffer.clear();
+        const int received = receive(socket, buffer);
+        ++calls;
+
+        if (received <= 0)
+            break;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    writer.join();
+
+    std::printf("%-8s %6zu MB  %10.1f MB/s  %10.1f calls/MB", name, megabytes, megabytes / elapsed.count(), (double)calls / megabytes);
+#if defined(NETSTACK_COUNT_SYSCALLS)
+    std::printf("  %10.1f recv/MB", (double)recvCalls / megabytes);
+#endif
+    std::printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+
+    nsSetup();
+
+    Run("legacy", megabytes, LegacyReceive);
+    Run("growable", megabytes, [](netstack::Socket& socket, std::string& buffer) { return socket.Receive(buffer); });
+
+    nsCleanup();
+
+    return 0;
+}
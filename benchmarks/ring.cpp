@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "netstack.hpp"
+#include "loopback.hpp"
+
+// Measures the round trip of a message between two threads over a shared memory ring against the socket paths.
+template <typename Transport>
+static void Echo(Transport& transport, const size_t size, const size_t rounds)
+{
+    std::vector<char> buffer(size);
+
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        size_t received = 0;
+        while (received < size)
+            received += (size_t)transport.Receive(buffer.data() + received, (int)(size - received));
+
+        transport.Send(buffer.data(), (int)size);
+    }
+}
+
+template <typename Transport>
+static void PingPong(const char* name, Transport& client, Transport& server, const size_t size, const size_t rounds)
+{
+    std::thread echo([&]() { Echo(server, size, rounds); });
+    std::vector<char> buffer(size, 'x');
+    std::vector<double> latencies;
+    latencies.reserve(rounds);
+
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        client.Send(buffer.data(), (int)size);
+
+        size_t received = 0;
+        while (received < size)
+            received += (size_t)client.Receive(buffer.data() + received, (int)(size - received));
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    echo.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (const double latency : latencies)
+        total += latency;
+
+    std::printf("%-22s %5zu B  mean %6.2f us  p50 %6.2f us  p99 %6.2f us\n", name, size, total / rounds,
+        latencies[rounds / 2], latencies[rounds * 99 / 100]);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    for (const size_t size : { (size_t)64, (size_t)4096 })
+    {
+        {
+            SOCKET first, second;
+            loopback::Connect(first, second);
+            netstack::SetOption(first, netstack::options::NO_DELAY, true);
+            netstack::SetOption(second, netstack::options::NO_DELAY, true);
+            netstack::Socket client(first), server(second);
+
+            PingPong("TCP loopback", client, server, size, rounds);
+        }
+
+        {
+            netstack::Socket client, server;
+            netstack::Socket::Pair(netstack::SocketType::STREAM, client, server);
+
+            PingPong("UNIX stream pair", client, server, size, rounds);
+        }
+
+        {
+            netstack::Socket a, b;
+            netstack::Socket::Pair(netstack::SocketType::STREAM, a, b);
+            netstack::RingSocket client = netstack::RingSocket::Offer(a);
+            netstack::RingSocket server = netstack::RingSocket::Accept(b);
+
+            PingPong("Ring", client, server, size, rounds);
+        }
+
+        {
+            // Sleeping at once shows the cost of the futex wakeups alone.
+            netstack::Socket a, b;
+            netstack::Socket::Pair(netstack::SocketType::STREAM, a, b);
+            netstack::RingSocket client = netstack::RingSocket::Offer(a);
+            netstack::RingSocket server = netstack::RingSocket::Accept(b);
+            client.SetSpin(0);
+            server.SetSpin(0);
+
+            PingPong("Ring without spinning", client, server, size, rounds);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+
+#include "netstack.hpp"
+#include "loopback.hpp"
+
+// Serves a large file over loopback by reading it into a string and sending it, by SendFile, and forwards it
+// between two connections by Receive and Send or by Splice. The file is created once and read from the page cache.
+static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+
+static void Report(const char* name, const size_t bytes, const std::chrono::steady_clock::time_point start)
+{
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("%-14s %8.2f GiB  %8.2f GiB/s\n", name, bytes / (double)(1 << 30), bytes / elapsed.count() / (1 << 30));
+}
+
+// Drains a connection until its end, returning the bytes received.
+static std::thread Drain(SOCKET socket, size_t& received)
+{
+    return std::thread([socket, &received]() {
+        std::vector<char> buffer(CHUNK_SIZE);
+        int status;
+        while ((status = recv(socket, buffer.data(), buffer.size(), 0)) > 0)
+            received += status;
+    });
+}
+
+template <typename Transfer>
+static void Benchmark(const char* name, const size_t size, Transfer transfer)
+{
+    SOCKET client, server;
+    loopback::Connect(client, server);
+
+    size_t received = 0;
+    netstack::Socket sender(server);
+    std::thread drain = Drain(client, received);
+
+    const auto start = std::chrono::steady_clock::now();
+    transfer(sender);
+    sender.Shutdown(netstack::ShutdownFlags::SEND);
+    drain.join();
+    Report(name, received, start);
+
+    if (received != size)
+        std::printf("%-14s received %zu of %zu bytes\n", name, received, size);
+
+    nsCloseSocket(client);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t size = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2048) * 1024 * 1024;
+    char path[] = "/tmp/netstack-bench-sendfile-XXXXXX";
+
+    nsSetup();
+
+    const int file = mkstemp(path);
+    if (file < 0)
+    {
+        std::perror("mkstemp");
+        return 1;
+    }
+    unlink(path);
+
+    const std::string chunk(CHUNK_SIZE, 'f');
+    for (size_t written = 0; written < size; written += chunk.size())
+        if (write(file, chunk.data(), std::min(chunk.size(), size - written)) < 0)
+        {
+            std::perror("write");
+            return 1;
+        }
+
+    Benchmark("read + Send", size, [&](netstack::Socket& socket) {
+        std::string buffer;
+        int64_t offset = 0;
+        while (offset < (int64_t)size)
+        {
+            buffer.resize(std::min(CHUNK_SIZE, size - (size_t)offset));
+            const ssize_t status = pread(file, &buffer[0], buffer.size(), offset);
+            if (status <= 0)
+                break;
+
+            buffer.resize(status);
+            if (socket.Send(buffer) != status)
+                break;
+
+            offset += status;
+        }
+    });
+
+    Benchmark("SendFile", size, [&](netstack::Socket& socket) {
+        int64_t offset = 0;
+        socket.SendFile(file, offset, size);
+    });
+
+    // Forwarding: a producer sends the file into one connection, the proxy moves it to the drained one.
+    auto forward = [&](const char* name, auto move) {
+        Benchmark(name, size, [&](netstack::Socket& out) {
+            SOCKET producer, proxy;
+            loopback::Connect(producer, proxy);
+            netstack::Socket in(proxy);
+
+            std::thread produce([&]() {
+                netstack::Socket socket(producer);
+                int64_t offset = 0;
+                socket.SendFile(file, offset, size);
+            });
+
+            move(in, out);
+            produce.join();
+        });
+    };
+
+    forward("Receive + Send", [](netstack::Socket& in, netstack::Socket& out) {
+        std::vector<char> buffer(CHUNK_SIZE);
+        int status;
+        while ((status = in.Receive(buffer.data(), (int)buffer.size(), 0)) > 0)
+            if (out.Send(buffer.data(), status, 0) != status)
+                break;
+    });
+
+    forward("Splice", [](netstack::Socket& in, netstack::Socket& out) {
+        netstack::SplicePipe pipe(CHUNK_SIZE);
+        while (in.Splice(out, pipe, SIZE_MAX) > 0) {}
+    });
+
+    close(file);
+    nsCleanup();
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "netstack.hpp"
+
+// Opens and resets connections as fast as possible until told to stop.
+static void Connector(const netstack::Address& address, const std::atomic<bool>& running, std::atomic<size_t>& connected)
+{
+    size_t count = 0;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        netstack::Socket client(netstack::AddressFamily::INET, netstack::SocketType::STREAM, netstack::SocketProtocol::TCP);
+
+        // Closing with a reset keeps the client ports out of TIME_WAIT.
+        client.SetOption(netstack::options::LINGER, linger{ 1, 0 });
+
+        if (client.Connect(address))
+            ++count;
+    }
+
+    connected += count;
+}
+
+static void Run(const size_t shards, const size_t clients, const std::chrono::milliseconds duration)
+{
+    netstack::ShardedServer server(shards);
+
+    const bool started = server.Start(netstack::Address(netstack::AddressFamily::INET, "127.0.0.1", 0),
+        [](netstack::Shard&, netstack::Socket, const netstack::Address&) {});
+
+    if (!started)
+    {
+        std::perror("start");
+        std::exit(1);
+    }
+
+    std::atomic<bool> running(true);
+    std::atomic<size_t> connected(0);
+    std::vector<std::thread> connectors;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < clients; ++i)
+        connectors.emplace_back(Connector, std::cref(server.address()), std::cref(running), std::ref(connected));
+
+    std::this_thread::sleep_for(duration);
+    running = false;
+
+    for (std::thread& connector : connectors)
+        connector.join();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const uint64_t accepted = server.accepted();
+    server.Stop();
+
+    std::printf("%4zu shards  %4zu clients  %10.0f connections/s  %10.0f accepts/s\n",
+        shards, clients, connected / elapsed.count(), accepted / elapsed.count());
+}
+
+int main(int argc, char** argv)
+{
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const size_t maxShards = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max<size_t>(cores, 4);
+    const size_t clients = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : cores;
+    const std::chrono::milliseconds duration(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2000);
+
+    nsSetup();
+
+    for (size_t shards = 1; shards <= maxShards; shards *= 2)
+        Run(shards, clients, duration);
+
+    nsCleanup();
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "netstack.hpp"
+#include "harness.hpp"
+
+// Maps a million UDP peers to their session state, the way a server does on every ReceiveFrom.
+struct Session
+{
+    uint64_t packets;
+    uint64_t bytes;
+};
+
+static void Report(const char* name, const char* phase, const size_t operations, const std::chrono::steady_clock::time_point start)
+{
+    const double seconds = harness::Seconds(start);
+
+    std::printf("%-24s %-7s %8.1f ns/op %8.2f M ops/s\n", name, phase, seconds * 1e9 / operations, operations / seconds / 1e6);
+}
+
+static void ReportMemory(const char* name, const long before, const size_t count)
+{
+    std::printf("%-24s %.1f resident bytes/peer\n", name, (harness::ResidentKilobytes() - before) * 1024.0 / count);
+}
+
+// The string key is formatted from the address as it would be from each received datagram.
+static std::string Format(const netstack::CompactAddress& peer)
+{
+    char text[INET6_ADDRSTRLEN + 8];
+    inet_ntop(peer.family(), peer.bytes(), text, sizeof(text));
+
+    return std::string(text) + ":" + std::to_string(peer.port());
+}
+
+static netstack::CompactAddress RandomPeer(std::mt19937_64& random)
+{
+    sockaddr_in6 address = {};
+    address.sin6_family = AF_INET6;
+    address.sin6_port = htons((uint16_t)random());
+    for (size_t i = 0; i < 16; i += 8)
+    {
+        const uint64_t bits = random();
+        std::memcpy(&address.sin6_addr.s6_addr[i], &bits, 8);
+    }
+
+    return netstack::CompactAddress((const sockaddr*)&address);
+}
+
+template <typename Lookup>
+static uint64_t Run(const char* name, const std::vector<netstack::CompactAddress>& order, Lookup lookup)
+{
+    uint64_t found = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const netstack::CompactAddress& peer : order)
+        found += lookup(peer);
+    Report(name, "lookup", order.size(), start);
+
+    return found;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const size_t lookups = count * 4;
+
+    std::mt19937_64 random(42);
+    std::vector<netstack::CompactAddress> peers;
+    peers.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        peers.push_back(RandomPeer(random));
+
+    // Lookups hit known peers in random order, with one in eight from a stranger.
+    std::vector<netstack::CompactAddress> order;
+    order.reserve(lookups);
+    for (size_t i = 0; i < lookups; ++i)
+        order.push_back(i % 8 == 0 ? RandomPeer(random) : peers[random() % count]);
+
+    uint64_t checksum = 0;
+    {
+        const long before = harness::ResidentKilobytes();
+        netstack::SessionTable<Session> table;
+
+        auto start = std::chrono::steady_clock::now();
+        for (const netstack::CompactAddress& peer : peers)
+            table.Emplace(peer, 0, Session{ 0, 0 });
+        Report("SessionTable", "insert", count, start);
+        ReportMemory("SessionTable", before, count);
+
+        checksum += Run("SessionTable", order, [&table](const netstack::CompactAddress& peer) {
+            Session* session = table.Find(peer, 1);
+            if (session == nullptr)
+                return 0;
+
+            ++session->packets;
+            return 1;
+        });
+    }
+
+    {
+        const long before = harness::ResidentKilobytes();
+        std::unordered_map<netstack::CompactAddress, Session> map;
+
+        auto start = std::chrono::steady_clock::now();
+        for (const netstack::CompactAddress& peer : peers)
+            map.emplace(peer, Session{ 0, 0 });
+        Report("unordered_map<Compact>", "insert", count, start);
+        ReportMemory("unordered_map<Compact>", before, count);
+
+        checksum += Run("unordered_map<Compact>", order, [&map](const netstack::CompactAddress& peer) {
+            auto found = map.find(peer);
+            if (found == map.end())
+                return 0;
+
+            ++found->second.packets;
+            return 1;
+        });
+    }
+
+    {
+        const long before = harness::ResidentKilobytes();
+        std::unordered_map<std::string, Session> map;
+
+        auto start = std::chrono::steady_clock::now();
+        for (const netstack::CompactAddress& peer : peers)
+            map.emplace(Format(peer), Session{ 0, 0 });
+        Report("unordered_map<string>", "insert", count, start);
+        ReportMemory("unordered_map<string>", before, count);
+
+        checksum += Run("unordered_map<string>", order, [&map](const netstack::CompactAddress& peer) {
+            auto found = map.find(Format(peer));
+            if (found == map.end())
+                return 0;
+
+            ++found->second.packets;
+            return 1;
+        });
+    }
+
+    std::printf("%llu hits\n", (unsigned long long)checksum);
+
+    return 0;
+}
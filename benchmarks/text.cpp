@@ -0,0 +1,84 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "netstack.hpp"
+
+// Parses and formats a mix of IPv4 and IPv6 addresses, as a server does when it logs or keys on peer addresses.
+static void Report(const char* name, const size_t operations, const std::chrono::steady_clock::time_point start)
+{
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-22s %8.1f ns/op %8.2f M ops/s\n", name, seconds * 1e9 / operations, operations / seconds / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // Half IPv4, half IPv6 with the zero runs real addresses tend to have.
+    std::mt19937_64 random(42);
+    std::vector<std::vector<uint8_t>> binary;
+    std::vector<std::string> texts;
+    binary.reserve(count);
+    texts.reserve(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int family = i % 2 == 0 ? AF_INET : AF_INET6;
+        std::vector<uint8_t> bytes(family == AF_INET ? 4 : 16);
+
+        for (size_t j = 0; j < bytes.size(); ++j)
+            bytes[j] = family == AF_INET || j < 4 || j >= 10 ? (uint8_t)random() : 0;
+
+        char text[INET6_ADDRSTRLEN];
+        inet_ntop(family, bytes.data(), text, sizeof(text));
+        binary.push_back(std::move(bytes));
+        texts.emplace_back(text);
+    }
+
+    uint64_t checksum = 0;
+    uint8_t bytes[16];
+    char text[INET6_ADDRSTRLEN];
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& address : texts)
+    {
+        const int family = address.find(':') == std::string::npos ? AF_INET : AF_INET6;
+        checksum += inet_pton(family, address.c_str(), bytes) + bytes[3];
+    }
+    Report("inet_pton", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (const std::string& address : texts)
+    {
+        const bool parsed = netstack::ParseIPv4(address.data(), address.size(), bytes) || netstack::ParseIPv6(address.data(), address.size(), bytes);
+        checksum += parsed + bytes[3];
+    }
+    Report("ParseIPv4/ParseIPv6", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (const std::vector<uint8_t>& address : binary)
+    {
+        inet_ntop(address.size() == 4 ? AF_INET : AF_INET6, address.data(), text, sizeof(text));
+        checksum += (uint8_t)text[1];
+    }
+    Report("inet_ntop", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (const std::vector<uint8_t>& address : binary)
+    {
+        const size_t length = address.size() == 4 ? netstack::FormatIPv4(address.data(), text) : netstack::FormatIPv6(address.data(), text);
+        checksum += length + (uint8_t)text[1];
+    }
+    Report("FormatIPv4/FormatIPv6", count, start);
+
+    std::printf("checksum %llu\n", (unsigned long long)checksum);
+
+    return 0;
+}
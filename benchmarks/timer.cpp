@@ -0,0 +1,111 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "netstack.hpp"
+#include "harness.hpp"
+
+// Times a million connection timeouts on the wheel, against an ordered map as the usual alternative.
+struct CountingTimer : netstack::Timer
+{
+    static size_t expired;
+
+    void OnExpire() override { ++expired; }
+};
+
+size_t CountingTimer::expired = 0;
+
+static void Report(const char* name, const char* phase, const size_t operations, const std::chrono::steady_clock::time_point start)
+{
+    const double seconds = harness::Seconds(start);
+
+    std::printf("%-6s %-8s %10.1f ns/timer\n", name, phase, seconds * 1e9 / operations);
+}
+
+// Every timer is armed once, touched by two rounds of activity as an idle timeout would be, then expired.
+static void BenchmarkWheel(const std::vector<uint64_t>& delays)
+{
+    const size_t count = delays.size();
+    const long before = harness::ResidentKilobytes();
+
+    netstack::TimerWheel wheel;
+    std::unique_ptr<CountingTimer[]> timers(new CountingTimer[count]);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+        wheel.Schedule(timers[i], delays[i]);
+    Report("wheel", "arm", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t now = 1; now <= 2; ++now)
+        for (size_t i = 0; i < count; ++i)
+            wheel.Schedule(timers[i], now * 1000 + delays[i]);
+    Report("wheel", "re-arm", count * 2, start);
+
+    const long resident = harness::ResidentKilobytes() - before;
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t now = 0; wheel.size() != 0; now += 1)
+        wheel.Advance(now);
+    Report("wheel", "expire", count, start);
+
+    std::printf("wheel  %zu expired, %zu bytes/timer, %.1f resident bytes/timer\n",
+        CountingTimer::expired, sizeof(CountingTimer), resident * 1024.0 / count);
+}
+
+static void BenchmarkMap(const std::vector<uint64_t>& delays)
+{
+    const size_t count = delays.size();
+    const long before = harness::ResidentKilobytes();
+
+    std::multimap<uint64_t, size_t> timers;
+    std::vector<std::multimap<uint64_t, size_t>::iterator> handles(count);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+        handles[i] = timers.emplace(delays[i], i);
+    Report("map", "arm", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t now = 1; now <= 2; ++now)
+        for (size_t i = 0; i < count; ++i)
+        {
+            timers.erase(handles[i]);
+            handles[i] = timers.emplace(now * 1000 + delays[i], i);
+        }
+    Report("map", "re-arm", count * 2, start);
+
+    const long resident = harness::ResidentKilobytes() - before;
+
+    size_t expired = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t now = 0; !timers.empty(); now += 1)
+        while (!timers.empty() && timers.begin()->first <= now)
+        {
+            timers.erase(timers.begin());
+            ++expired;
+        }
+    Report("map", "expire", count, start);
+
+    std::printf("map    %zu expired, %.1f resident bytes/timer\n", expired, resident * 1024.0 / count);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // Timeouts of up to a minute in milliseconds, stepping the clock one millisecond at a time.
+    std::mt19937_64 random(1);
+    std::vector<uint64_t> delays(count);
+    for (uint64_t& delay : delays)
+        delay = random() % 60000;
+
+    BenchmarkWheel(delays);
+    BenchmarkMap(delays);
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "netstack.hpp"
+#include "loopback.hpp"
+
+// Measures the round trip of a small message between two threads over each kind of same-host transport.
+static void Echo(const SOCKET handle, const size_t size, const size_t rounds)
+{
+    std::vector<char> buffer(size);
+
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        size_t received = 0;
+        while (received < size)
+            received += (size_t)recv(handle, buffer.data() + received, size - received, 0);
+
+        send(handle, buffer.data(), size, 0);
+    }
+}
+
+static void PingPong(const char* name, const SOCKET client, const SOCKET server, const size_t size, const size_t rounds)
+{
+    std::thread echo(Echo, server, size, rounds);
+    std::vector<char> buffer(size, 'x');
+    std::vector<double> latencies;
+    latencies.reserve(rounds);
+
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        send(client, buffer.data(), size, 0);
+
+        size_t received = 0;
+        while (received < size)
+            received += (size_t)recv(client, buffer.data() + received, size - received, 0);
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    echo.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (const double latency : latencies)
+        total += latency;
+
+    std::printf("%-22s %5zu B  mean %6.2f us  p50 %6.2f us  p99 %6.2f us\n", name, size, total / rounds,
+        latencies[rounds / 2], latencies[rounds * 99 / 100]);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    for (const size_t size : { (size_t)64, (size_t)4096 })
+    {
+        {
+            SOCKET client, server;
+            loopback::Connect(client, server);
+            netstack::SetOption(client, netstack::options::NO_DELAY, true);
+            netstack::SetOption(server, netstack::options::NO_DELAY, true);
+
+            PingPong("TCP loopback", client, server, size, rounds);
+            nsCloseSocket(client);
+            nsCloseSocket(server);
+        }
+
+        {
+            netstack::Socket client, server;
+            netstack::Socket::Pair(netstack::SocketType::STREAM, client, server);
+
+            PingPong("UNIX stream pair", client.handle(), server.handle(), size, rounds);
+        }
+
+        {
+            netstack::Socket client, server;
+            netstack::Socket::Pair(netstack::SocketType::DATAGRAM, client, server);
+
+            PingPong("UNIX datagram pair", client.handle(), server.handle(), size, rounds);
+        }
+
+        {
+            // A named socket in the abstract namespace, as a sidecar would connect to.
+            const netstack::Address address(netstack::AddressFamily::UNIX, "@netstack-bench-unix", 0);
+            netstack::Socket listener(netstack::AddressFamily::UNIX, netstack::SocketType::STREAM, netstack::SocketProtocol::DEFAULT);
+            listener.Bind(address);
+            listener.Listen();
+
+            const SOCKET client = socket(AF_UNIX, SOCK_STREAM, 0);
+            connect(client, address.name(), address.size());
+            const netstack::Socket server = listener.Accept();
+
+            PingPong("UNIX stream abstract", client, server.handle(), size, rounds);
+            nsCloseSocket(client);
+        }
+    }
+
+    return 0;
+}
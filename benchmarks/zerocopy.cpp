@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+#include "netstack.hpp"
+#include "loopback.hpp"
+
+// Compares copying and zero-copy sends of large replication-sized writes. Over loopback the kernel copies the
+// data either way, so the zero-copy numbers only show its bookkeeping; point it at a remote sink for the real gain.
+static constexpr size_t WRITE_SIZE = 64 * 1024;
+static constexpr size_t IN_FLIGHT = 32;
+
+struct Slot : netstack::ZeroCopyCompletion
+{
+    std::vector<char> data = std::vector<char>(WRITE_SIZE, 'r');
+    bool busy = false;
+    bool copied = false;
+
+    void OnComplete(const bool wasCopied) override
+    {
+        busy = false;
+        copied = wasCopied;
+    }
+};
+
+static double ThreadCpuSeconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void Report(const char* name, const size_t bytes, const double seconds, const double cpu)
+{
+    std::printf("%-10s %8.2f GiB/s  %6.1f%% sender CPU  %6.2f CPU s/GiB\n",
+        name, bytes / seconds / (1 << 30), cpu / seconds * 100, cpu / (bytes / (double)(1 << 30)));
+}
+
+template <typename Send>
+static void Benchmark(const char* name, const netstack::Address& address, const std::chrono::milliseconds duration, Send send)
+{
+    netstack::ZeroCopySocket sender(netstack::AddressFamily::INET, netstack::SocketType::STREAM, netstack::SocketProtocol::TCP, WRITE_SIZE);
+    if (!sender.Connect(address))
+    {
+        std::perror("connect");
+        std::exit(1);
+    }
+
+    std::vector<Slot> slots(IN_FLIGHT);
+    size_t bytes = 0;
+
+    const double cpuStart = ThreadCpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; std::chrono::steady_clock::now() - start < duration; ++i)
+    {
+        Slot& slot = slots[i % IN_FLIGHT];
+
+        // A slot is only written again once the kernel has released it.
+        while (slot.busy)
+            if (sender.Reap() == 0)
+                sender.Flush(1);
+
+        slot.busy = true;
+        const int sent = send(sender, slot);
+        if (sent <= 0)
+            break;
+
+        bytes += sent;
+    }
+
+    sender.Flush(1000);
+    Report(name, bytes, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), ThreadCpuSeconds() - cpuStart);
+}
+
+int main(int argc, char** argv)
+{
+    const std::chrono::milliseconds duration(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000);
+
+    nsSetup();
+
+    netstack::Address address;
+    const SOCKET listener = loopback::Listen(address);
+
+    // Drains every connection the benchmarks open, one after another.
+    std::thread sink([listener]() {
+        std::vector<char> buffer(1024 * 1024);
+        for (int i = 0; i < 2; ++i)
+        {
+            netstack::Socket connection(accept(listener, nullptr, nullptr));
+            while (connection.Receive(buffer.data(), (int)buffer.size(), 0) > 0) {}
+        }
+    });
+
+    Benchmark("copy", address, duration, [](netstack::ZeroCopySocket& socket, Slot& slot) {
+        slot.busy = false;
+
+        return socket.Send(slot.data.data(), (int)slot.data.size(), 0);
+    });
+
+    Benchmark("zero-copy", address, duration, [](netstack::ZeroCopySocket& socket, Slot& slot) {
+        return socket.SendZeroCopy(netstack::ConstBuffer(slot.data.data(), slot.data.size()), slot);
+    });
+
+    sink.join();
+    nsCloseSocket(listener);
+    nsCleanup();
+
+    return 0;
+}
@@ -1,7 +1,26 @@
 #ifndef CPP_ADDRESS_HPP
 #define CPP_ADDRESS_HPP
 
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <type_traits>
+
 #include "netstack.h"
+#include "text.hpp"
+
+#if defined(_WIN32)
+#include <afunix.h>
+#else
+#include <sys/un.h>
+#endif
+
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+#include <compare>
+#endif
 
 namespace netstack
 {
@@ -10,8 +29,8 @@ namespace netstack
 	 */
 	enum class AddressFamily
 	{
-		// UNSPEC = AF_UNSPEC,			///< Unspecified.
-		// UNIX = AF_UNIX,				///< local to host (pipes, portals).
+		UNSPEC = AF_UNSPEC,			///< Unspecified, for lookups that accept any family.
+		UNIX = AF_UNIX,				///< local to host (pipes, portals), addressed by a path.
 		INET = AF_INET,				///< internetwork addresses also known as IPv4, typically used with TCP or UPD protocalls.
 		// IMPLINK = AF_IMPLINK,		///< 
 		// PUP = AF_PUP,				///< 
@@ -40,6 +59,9 @@ namespace netstack
 		// IRDA = AF_IRDA,				///< 
 		// NETDES = AF_NETDES,			///< 
 		// MAX = AF_MAX				///< 
+#if defined(__linux__)
+		PACKET = AF_PACKET,			///< link layer packets, as seen by a CaptureSocket.
+#endif
 	};
 
 	/**
@@ -49,6 +71,7 @@ namespace netstack
 	 */
 	class Address 
 	{
+		friend class Socket;
 	private:
         bool state_;
 		sockaddr_storage address_;	///< The socket address.
@@ -58,13 +81,17 @@ namespace netstack
 		/**
 		 * @brief Constructs an address. Which represents the destination or source of a socket.
 		 *
-		 * @param {const AddressFamily} family - The address family to use for the socket (e.g. INET, INET6).
-		 * @param {const char*} ip - The IP address to use (e.g. "127.0.0.1")
+		 * For UNIX addresses the ip is the path of the socket and the port is ignored. On Linux a path starting with
+		 * '@' names a socket in the abstract namespace, which has no file and vanishes with the last socket using it.
+		 *
+		 * @param {const AddressFamily} family - The address family to use for the socket (e.g. INET, INET6, UNIX).
+		 * @param {const char*} ip - The IP address to use (e.g. "127.0.0.1"), or the path of a UNIX socket.
 		 * @param {const unsigned short} port - The port number to use (e.g 8080, 3000)
 		 */
 		Address(const AddressFamily family, const char* ip, const unsigned short port) : state_(true)
 		{
 			address_ = {};
+			length_ = sizeof(address_);
 			sockaddr* sockAddr = (sockaddr*)&address_;
 			sockAddr->sa_family = (int)family;
 
@@ -73,28 +100,54 @@ namespace netstack
 			case AddressFamily::INET:
 			{
 				sockaddr_in* sin = (sockaddr_in*)sockAddr;
-				const int status = inet_pton(sockAddr->sa_family, ip, &sin->sin_addr);
 				
-				if (status == 0 || status == -1) {
+				if (!ParseIPv4(ip, std::strlen(ip), (uint8_t*)&sin->sin_addr)) {
                     state_ = false;
                     break;
                 }
 				
 				sin->sin_port = htons(port);
+				length_ = sizeof(sockaddr_in);
 				break;
 			}
 
 			case AddressFamily::INET6:
 			{
 				sockaddr_in6* sin6 = (struct sockaddr_in6*)sockAddr;
-				const int status =  inet_pton(sockAddr->sa_family, ip, &sin6->sin6_addr);
 				
-				if (status == 0 || status == -1) {
+				if (!ParseIPv6(ip, std::strlen(ip), (uint8_t*)&sin6->sin6_addr)) {
                     state_ = false;
                     break;
                 }
 
 				sin6->sin6_port = htons(port);
+				length_ = sizeof(sockaddr_in6);
+				break;
+			}
+
+			case AddressFamily::UNIX:
+			{
+				sockaddr_un* sun = (sockaddr_un*)sockAddr;
+				const size_t length = std::strlen(ip);
+				const bool abstract = ip[0] == '@';
+
+#if !defined(__linux__)
+				if (abstract) {
+                    state_ = false;
+                    break;
+                }
+#endif
+				// Filesystem paths keep their terminating null, abstract names are counted by length alone.
+				if (length == 0 || length >= sizeof(sun->sun_path)) {
+                    state_ = false;
+                    break;
+                }
+
+				std::memcpy(sun->sun_path, ip, length);
+				if (abstract)
+					sun->sun_path[0] = '\0';
+
+				length_ = (socklen_t)(offsetof(sockaddr_un, sun_path) + length + (abstract ? 0 : 1));
 				break;
 			}
 
@@ -102,14 +155,27 @@ namespace netstack
 				state_ = false;
 				break;
 			}
+		}
 
-			length_ = sizeof(address_);
+		/**
+		 * @brief Constructs an address from a socket address, such as one returned by getaddrinfo or getpeername.
+		 *
+		 * @param {const sockaddr*} address - The socket address to copy.
+		 * @param {socklen_t} length - The length of the socket address.
+		 */
+		Address(const sockaddr* address, const socklen_t length) : state_(length > 0 && length <= sizeof(address_))
+		{
+			address_ = {};
+			length_ = state_ ? length : 0;
+
+			if (state_)
+				std::memcpy(&address_, address, length);
 		}
 
 		/**
 		 * @brief Constructs an empty address object, use the parameterized constructor to make useable addresses.
 		 */
-		Address()
+		Address() : state_(false)
 		{
 			address_ = {};
 			length_ = {};
@@ -180,12 +246,458 @@ namespace netstack
 			return length_;
 		}
 
-		// TODO
-		void GetAddressInfo()
+		/**
+		 * @brief Returns the path of a UNIX address, with a leading '@' for the abstract namespace.
+		 *
+		 * @return {std::string} The path, empty for other families and for unnamed sockets such as those of a socket pair.
+		 */
+		std::string path() const
+		{
+			const size_t offset = offsetof(sockaddr_un, sun_path);
+			if (address_.ss_family != AF_UNIX || length_ <= offset)
+				return std::string();
+
+			const sockaddr_un* sun = (const sockaddr_un*)&address_;
+			const size_t length = length_ - offset;
+
+			if (sun->sun_path[0] == '\0')
+				return "@" + std::string(sun->sun_path + 1, length - 1);
+
+			return std::string(sun->sun_path, strnlen(sun->sun_path, length));
+		}
+
+		/**
+		 * @brief Looks up the addresses of a host with getaddrinfo, blocking the calling thread until it returns.
+		 *
+		 * Lookups through DNS can take tens of milliseconds, so event loops should use a Resolver instead.
+		 *
+		 * @param {const char*} host - The name or numeric address of the host.
+		 * @param {unsigned short} port - The port given to every address.
+		 * @param {std::vector<Address>&} addresses - Receives the addresses, in the order getaddrinfo prefers them.
+		 * @param {AddressFamily} family - The family to look up. Defaults to UNSPEC for both IPv4 and IPv6.
+		 * @return {int} 0 on success, otherwise the EAI_ error code returned by getaddrinfo.
+		 */
+		static int GetAddressInfo(const char* host, const unsigned short port, std::vector<Address>& addresses, const AddressFamily family = AddressFamily::UNSPEC)
+		{
+			addrinfo hints = {};
+			hints.ai_family = (int)family;
+			hints.ai_socktype = SOCK_STREAM;
+
+			addrinfo* results = nullptr;
+			const int error = getaddrinfo(host, nullptr, &hints, &results);
+			if (error != 0)
+				return error;
+
+			addresses.clear();
+			for (const addrinfo* result = results; result != nullptr; result = result->ai_next)
+			{
+				Address address(result->ai_addr, (socklen_t)result->ai_addrlen);
+
+				if (result->ai_family == AF_INET)
+					((sockaddr_in*)&address.address_)->sin_port = htons(port);
+				else if (result->ai_family == AF_INET6)
+					((sockaddr_in6*)&address.address_)->sin6_port = htons(port);
+				else
+					continue;
+
+				addresses.push_back(address);
+			}
+
+			freeaddrinfo(results);
+
+			return 0;
+		}
+	};
+
+	/**
+	 * @brief A compact copy of an IPv4 or IPv6 address and port, for use as the key of per-peer tables.
+	 *
+	 * Address keeps a whole sockaddr_storage, which is too large and has no identity of its own. A CompactAddress
+	 * packs the family, address, port and IPv6 scope into 24 bytes with no padding, is trivially copyable, and
+	 * compares and hashes as three 64 bit words. The IPv6 flow label is not part of the identity of a peer and is
+	 * dropped.
+	 */
+	class CompactAddress
+	{
+	private:
+		uint8_t bytes_[16];	///< The address, IPv4 addresses use the first 4 bytes and leave the rest zero.
+		uint32_t scope_;	///< The IPv6 scope id, 0 for IPv4.
+		uint16_t port_;		///< The port, in host order.
+		uint16_t family_;	///< The address family, 0 if empty.
+
+		static uint64_t Mix(uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xff51afd7ed558ccdull;
+			value ^= value >> 33;
+			value *= 0xc4ceb9fe1a85ec53ull;
+			value ^= value >> 33;
+
+			return value;
+		}
+
+		void Words(uint64_t (&words)[3]) const
+		{
+			std::memcpy(words, this, sizeof(words));
+		}
+
+		/**
+		 * @brief Orders by family, then address, then port, then scope.
+		 */
+		int Compare(const CompactAddress& other) const
+		{
+			if (family_ != other.family_)
+				return family_ < other.family_ ? -1 : 1;
+
+			if (const int order = std::memcmp(bytes_, other.bytes_, sizeof(bytes_)))
+				return order;
+
+			if (port_ != other.port_)
+				return port_ < other.port_ ? -1 : 1;
+
+			if (scope_ != other.scope_)
+				return scope_ < other.scope_ ? -1 : 1;
+
+			return 0;
+		}
+
+	public:
+		/**
+		 * @brief Constructs an empty address.
+		 */
+		CompactAddress() : bytes_(), scope_(0), port_(0), family_(0) {}
+
+		/**
+		 * @brief Constructs an address from its parts.
+		 *
+		 * @param {int} family - AF_INET or AF_INET6.
+		 * @param {const uint8_t*} bytes - The address in network order, 4 bytes for IPv4 and 16 for IPv6.
+		 * @param {uint16_t} port - The port, in host order.
+		 * @param {uint32_t} scope - The IPv6 scope id. Defaults to 0 if not specified.
+		 */
+		CompactAddress(const int family, const uint8_t* bytes, const uint16_t port, const uint32_t scope = 0) : CompactAddress()
+		{
+			if (family != AF_INET && family != AF_INET6)
+				return;
+
+			std::memcpy(bytes_, bytes, family == AF_INET ? 4 : 16);
+			scope_ = family == AF_INET ? 0 : scope;
+			port_ = port;
+			family_ = (uint16_t)family;
+		}
+
+		/**
+		 * @brief Constructs a compact copy of a socket address. Families other than INET and INET6 leave it empty.
+		 *
+		 * @param {const sockaddr*} address - The socket address to copy.
+		 */
+		explicit CompactAddress(const sockaddr* address) : CompactAddress()
+		{
+			if (address->sa_family == AF_INET)
+			{
+				const sockaddr_in* sin = (const sockaddr_in*)address;
+				std::memcpy(bytes_, &sin->sin_addr, sizeof(sin->sin_addr));
+				port_ = ntohs(sin->sin_port);
+				family_ = AF_INET;
+			}
+			else if (address->sa_family == AF_INET6)
+			{
+				const sockaddr_in6* sin6 = (const sockaddr_in6*)address;
+				std::memcpy(bytes_, &sin6->sin6_addr, sizeof(sin6->sin6_addr));
+				scope_ = sin6->sin6_scope_id;
+				port_ = ntohs(sin6->sin6_port);
+				family_ = AF_INET6;
+			}
+		}
+
+		/**
+		 * @brief Constructs a compact copy of an address.
+		 *
+		 * @param {const Address&} address - The address to copy.
+		 */
+		explicit CompactAddress(const Address& address) : CompactAddress(address.name()) {}
+
+		/**
+		 * @brief Expands the address back into a socket address.
+		 *
+		 * @return {Address} The address, empty if this one is.
+		 */
+		Address ToAddress() const
+		{
+			if (family_ == AF_INET)
+			{
+				sockaddr_in sin = {};
+				sin.sin_family = AF_INET;
+				sin.sin_port = htons(port_);
+				std::memcpy(&sin.sin_addr, bytes_, sizeof(sin.sin_addr));
+
+				return Address((const sockaddr*)&sin, sizeof(sin));
+			}
+
+			if (family_ == AF_INET6)
+			{
+				sockaddr_in6 sin6 = {};
+				sin6.sin6_family = AF_INET6;
+				sin6.sin6_port = htons(port_);
+				sin6.sin6_scope_id = scope_;
+				std::memcpy(&sin6.sin6_addr, bytes_, sizeof(sin6.sin6_addr));
+
+				return Address((const sockaddr*)&sin6, sizeof(sin6));
+			}
+
+			return Address();
+		}
+
+		/**
+		 * @brief Returns whether the address holds an IPv4 or IPv6 address.
+		 */
+		explicit operator bool() const
+		{
+			return family_ != 0;
+		}
+
+		/**
+		 * @brief Returns the address family.
+		 *
+		 * @return {int} AF_INET, AF_INET6, or 0 if empty.
+		 */
+		int family() const
+		{
+			return family_;
+		}
+
+		/**
+		 * @brief Returns the port.
+		 *
+		 * @return {uint16_t} The port, in host order.
+		 */
+		uint16_t port() const
+		{
+			return port_;
+		}
+
+		/**
+		 * @brief Returns the raw address, in network order.
+		 *
+		 * @return {const uint8_t*} 4 bytes for IPv4, 16 for IPv6.
+		 */
+		const uint8_t* bytes() const
+		{
+			return bytes_;
+		}
+
+		/**
+		 * @brief Returns the IPv6 scope id.
+		 *
+		 * @return {uint32_t} The scope id, 0 for IPv4 and global addresses.
+		 */
+		uint32_t scope() const
+		{
+			return scope_;
+		}
+
+		/**
+		 * @brief Hashes the address, mixing every bit into the result so that the low bits are usable as a bucket
+		 * index on their own.
+		 *
+		 * @return {size_t} The hash.
+		 */
+		size_t hash() const
 		{
-			// getaddrinfo();
+			uint64_t words[3];
+			Words(words);
+
+			return (size_t)Mix(words[0] ^ Mix(words[1] ^ Mix(words[2])));
+		}
+
+		friend bool operator==(const CompactAddress& left, const CompactAddress& right)
+		{
+			uint64_t a[3], b[3];
+			left.Words(a);
+			right.Words(b);
+
+			return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2])) == 0;
 		}
+
+		friend bool operator!=(const CompactAddress& left, const CompactAddress& right)
+		{
+			return !(left == right);
+		}
+
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+		friend std::strong_ordering operator<=>(const CompactAddress& left, const CompactAddress& right)
+		{
+			return left.Compare(right) <=> 0;
+		}
+#else
+		friend bool operator<(const CompactAddress& left, const CompactAddress& right) { return left.Compare(right) < 0; }
+		friend bool operator>(const CompactAddress& left, const CompactAddress& right) { return left.Compare(right) > 0; }
+		friend bool operator<=(const CompactAddress& left, const CompactAddress& right) { return left.Compare(right) <= 0; }
+		friend bool operator>=(const CompactAddress& left, const CompactAddress& right) { return left.Compare(right) >= 0; }
+#endif
 	};
+
+	/**
+	 * @brief The longest address and port in text, "[IPv6%scope]:port", including the terminating null.
+	 */
+	constexpr size_t MAX_ADDRESS_TEXT = 1 + MAX_IPV6_TEXT + 11 + 2 + 5 + 1;
+
+	/**
+	 * @brief Parses an address with an optional port, detecting its family: "a.b.c.d", "a.b.c.d:port", an IPv6
+	 * address, or "[IPv6]:port". A numeric IPv6 scope id may follow the address as "%scope".
+	 *
+	 * @param {const char*} text - The text, which does not need to be null terminated.
+	 * @param {size_t} length - The length of the text.
+	 * @param {CompactAddress&} address - Receives the address, with port 0 if none was given.
+	 * @return {bool} True if the text is a valid address.
+	 */
+	inline bool ParseAddress(const char* text, const size_t length, CompactAddress& address)
+	{
+		const auto ParseNumber = [](const char* digits, const size_t count, const uint64_t limit, uint64_t& value) {
+			if (count == 0 || count > 10)
+				return false;
+
+			value = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (digits[i] < '0' || digits[i] > '9')
+					return false;
+				value = value * 10 + (uint64_t)(digits[i] - '0');
+			}
+
+			return value <= limit;
+		};
+
+		if (length == 0)
+			return false;
+
+		const char* colon = (const char*)std::memchr(text, ':', length);
+		const char* end = text + length;
+		uint64_t port = 0;
+
+		// No colon, or a single one before the port, is IPv4.
+		if (colon == nullptr || std::memchr(colon + 1, ':', end - colon - 1) == nullptr)
+		{
+			uint8_t bytes[4];
+			const size_t host = colon == nullptr ? length : (size_t)(colon - text);
+			if (!ParseIPv4(text, host, bytes) || (colon != nullptr && !ParseNumber(colon + 1, end - colon - 1, 65535, port)))
+				return false;
+
+			address = CompactAddress(AF_INET, bytes, (uint16_t)port);
+
+			return true;
+		}
+
+		const char* first = text;
+		const char* last = end;
+		if (text[0] == '[')
+		{
+			const char* bracket = (const char*)std::memchr(text, ']', length);
+			if (bracket == nullptr)
+				return false;
+
+			if (bracket + 1 != end && (bracket[1] != ':' || !ParseNumber(bracket + 2, end - bracket - 2, 65535, port)))
+				return false;
+
+			first = text + 1;
+			last = bracket;
+		}
+
+		uint64_t scope = 0;
+		const char* percent = (const char*)std::memchr(first, '%', last - first);
+		if (percent != nullptr)
+		{
+			if (!ParseNumber(percent + 1, last - percent - 1, UINT32_MAX, scope))
+				return false;
+
+			last = percent;
+		}
+
+		uint8_t bytes[16];
+		if (!ParseIPv6(first, last - first, bytes))
+			return false;
+
+		address = CompactAddress(AF_INET6, bytes, (uint16_t)port, (uint32_t)scope);
+
+		return true;
+	}
+
+	/**
+	 * @brief Writes an address in text, in the form ParseAddress reads: "a.b.c.d:port" or "[IPv6%scope]:port".
+	 *
+	 * @param {const CompactAddress&} address - The address to write.
+	 * @param {char*} text - Receives the null terminated text, at least MAX_ADDRESS_TEXT characters.
+	 * @param {bool} port - Whether to write the port. Defaults to true if not specified.
+	 * @return {size_t} The length of the text, 0 if the address is empty.
+	 */
+	inline size_t FormatAddress(const CompactAddress& address, char* text, const bool port = true)
+	{
+		const auto FormatNumber = [](uint64_t value, char* out) {
+			char digits[20];
+			size_t count = 0;
+			do
+			{
+				digits[count++] = (char)('0' + value % 10);
+				value /= 10;
+			} while (value != 0);
+
+			for (size_t i = 0; i < count; ++i)
+				out[i] = digits[count - 1 - i];
+
+			return count;
+		};
+
+		char* out = text;
+
+		if (address.family() == AF_INET)
+		{
+			out += FormatIPv4(address.bytes(), out);
+		}
+		else if (address.family() == AF_INET6)
+		{
+			if (port)
+				*out++ = '[';
+
+			out += FormatIPv6(address.bytes(), out);
+
+			if (address.scope() != 0)
+			{
+				*out++ = '%';
+				out += FormatNumber(address.scope(), out);
+			}
+
+			if (port)
+				*out++ = ']';
+		}
+
+		if (out != text && port)
+		{
+			*out++ = ':';
+			out += FormatNumber(address.port(), out);
+		}
+
+		*out = '\0';
+
+		return (size_t)(out - text);
+	}
+
+	static_assert(sizeof(CompactAddress) == 24, "CompactAddress must not have padding, it is hashed and compared as words.");
+	static_assert(std::is_trivially_copyable<CompactAddress>::value, "CompactAddress must be trivially copyable.");
 } // namespace netstack
 
+/**
+ * @brief Lets CompactAddress key std::unordered_map and std::unordered_set.
+ */
+namespace std
+{
+	template <>
+	struct hash<netstack::CompactAddress>
+	{
+		size_t operator()(const netstack::CompactAddress& address) const
+		{
+			return address.hash();
+		}
+	};
+}
+
 #endif // CPP_ADDRESS_HPP
\ No newline at end of file
@@ -0,0 +1,236 @@
+#ifndef CPP_BATCH_HPP
+#define CPP_BATCH_HPP
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "netstack.h"
+#include "address.hpp"
+
+namespace netstack
+{
+	/**
+	 * @brief A preallocated array of datagrams and their peer addresses, used to move many datagrams per system call.
+	 * 
+	 * All storage is allocated once by the constructor. Receiving fills the batch in place and sending transmits the
+	 * datagrams pushed into it, so a batch can be reused for any number of calls without further allocations.
+	 */
+	class MessageBatch
+	{
+		friend class Socket;
+	private:
+		size_t capacity_;				///< The maximum number of datagrams the batch can hold.
+		size_t messageSize_;			///< The maximum size of a single datagram.
+		size_t count_;					///< The number of datagrams currently held.
+		std::vector<char> storage_;		///< Contiguous storage for every datagram slot.
+		std::vector<size_t> lengths_;	///< The length of each datagram.
+		std::vector<bool> truncated_;	///< Whether each received datagram was cut to fit its slot.
+		std::vector<Address> addresses_;///< The peer address of each datagram.
+#if defined(__linux__)
+		std::vector<mmsghdr> headers_;	///< The message headers passed to recvmmsg and sendmmsg.
+		std::vector<iovec> vectors_;	///< The I/O vector describing each datagram slot.
+#endif
+
+		/**
+		 * @brief Points every message header at its slot and address, ready for a call of up to count datagrams.
+		 * 
+		 * @param {size_t} count - The number of headers to prepare.
+		 * @param {bool} receiving - Whether the headers describe empty slots to receive into, or held datagrams to send.
+		 */
+		void Prepare(const size_t count, const bool receiving)
+		{
+#if defined(__linux__)
+			for (size_t i = 0; i < count; ++i)
+			{
+				vectors_[i].iov_len = receiving ? messageSize_ : lengths_[i];
+				headers_[i].msg_hdr.msg_namelen = receiving ? sizeof(sockaddr_storage) : addresses_[i].size();
+			}
+#else
+			(void)count;
+			(void)receiving;
+#endif
+		}
+
+	public:
+		/**
+		 * @brief Creates a batch.
+		 * 
+		 * @param {size_t} capacity - The maximum number of datagrams moved per call.
+		 * @param {size_t} messageSize - The maximum size of a single datagram. Defaults to 2048 bytes if not specified.
+		 */
+		MessageBatch(const size_t capacity, const size_t messageSize = 2048) :
+			capacity_(capacity), messageSize_(messageSize), count_(0),
+			storage_(capacity * messageSize), lengths_(capacity), truncated_(capacity), addresses_(capacity)
+		{
+#if defined(__linux__)
+			headers_.resize(capacity);
+			vectors_.resize(capacity);
+
+			for (size_t i = 0; i < capacity; ++i)
+			{
+				vectors_[i].iov_base = &storage_[i * messageSize];
+				vectors_[i].iov_len = messageSize;
+
+				headers_[i] = {};
+				headers_[i].msg_hdr.msg_name = addresses_[i].name();
+				headers_[i].msg_hdr.msg_iov = &vectors_[i];
+				headers_[i].msg_hdr.msg_iovlen = 1;
+			}
+#endif
+		}
+
+		MessageBatch(const MessageBatch&) = delete;
+		MessageBatch& operator=(const MessageBatch&) = delete;
+
+		/**
+		 * @brief Appends a copy of a datagram to be sent to the specified address.
+		 * 
+		 * @param {const char*} buffer - The datagram to send.
+		 * @param {size_t} length - The length of the datagram, at most the message size of the batch.
+		 * @param {const Address&} address - The destination of the datagram.
+		 * @return {bool} False if the batch is full or the datagram is too large.
+		 */
+		bool Push(const char* buffer, const size_t length, const Address& address)
+		{
+			if (count_ == capacity_ || length > messageSize_)
+				return false;
+
+			std::memcpy(data(count_), buffer, length);
+			lengths_[count_] = length;
+			truncated_[count_] = false;
+			addresses_[count_] = address;
+			++count_;
+
+			return true;
+		}
+
+		/**
+		 * @brief Removes every datagram from the batch, keeping its storage.
+		 */
+		void Clear()
+		{
+			count_ = 0;
+		}
+
+		/**
+		 * @brief Returns a pointer to the datagram at the specified index.
+		 * 
+		 * @param {size_t} index - The index of the datagram.
+		 * @return {char*} A pointer to the datagram.
+		 */
+		char* data(const size_t index)
+		{
+			return &storage_[index * messageSize_];
+		}
+
+		/**
+		 * @brief Returns the length of the datagram at the specified index.
+		 * 
+		 * @param {size_t} index - The index of the datagram.
+		 * @return {size_t} The length of the datagram.
+		 */
+		size_t length(const size_t index) const
+		{
+			return lengths_[index];
+		}
+
+		/**
+		 * @brief Returns whether the datagram at the specified index was larger than the message size of the batch, so
+		 * only its first messageSize bytes were kept.
+		 * 
+		 * @param {size_t} index - The index of the datagram.
+		 * @return {bool} True if the datagram was truncated. Always false on platforms that cannot tell, such as macOS.
+		 */
+		bool truncated(const size_t index) const
+		{
+			return truncated_[index];
+		}
+
+		/**
+		 * @brief Returns the peer address of the datagram at the specified index.
+		 * 
+		 * @param {size_t} index - The index of the datagram.
+		 * @return {Address&} The source of a received datagram, or the destination of one to send.
+		 */
+		Address& address(const size_t index)
+		{
+			return addresses_[index];
+		}
+
+		/**
+		 * @brief Returns the number of datagrams currently held.
+		 * 
+		 * @return {size_t} The number of datagrams.
+		 */
+		size_t size() const
+		{
+			return count_;
+		}
+
+		/**
+		 * @brief Returns the maximum number of datagrams the batch can hold.
+		 * 
+		 * @return {size_t} The capacity of the batch.
+		 */
+		size_t capacity() const
+		{
+			return capacity_;
+		}
+
+		/**
+		 * @brief Returns the maximum size of a single datagram.
+		 * 
+		 * @return {size_t} The message size of the batch.
+		 */
+		size_t messageSize() const
+		{
+			return messageSize_;
+		}
+	};
+
+	/**
+	 * @brief Describes a buffer holding consecutive datagrams of the same size, as sent with UDP segmentation offload
+	 * (GSO) and received with UDP receive offload (GRO). Every segment is segmentSize bytes long except the last,
+	 * which may be shorter.
+	 */
+	struct DatagramSegments
+	{
+		size_t size;		///< The length of the whole buffer.
+		size_t segmentSize;	///< The length of every datagram but the last.
+
+		/**
+		 * @brief Returns the number of datagrams in the buffer.
+		 * 
+		 * @return {size_t} The number of datagrams.
+		 */
+		size_t count() const
+		{
+			return segmentSize == 0 ? 0 : (size + segmentSize - 1) / segmentSize;
+		}
+
+		/**
+		 * @brief Returns where the datagram at the specified index starts in the buffer.
+		 * 
+		 * @param {size_t} index - The index of the datagram.
+		 * @return {size_t} The offset of the datagram.
+		 */
+		size_t offset(const size_t index) const
+		{
+			return index * segmentSize;
+		}
+
+		/**
+		 * @brief Returns the length of the datagram at the specified index.
+		 * 
+		 * @param {size_t} index - The index of the datagram.
+		 * @return {size_t} The length of the datagram.
+		 */
+		size_t length(const size_t index) const
+		{
+			return std::min(segmentSize, size - offset(index));
+		}
+	};
+} // namespace netstack
+
+#endif // CPP_BATCH_HPP
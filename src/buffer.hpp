@@ -0,0 +1,117 @@
+#ifndef CPP_BUFFER_HPP
+#define CPP_BUFFER_HPP
+
+#include <string>
+#include <cstddef>
+
+namespace netstack
+{
+	/**
+	 * @brief A non-owning view of a writable region of memory, used to scatter received data.
+	 */
+	class MutableBuffer
+	{
+	private:
+		char* data_;	///< The start of the region.
+		size_t size_;	///< The size of the region in bytes.
+
+	public:
+		/**
+		 * @brief Creates a view of a region of memory.
+		 * 
+		 * @param {void*} data - The start of the region.
+		 * @param {size_t} size - The size of the region in bytes.
+		 */
+		MutableBuffer(void* data, const size_t size) : data_((char*)data), size_(size) {}
+
+		/**
+		 * @brief Creates a view of the current contents of a string.
+		 * 
+		 * @param {std::string&} buffer - The string to view, its size is the size of the region.
+		 */
+		MutableBuffer(std::string& buffer) : data_(&buffer[0]), size_(buffer.size()) {}
+
+		/**
+		 * @brief Creates a view of a character array.
+		 * 
+		 * @param {char(&)[N]} buffer - The array to view.
+		 */
+		template <size_t N>
+		MutableBuffer(char (&buffer)[N]) : data_(buffer), size_(N) {}
+
+		/**
+		 * @brief Returns a pointer to the start of the region.
+		 * 
+		 * @return {char*} The start of the region.
+		 */
+		char* data() const
+		{
+			return data_;
+		}
+
+		/**
+		 * @brief Returns the size of the region.
+		 * 
+		 * @return {size_t} The size of the region in bytes.
+		 */
+		size_t size() const
+		{
+			return size_;
+		}
+	};
+
+	/**
+	 * @brief A non-owning view of a read-only region of memory, used to gather data to send.
+	 */
+	class ConstBuffer
+	{
+	private:
+		const char* data_;	///< The start of the region.
+		size_t size_;		///< The size of the region in bytes.
+
+	public:
+		/**
+		 * @brief Creates a view of a region of memory.
+		 * 
+		 * @param {const void*} data - The start of the region.
+		 * @param {size_t} size - The size of the region in bytes.
+		 */
+		ConstBuffer(const void* data, const size_t size) : data_((const char*)data), size_(size) {}
+
+		/**
+		 * @brief Creates a view of the contents of a string.
+		 * 
+		 * @param {const std::string&} buffer - The string to view.
+		 */
+		ConstBuffer(const std::string& buffer) : data_(buffer.data()), size_(buffer.size()) {}
+
+		/**
+		 * @brief Creates a read-only view of a writable region.
+		 * 
+		 * @param {MutableBuffer} buffer - The region to view.
+		 */
+		ConstBuffer(const MutableBuffer buffer) : data_(buffer.data()), size_(buffer.size()) {}
+
+		/**
+		 * @brief Returns a pointer to the start of the region.
+		 * 
+		 * @return {const char*} The start of the region.
+		 */
+		const char* data() const
+		{
+			return data_;
+		}
+
+		/**
+		 * @brief Returns the size of the region.
+		 * 
+		 * @return {size_t} The size of the region in bytes.
+		 */
+		size_t size() const
+		{
+			return size_;
+		}
+	};
+} // namespace netstack
+
+#endif // CPP_BUFFER_HPP
@@ -0,0 +1,411 @@
+#ifndef CPP_CAPTURE_HPP
+#define CPP_CAPTURE_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+#include "netstack.h"
+#include "socket.hpp"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+namespace netstack
+{
+	/**
+	 * @brief A frame captured into the ring of a CaptureSocket, valid until its block is released.
+	 */
+	struct CapturedFrame
+	{
+		const char* data;		///< The frame, starting at its link layer header.
+		uint32_t length;		///< The bytes captured, at most the snapshot length of the ring.
+		uint32_t wireLength;	///< The length of the frame on the wire.
+		uint32_t seconds;		///< The capture time, in seconds since the epoch.
+		uint32_t nanoseconds;	///< The fraction of a second of the capture time.
+		int interface;			///< The index of the interface the frame was seen on.
+	};
+
+	/**
+	 * @brief A block of frames handed over by the kernel, which owns it again once it is released.
+	 *
+	 * Frames are read straight out of the mapped ring, so iterating a block never copies or calls into the kernel.
+	 */
+	class CaptureBlock
+	{
+		friend class CaptureSocket;
+	private:
+		tpacket_block_desc* block_;	///< The block, or nullptr if nothing was captured.
+
+		CaptureBlock(tpacket_block_desc* block) : block_(block) {}
+
+	public:
+		/**
+		 * @brief Walks the frames of a block in the order they were captured.
+		 */
+		class Iterator
+		{
+		private:
+			const tpacket3_hdr* header_;	///< The header of the current frame.
+			uint32_t remaining_;			///< The frames left, including the current one.
+
+		public:
+			Iterator(const tpacket3_hdr* header, const uint32_t remaining) : header_(header), remaining_(remaining) {}
+
+			CapturedFrame operator*() const
+			{
+				const sockaddr_ll* link = (const sockaddr_ll*)((const char*)header_ + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+
+				return CapturedFrame{ (const char*)header_ + header_->tp_mac, header_->tp_snaplen, header_->tp_len,
+					header_->tp_sec, header_->tp_nsec, link->sll_ifindex };
+			}
+
+			Iterator& operator++()
+			{
+				header_ = (const tpacket3_hdr*)((const char*)header_ + header_->tp_next_offset);
+				--remaining_;
+
+				return *this;
+			}
+
+			bool operator!=(const Iterator& other) const
+			{
+				return remaining_ != other.remaining_;
+			}
+		};
+
+		CaptureBlock() : block_(nullptr) {}
+
+		Iterator begin() const
+		{
+			return block_ == nullptr
+				? Iterator(nullptr, 0)
+				: Iterator((const tpacket3_hdr*)((const char*)block_ + block_->hdr.bh1.offset_to_first_pkt), size());
+		}
+
+		Iterator end() const
+		{
+			return Iterator(nullptr, 0);
+		}
+
+		/**
+		 * @brief Returns the number of frames in the block.
+		 *
+		 * @return {size_t} The number of frames.
+		 */
+		size_t size() const
+		{
+			return block_ == nullptr ? 0 : block_->hdr.bh1.num_pkts;
+		}
+
+		/**
+		 * @brief Returns the sequence number of the block, which skips a beat whenever the ring was full.
+		 *
+		 * @return {uint64_t} The sequence number.
+		 */
+		uint64_t sequence() const
+		{
+			return block_ == nullptr ? 0 : block_->hdr.bh1.seq_num;
+		}
+
+		/**
+		 * @brief Returns whether the block holds frames.
+		 */
+		explicit operator bool() const
+		{
+			return block_ != nullptr;
+		}
+	};
+
+	/**
+	 * @brief Counters of a capture ring since they were last read.
+	 */
+	struct CaptureStatistics
+	{
+		uint32_t packets;	///< The frames seen, including those dropped.
+		uint32_t drops;		///< The frames dropped because no block was free.
+		uint32_t freezes;	///< The times the ring filled up.
+	};
+
+	/**
+	 * @brief A raw packet socket that captures frames into a ring shared with the kernel (PACKET_RX_RING with
+	 * TPACKET_V3).
+	 *
+	 * The kernel fills whole blocks of variable-length frames and hands each over once it is full or its timeout
+	 * expires, so a busy capture costs one poll per block rather than a system call and a copy per frame. Blocks are
+	 * handed back in order with Release. Requires CAP_NET_RAW.
+	 *
+	 * @extends Socket
+	 */
+	class CaptureSocket : public Socket
+	{
+	private:
+		char* ring_;		///< The mapped ring, or nullptr if it could not be set up.
+		size_t blockSize_;	///< The size of each block.
+		size_t blocks_;		///< The number of blocks in the ring.
+		size_t current_;	///< The block read next.
+
+		tpacket_block_desc* Block(const size_t index) const
+		{
+			return (tpacket_block_desc*)(ring_ + index * blockSize_);
+		}
+
+		bool Ready(const size_t index) const
+		{
+			return (__atomic_load_n(&Block(index)->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) != 0;
+		}
+
+		bool Setup(const char* interface, const int protocol, const size_t frameSize, const int timeout)
+		{
+			if (!nsIsValidSocket(_socket))
+				return false;
+
+			int version = TPACKET_V3;
+			if (setsockopt(_socket, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0)
+				return false;
+
+			tpacket_req3 request = {};
+			request.tp_block_size = (unsigned)blockSize_;
+			request.tp_block_nr = (unsigned)blocks_;
+			request.tp_frame_size = (unsigned)frameSize;
+			request.tp_frame_nr = (unsigned)(blockSize_ / frameSize * blocks_);
+			request.tp_retire_blk_tov = (unsigned)timeout;
+			if (setsockopt(_socket, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) != 0)
+				return false;
+
+			void* ring = mmap(nullptr, blockSize_ * blocks_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, _socket, 0);
+			if (ring == MAP_FAILED)
+				ring = mmap(nullptr, blockSize_ * blocks_, PROT_READ | PROT_WRITE, MAP_SHARED, _socket, 0);
+			if (ring == MAP_FAILED)
+				return false;
+
+			ring_ = (char*)ring;
+
+			// Without an interface every interface is captured.
+			sockaddr_ll address = {};
+			address.sll_family = AF_PACKET;
+			address.sll_protocol = htons((uint16_t)protocol);
+			address.sll_ifindex = interface == nullptr ? 0 : (int)if_nametoindex(interface);
+			if (interface != nullptr && address.sll_ifindex == 0)
+				return false;
+
+			return bind(_socket, (sockaddr*)&address, sizeof(address)) == 0;
+		}
+
+	public:
+		/**
+		 * @brief Opens a capture socket and maps its ring.
+		 *
+		 * @param {const char*} interface - The name of the interface to capture on (e.g. "eth0"), or nullptr for all of them.
+		 * @param {size_t} blockSize - The size of each block, a power of two multiple of the page size. Defaults to 1 MiB if not specified.
+		 * @param {size_t} blocks - The number of blocks in the ring. Defaults to 64 if not specified.
+		 * @param {int} timeout - The longest in milliseconds a block waits to fill before it is handed over. Defaults to 10 if not specified.
+		 * @param {int} protocol - The EtherType to capture, in host order. Defaults to ETH_P_ALL if not specified.
+		 */
+		CaptureSocket(const char* interface = nullptr, const size_t blockSize = 1024 * 1024, const size_t blocks = 64,
+			const int timeout = 10, const int protocol = ETH_P_ALL) :
+			Socket((int)AddressFamily::PACKET, (int)SocketType::RAW, htons((uint16_t)protocol)),
+			ring_(nullptr), blockSize_(blockSize), blocks_(blocks), current_(0)
+		{
+			// Frames are packed back to back in V3, the frame size only has to divide the block size.
+			if (!Setup(interface, protocol, 2048, timeout) && ring_ != nullptr)
+			{
+				munmap(ring_, blockSize_ * blocks_);
+				ring_ = nullptr;
+			}
+		}
+
+		CaptureSocket(const CaptureSocket&) = delete;
+		CaptureSocket& operator=(const CaptureSocket&) = delete;
+
+		/**
+		 * @brief Unmaps the ring. Frames of blocks still held are no longer valid.
+		 */
+		~CaptureSocket()
+		{
+			if (ring_ != nullptr)
+				munmap(ring_, blockSize_ * blocks_);
+		}
+
+		/**
+		 * @brief Returns whether the ring was set up, which fails without CAP_NET_RAW.
+		 */
+		explicit operator bool() const
+		{
+			return ring_ != nullptr;
+		}
+
+		/**
+		 * @brief Waits for the next block of frames.
+		 *
+		 * The block belongs to the caller until it is released, and no later block is returned before then.
+		 *
+		 * @param {int} timeout - The longest to wait in milliseconds, 0 to only check or -1 to wait indefinitely.
+		 * @return {CaptureBlock} The block, or an empty block if none was handed over in time.
+		 */
+		CaptureBlock Next(const int timeout = -1)
+		{
+			if (ring_ == nullptr)
+				return CaptureBlock();
+
+			if (!Ready(current_))
+			{
+				pollfd descriptor = { _socket, POLLIN | POLLERR, 0 };
+				if (poll(&descriptor, 1, timeout) <= 0 || !Ready(current_))
+					return CaptureBlock();
+			}
+
+			return CaptureBlock(Block(current_));
+		}
+
+		/**
+		 * @brief Hands a block back to the kernel to be filled again.
+		 *
+		 * @param {CaptureBlock&} block - The block returned by Next, left empty.
+		 */
+		void Release(CaptureBlock& block)
+		{
+			if (block.block_ == nullptr)
+				return;
+
+			__atomic_store_n(&block.block_->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+			block.block_ = nullptr;
+			current_ = (current_ + 1) % blocks_;
+		}
+
+		/**
+		 * @brief Reads and resets the counters of the ring.
+		 *
+		 * @param {CaptureStatistics&} statistics - Receives the counters.
+		 * @return {bool} True if the counters were read.
+		 */
+		bool Statistics(CaptureStatistics& statistics)
+		{
+			tpacket_stats_v3 native = {};
+			socklen_t length = sizeof(native);
+			if (getsockopt(_socket, SOL_PACKET, PACKET_STATISTICS, &native, &length) != 0)
+				return false;
+
+			statistics = { native.tp_packets, native.tp_drops, native.tp_freeze_q_cnt };
+
+			return true;
+		}
+	};
+
+	/**
+	 * @brief Writes captured frames to a file in the pcap format, with nanosecond timestamps, for tools such as
+	 * Wireshark and tcpdump.
+	 */
+	class PcapWriter
+	{
+	private:
+		static constexpr uint32_t MAGIC = 0xa1b23c4d;		///< Marks a pcap file with nanosecond timestamps.
+		static constexpr uint32_t LINK_ETHERNET = 1;		///< The link type of frames captured on Ethernet and loopback.
+
+		std::FILE* file_;	///< The file written to, or nullptr if it could not be opened.
+		size_t frames_;		///< The number of frames written.
+
+	public:
+		/**
+		 * @brief Creates a file and writes the pcap header.
+		 *
+		 * @param {const char*} path - The path of the file, replaced if it exists.
+		 * @param {uint32_t} snapshotLength - The most bytes kept per frame. Defaults to 65535 if not specified.
+		 */
+		PcapWriter(const char* path, const uint32_t snapshotLength = 65535) : file_(std::fopen(path, "wb")), frames_(0)
+		{
+			const uint32_t header[6] = { MAGIC, 2 | (4 << 16), 0, 0, snapshotLength, LINK_ETHERNET };
+
+			if (file_ != nullptr && std::fwrite(header, sizeof(header), 1, file_) != 1)
+			{
+				std::fclose(file_);
+				file_ = nullptr;
+			}
+		}
+
+		PcapWriter(const PcapWriter&) = delete;
+		PcapWriter& operator=(const PcapWriter&) = delete;
+
+		/**
+		 * @brief Closes the file, flushing what is buffered.
+		 */
+		~PcapWriter()
+		{
+			if (file_ != nullptr)
+				std::fclose(file_);
+		}
+
+		/**
+		 * @brief Returns whether the file is open.
+		 */
+		explicit operator bool() const
+		{
+			return file_ != nullptr;
+		}
+
+		/**
+		 * @brief Appends a frame.
+		 *
+		 * @param {const CapturedFrame&} frame - The frame to write.
+		 * @return {bool} True if the frame was written.
+		 */
+		bool Write(const CapturedFrame& frame)
+		{
+			if (file_ == nullptr)
+				return false;
+
+			const uint32_t header[4] = { frame.seconds, frame.nanoseconds, frame.length, frame.wireLength };
+			if (std::fwrite(header, sizeof(header), 1, file_) != 1 || std::fwrite(frame.data, 1, frame.length, file_) != frame.length)
+				return false;
+
+			++frames_;
+
+			return true;
+		}
+
+		/**
+		 * @brief Appends every frame of a block.
+		 *
+		 * @param {const CaptureBlock&} block - The block to write.
+		 * @return {bool} True if every frame was written.
+		 */
+		bool Write(const CaptureBlock& block)
+		{
+			for (const CapturedFrame frame : block)
+			{
+				if (!Write(frame))
+					return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Writes what is buffered to the file.
+		 *
+		 * @return {bool} True if the file was flushed.
+		 */
+		bool Flush()
+		{
+			return file_ != nullptr && std::fflush(file_) == 0;
+		}
+
+		/**
+		 * @brief Returns the number of frames written.
+		 *
+		 * @return {size_t} The number of frames.
+		 */
+		size_t frames() const
+		{
+			return frames_;
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__
+
+#endif // CPP_CAPTURE_HPP
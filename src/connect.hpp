@@ -0,0 +1,220 @@
+#ifndef CPP_CONNECT_HPP
+#define CPP_CONNECT_HPP
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "netstack.h"
+#include "address.hpp"
+#include "socket.hpp"
+
+#if !defined(_WIN32)
+#include <poll.h>
+#endif
+
+namespace netstack
+{
+	/**
+	 * @brief The tunables of ConnectFirst.
+	 */
+	struct ConnectOptions
+	{
+		uint64_t attemptDelay = 250;	///< The milliseconds to wait for an attempt before starting the next, RFC 8305 suggests 250.
+		uint64_t timeout = 10000;		///< The milliseconds to wait for any attempt to connect.
+		bool blocking = true;			///< Whether the connected socket is returned in blocking mode.
+	};
+
+	/**
+	 * @brief Orders addresses for connection attempts as RFC 8305 asks, alternating between IPv6 and IPv4 and
+	 * starting with the family of the first address, while keeping the order of each family.
+	 *
+	 * @param {const std::vector<Address>&} addresses - The addresses, in order of preference.
+	 * @return {std::vector<Address>} The addresses, interleaved by family.
+	 */
+	inline std::vector<Address> InterleaveAddresses(const std::vector<Address>& addresses)
+	{
+		if (addresses.empty())
+			return {};
+
+		const int first = addresses[0].name()->sa_family;
+		std::vector<Address> preferred, other, ordered;
+
+		for (const Address& address : addresses)
+			(address.name()->sa_family == first ? preferred : other).push_back(address);
+
+		for (size_t i = 0; i < std::max(preferred.size(), other.size()); ++i)
+		{
+			if (i < preferred.size())
+				ordered.push_back(preferred[i]);
+			if (i < other.size())
+				ordered.push_back(other[i]);
+		}
+
+		return ordered;
+	}
+
+	/**
+	 * @brief Connects a TCP socket to whichever of several addresses of a host answers first, racing attempts as
+	 * Happy Eyeballs (RFC 8305) does.
+	 *
+	 * Addresses are tried in the order of InterleaveAddresses. Each attempt gets attemptDelay to connect before the
+	 * next one starts alongside it, and a failed attempt starts the next one at once, so a blackholed address or
+	 * family costs one delay rather than a full connect timeout. The first attempt to connect wins and every other
+	 * one is closed.
+	 *
+	 * @param {const std::vector<Address>&} addresses - The addresses of the host, such as those given by a Resolver.
+	 * @param {Address*} peer - Receives the address connected to. Defaults to nullptr if not needed.
+	 * @param {const ConnectOptions&} options - The delays and timeout of the race.
+	 * @return {Socket} The connected socket, which is empty on failure. nsSocketError then returns ETIMEDOUT if attempts
+	 * were still in progress, otherwise the error of the last attempt to fail.
+	 */
+	inline Socket ConnectFirst(const std::vector<Address>& addresses, Address* peer = nullptr, const ConnectOptions& options = ConnectOptions())
+	{
+#if defined(_WIN32)
+		using PollDescriptor = WSAPOLLFD;
+		const int timedOut = WSAETIMEDOUT;
+#else
+		using PollDescriptor = pollfd;
+		const int timedOut = ETIMEDOUT;
+#endif
+		using Clock = std::chrono::steady_clock;
+
+		const std::vector<Address> ordered = InterleaveAddresses(addresses);
+		const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(options.timeout);
+		Clock::time_point nextAttempt = Clock::now();
+
+		std::vector<PollDescriptor> attempts;	// The attempts in progress.
+		std::vector<size_t> targets;			// The address of each attempt.
+		SOCKET winner = Socket::INVALID;
+		size_t winningTarget = 0;
+		size_t next = 0;
+		int error = timedOut;
+
+		while (!nsIsValidSocket(winner))
+		{
+			Clock::time_point now = Clock::now();
+
+			if (next < ordered.size() && (now >= nextAttempt || attempts.empty()))
+			{
+				const size_t target = next++;
+				const Address& address = ordered[target];
+				const SOCKET handle = socket(address.name()->sa_family, SOCK_STREAM, IPPROTO_TCP);
+
+				if (!nsIsValidSocket(handle))
+				{
+					error = nsSocketError();
+					continue;
+				}
+
+#if defined(_WIN32)
+				const bool started = Socket::SetBlocking(handle, false) && (connect(handle, address.name(), address.size()) == 0 || nsSocketError() == WSAEWOULDBLOCK);
+#else
+				const bool started = Socket::SetBlocking(handle, false) && (connect(handle, address.name(), address.size()) == 0 || errno == EINPROGRESS);
+#endif
+				if (!started)
+				{
+					error = nsSocketError();
+					nsCloseSocket(handle);
+					continue;
+				}
+
+				PollDescriptor descriptor = {};
+				descriptor.fd = handle;
+				descriptor.events = POLLOUT;
+				attempts.push_back(descriptor);
+				targets.push_back(target);
+				nextAttempt = now + std::chrono::milliseconds(options.attemptDelay);
+				continue;
+			}
+
+			if (attempts.empty())
+				break;
+
+			if (now >= deadline)
+			{
+				error = timedOut;
+				break;
+			}
+
+			const Clock::time_point wake = next < ordered.size() ? std::min(deadline, nextAttempt) : deadline;
+			const int timeout = (int)std::chrono::duration_cast<std::chrono::milliseconds>(wake - now + std::chrono::microseconds(999)).count();
+
+#if defined(_WIN32)
+			const int ready = WSAPoll(attempts.data(), (ULONG)attempts.size(), timeout);
+#else
+			const int ready = poll(attempts.data(), (nfds_t)attempts.size(), timeout);
+#endif
+			if (ready < 0)
+			{
+#if defined(_WIN32)
+				if (nsSocketError() == WSAEINTR)
+					continue;
+#else
+				if (errno == EINTR)
+					continue;
+#endif
+				error = nsSocketError();
+				break;
+			}
+
+			if (ready == 0)
+				continue;
+
+			for (size_t i = 0; i < attempts.size(); )
+			{
+				if (attempts[i].revents == 0)
+				{
+					++i;
+					continue;
+				}
+
+				int status = 0;
+				socklen_t length = sizeof(status);
+				if (getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, (char*)&status, &length) != 0)
+					status = nsSocketError();
+
+				if (status == 0)
+				{
+					winner = attempts[i].fd;
+					winningTarget = targets[i];
+					attempts.erase(attempts.begin() + i);
+					targets.erase(targets.begin() + i);
+					break;
+				}
+
+				// A failed attempt hands over to the next address without waiting out its delay.
+				error = status;
+				nsCloseSocket(attempts[i].fd);
+				attempts.erase(attempts.begin() + i);
+				targets.erase(targets.begin() + i);
+				nextAttempt = Clock::now();
+			}
+		}
+
+		for (const PollDescriptor& attempt : attempts)
+			nsCloseSocket(attempt.fd);
+
+		if (!nsIsValidSocket(winner))
+		{
+#if defined(_WIN32)
+			WSASetLastError(error);
+#else
+			errno = error;
+#endif
+			return Socket();
+		}
+
+		if (options.blocking)
+			Socket::SetBlocking(winner, true);
+
+		if (peer != nullptr)
+			*peer = ordered[winningTarget];
+
+		return Socket(winner);
+	}
+} // namespace netstack
+
+#endif // CPP_CONNECT_HPP
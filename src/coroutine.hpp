@@ -0,0 +1,641 @@
+#ifndef CPP_COROUTINE_HPP
+#define CPP_COROUTINE_HPP
+
+#include "netstack.h"
+#include "address.hpp"
+#include "buffer.hpp"
+#include "socket.hpp"
+#include "timer.hpp"
+#include "reactor.hpp"
+
+#if defined(__linux__) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace netstack
+{
+	/**
+	 * @brief Recycles coroutine frames through thread local free lists, one per size class.
+	 *
+	 * Frames up to 4 KiB are rounded up to a multiple of 64 bytes and never returned to the heap, so a server that
+	 * keeps starting coroutines of the same kinds stops allocating once it has warmed up.
+	 */
+	class FramePool
+	{
+	private:
+		static constexpr size_t GRANULARITY = 64;	///< The size classes are multiples of this many bytes.
+		static constexpr size_t CLASSES = 64;		///< The number of size classes, larger frames use the heap.
+
+		/**
+		 * @brief A free frame, linked into the list of its size class.
+		 */
+		struct Block
+		{
+			Block* next;	///< The next free frame of the same size class.
+		};
+
+		static Block*& Head(const size_t sizeClass)
+		{
+			thread_local Block* heads[CLASSES] = {};
+
+			return heads[sizeClass];
+		}
+
+	public:
+		/**
+		 * @brief Returns a frame of at least the specified size.
+		 *
+		 * @param {size_t} size - The size of the frame.
+		 * @return {void*} The frame.
+		 */
+		static void* Allocate(const size_t size)
+		{
+			const size_t sizeClass = (size + GRANULARITY - 1) / GRANULARITY;
+			if (sizeClass >= CLASSES)
+				return ::operator new(size);
+
+			Block*& head = Head(sizeClass);
+			if (head == nullptr)
+				return ::operator new(sizeClass * GRANULARITY);
+
+			Block* block = head;
+			head = block->next;
+
+			return block;
+		}
+
+		/**
+		 * @brief Returns a frame to the free list of the calling thread.
+		 *
+		 * @param {void*} frame - The frame.
+		 * @param {size_t} size - The size the frame was allocated with.
+		 */
+		static void Deallocate(void* frame, const size_t size)
+		{
+			const size_t sizeClass = (size + GRANULARITY - 1) / GRANULARITY;
+			if (sizeClass >= CLASSES)
+			{
+				::operator delete(frame);
+				return;
+			}
+
+			Block* block = (Block*)frame;
+			block->next = Head(sizeClass);
+			Head(sizeClass) = block;
+		}
+	};
+
+	template <typename T = void>
+	class Task;
+
+	/**
+	 * @brief The part of a Task promise shared by every result type.
+	 */
+	class TaskPromise
+	{
+		template <typename T>
+		friend class Task;
+	private:
+		std::coroutine_handle<> continuation_;	///< The coroutine awaiting this one, resumed when it finishes.
+		bool detached_ = false;					///< Whether the coroutine destroys itself when it finishes.
+
+		/**
+		 * @brief Transfers control to the awaiting coroutine, or destroys a detached one, once the body has finished.
+		 */
+		struct FinalAwaiter
+		{
+			bool await_ready() noexcept { return false; }
+
+			template <typename Promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+			{
+				TaskPromise& promise = handle.promise();
+				if (promise.continuation_)
+					return promise.continuation_;
+
+				if (promise.detached_)
+					handle.destroy();
+
+				return std::noop_coroutine();
+			}
+
+			void await_resume() noexcept {}
+		};
+
+	public:
+		static void* operator new(const size_t size)
+		{
+			return FramePool::Allocate(size);
+		}
+
+		static void operator delete(void* frame, const size_t size)
+		{
+			FramePool::Deallocate(frame, size);
+		}
+
+		std::suspend_always initial_suspend() noexcept { return {}; }
+
+		FinalAwaiter final_suspend() noexcept { return {}; }
+
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+
+	/**
+	 * @brief A lazily started coroutine producing a value of type T.
+	 *
+	 * The coroutine starts when it is awaited, or when it is handed to Spawn, and its frame comes from the FramePool.
+	 */
+	template <typename T>
+	class Task
+	{
+	public:
+		struct promise_type : TaskPromise
+		{
+			std::optional<T> value_;	///< The value returned by the coroutine.
+
+			Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+			void return_value(T value) { value_.emplace(std::move(value)); }
+		};
+
+	private:
+		std::coroutine_handle<promise_type> handle_;	///< The coroutine, null once moved from or released.
+
+		explicit Task(const std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+	public:
+		Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		~Task()
+		{
+			if (handle_)
+				handle_.destroy();
+		}
+
+		/**
+		 * @brief Gives up ownership of the coroutine, which then destroys itself when it finishes.
+		 *
+		 * @return {std::coroutine_handle<>} The coroutine.
+		 */
+		std::coroutine_handle<> release()
+		{
+			handle_.promise().detached_ = true;
+
+			return std::exchange(handle_, nullptr);
+		}
+
+		bool await_ready() const noexcept { return false; }
+
+		std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept
+		{
+			handle_.promise().continuation_ = awaiting;
+
+			return handle_;
+		}
+
+		T await_resume() { return std::move(*handle_.promise().value_); }
+	};
+
+	/**
+	 * @brief A lazily started coroutine producing no value.
+	 */
+	template <>
+	class Task<void>
+	{
+	public:
+		struct promise_type : TaskPromise
+		{
+			Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+			void return_void() {}
+		};
+
+	private:
+		std::coroutine_handle<promise_type> handle_;	///< The coroutine, null once moved from or released.
+
+		explicit Task(const std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+	public:
+		Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		~Task()
+		{
+			if (handle_)
+				handle_.destroy();
+		}
+
+		/**
+		 * @brief Gives up ownership of the coroutine, which then destroys itself when it finishes.
+		 *
+		 * @return {std::coroutine_handle<>} The coroutine.
+		 */
+		std::coroutine_handle<> release()
+		{
+			handle_.promise().detached_ = true;
+
+			return std::exchange(handle_, nullptr);
+		}
+
+		bool await_ready() const noexcept { return false; }
+
+		std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept
+		{
+			handle_.promise().continuation_ = awaiting;
+
+			return handle_;
+		}
+
+		void await_resume() {}
+	};
+
+	/**
+	 * @brief Starts a coroutine that runs on its own and destroys itself once it finishes.
+	 *
+	 * The coroutine runs until its first suspension before Spawn returns.
+	 *
+	 * @param {Task<void>} task - The coroutine to start.
+	 */
+	inline void Spawn(Task<void> task)
+	{
+		task.release().resume();
+	}
+
+	class AsyncSocket;
+
+	/**
+	 * @brief Suspends a coroutine until a non-blocking operation on an AsyncSocket can complete.
+	 *
+	 * The operation is attempted right away and only suspends when the socket is not ready. Awaitables live in the
+	 * frame of the awaiting coroutine, so an operation never allocates, and double as the timer of their deadline.
+	 */
+	class SocketAwaitable : private Timer
+	{
+		friend class AsyncSocket;
+	protected:
+		AsyncSocket& socket_;				///< The socket the operation runs on.
+		std::coroutine_handle<> waiting_;	///< The suspended coroutine.
+		int result_;						///< The result of the operation.
+		bool reading_;						///< Whether the operation waits for the socket to become readable.
+
+		/**
+		 * @brief Performs the operation without blocking.
+		 *
+		 * @return {bool} True if it completed, with its result in result_. False if the socket is not ready.
+		 */
+		virtual bool Attempt() = 0;
+
+		/**
+		 * @brief Stores the result of a completed system call, or returns false if it would have blocked.
+		 */
+		bool Complete(const long status)
+		{
+			if (status < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+				return false;
+
+			result_ = status < 0 ? -errno : (int)status;
+
+			return true;
+		}
+
+		void OnExpire() override;
+
+		SocketAwaitable(AsyncSocket& socket, const bool reading) : socket_(socket), result_(0), reading_(reading) {}
+
+		~SocketAwaitable() = default;
+
+	public:
+		bool await_ready() { return Attempt(); }
+
+		void await_suspend(std::coroutine_handle<> waiting);
+
+		/**
+		 * @return {int} The result of the operation, or a negated error code (e.g. -ECONNRESET, or -ETIMEDOUT if the
+		 * deadline of the socket passed) on failure.
+		 */
+		int await_resume() const { return result_; }
+	};
+
+	/**
+	 * @brief A non-blocking socket whose operations are awaited from coroutines driven by a Reactor.
+	 *
+	 * The socket is registered with the reactor once, edge triggered, for its whole lifetime. At most one coroutine
+	 * may wait to receive or accept, and one to send or connect, at any time. Waits can be bounded with a receive
+	 * and a send timeout, armed on the timers of the reactor only while an operation is suspended.
+	 *
+	 * @extends Socket
+	 */
+	class AsyncSocket : public Socket, private Handler
+	{
+		friend class SocketAwaitable;
+	private:
+		Reactor& reactor_;				///< The reactor the socket is registered with.
+		SocketAwaitable* reader_;		///< The operation waiting for the socket to become readable.
+		SocketAwaitable* writer_;		///< The operation waiting for the socket to become writable.
+		uint64_t receiveTimeout_;		///< The longest a receive or accept waits in milliseconds, or 0.
+		uint64_t sendTimeout_;			///< The longest a send or connect waits in milliseconds, or 0.
+
+		/**
+		 * @brief Retries the waiting operation of one direction, returning its coroutine if it has completed.
+		 */
+		static std::coroutine_handle<> Retry(SocketAwaitable*& waiting)
+		{
+			if (waiting == nullptr || !waiting->Attempt())
+				return nullptr;
+
+			waiting->Cancel();
+
+			return std::exchange(waiting, nullptr)->waiting_;
+		}
+
+		// A resumed coroutine may destroy this socket, so nothing touches it after the first resume.
+		void OnReadable(Socket&) override
+		{
+			if (std::coroutine_handle<> waiting = Retry(reader_))
+				waiting.resume();
+		}
+
+		void OnWritable(Socket&) override
+		{
+			if (std::coroutine_handle<> waiting = Retry(writer_))
+				waiting.resume();
+		}
+
+		void OnError(Socket&) override
+		{
+			const std::coroutine_handle<> reading = Retry(reader_);
+			const std::coroutine_handle<> writing = Retry(writer_);
+
+			if (reading)
+				reading.resume();
+			if (writing)
+				writing.resume();
+		}
+
+		void Register()
+		{
+			SetBlocking(false);
+			reactor_.Add(*this, *this, Interest::READ_WRITE, Trigger::EDGE);
+		}
+
+	public:
+		/**
+		 * @brief Creates a socket driven by the specified reactor.
+		 *
+		 * @param {Reactor&} reactor - The reactor that resumes the coroutines awaiting the socket.
+		 * @param {AddressFamily} af - The address family to use for the socket (e.g. INET, INET6).
+		 * @param {SocketType} type - The type of socket to create (e.g. STREAM, DATAGRAM).
+		 * @param {SocketProtocol} protocol - The protocol to use with the socket (e.g. TCP, UDP).
+		 */
+		AsyncSocket(Reactor& reactor, const AddressFamily af, const SocketType type, const SocketProtocol protocol) :
+			Socket(af, type, protocol), reactor_(reactor), reader_(nullptr), writer_(nullptr), receiveTimeout_(0), sendTimeout_(0)
+		{
+			Register();
+		}
+
+		/**
+		 * @brief Takes over the specified SOCKET handle, such as one returned by AsyncAccept.
+		 *
+		 * @param {Reactor&} reactor - The reactor that resumes the coroutines awaiting the socket.
+		 * @param {SOCKET} socket - The SOCKET handle to use.
+		 */
+		AsyncSocket(Reactor& reactor, const SOCKET socket) :
+			Socket(socket), reactor_(reactor), reader_(nullptr), writer_(nullptr), receiveTimeout_(0), sendTimeout_(0)
+		{
+			Register();
+		}
+
+		AsyncSocket(const AsyncSocket&) = delete;
+		AsyncSocket& operator=(const AsyncSocket&) = delete;
+
+		/**
+		 * @brief Removes the socket from its reactor before it is closed.
+		 */
+		~AsyncSocket()
+		{
+			reactor_.Remove(*this);
+		}
+
+		/**
+		 * @brief Bounds how long a receive or accept may stay suspended, after which it yields -ETIMEDOUT.
+		 *
+		 * @param {uint64_t} milliseconds - The longest wait, or 0 to wait indefinitely.
+		 */
+		void SetReceiveTimeout(const uint64_t milliseconds)
+		{
+			receiveTimeout_ = milliseconds;
+		}
+
+		/**
+		 * @brief Bounds how long a send or connect may stay suspended, after which it yields -ETIMEDOUT.
+		 *
+		 * A connect that timed out is still in progress, and the socket should be closed.
+		 *
+		 * @param {uint64_t} milliseconds - The longest wait, or 0 to wait indefinitely.
+		 */
+		void SetSendTimeout(const uint64_t milliseconds)
+		{
+			sendTimeout_ = milliseconds;
+		}
+
+		/**
+		 * @brief Receives data into a buffer, suspending until some is available.
+		 */
+		class ReceiveAwaitable : public SocketAwaitable
+		{
+			friend class AsyncSocket;
+		private:
+			MutableBuffer buffer_;	///< The buffer to store the received data.
+			int flags_;				///< The flags of the receive.
+
+			ReceiveAwaitable(AsyncSocket& socket, const MutableBuffer buffer, const int flags) : SocketAwaitable(socket, true), buffer_(buffer), flags_(flags) {}
+
+			bool Attempt() override
+			{
+				return Complete(recv(socket_.handle(), buffer_.data(), buffer_.size(), flags_ | MSG_DONTWAIT));
+			}
+		};
+
+		/**
+		 * @brief Sends data from a buffer, suspending until the socket accepts some of it.
+		 */
+		class SendAwaitable : public SocketAwaitable
+		{
+			friend class AsyncSocket;
+		private:
+			ConstBuffer buffer_;	///< The buffer of data to send.
+			int flags_;				///< The flags of the send.
+
+			SendAwaitable(AsyncSocket& socket, const ConstBuffer buffer, const int flags) : SocketAwaitable(socket, false), buffer_(buffer), flags_(flags) {}
+
+			bool Attempt() override
+			{
+				return Complete(send(socket_.handle(), buffer_.data(), buffer_.size(), flags_ | MSG_DONTWAIT | MSG_NOSIGNAL));
+			}
+		};
+
+		/**
+		 * @brief Accepts a connection, suspending until one is pending.
+		 */
+		class AcceptAwaitable : public SocketAwaitable
+		{
+			friend class AsyncSocket;
+		private:
+			Address* peer_;	///< Receives the address of the peer, or null.
+
+			AcceptAwaitable(AsyncSocket& socket, Address* peer) : SocketAwaitable(socket, true), peer_(peer) {}
+
+			bool Attempt() override
+			{
+				if (peer_ != nullptr)
+					*peer_->ptr() = sizeof(sockaddr_storage);
+
+				return Complete(accept4(socket_.handle(), peer_ == nullptr ? nullptr : peer_->name(), peer_ == nullptr ? nullptr : peer_->ptr(), SOCK_NONBLOCK | SOCK_CLOEXEC));
+			}
+		};
+
+		/**
+		 * @brief Connects the socket, suspending until the connection is established or has failed.
+		 */
+		class ConnectAwaitable : public SocketAwaitable
+		{
+			friend class AsyncSocket;
+		private:
+			const Address& address_;	///< The address to connect to.
+			bool started_;				///< Whether connect has been called.
+
+			ConnectAwaitable(AsyncSocket& socket, const Address& address) : SocketAwaitable(socket, false), address_(address), started_(false) {}
+
+			bool Attempt() override
+			{
+				if (!started_)
+				{
+					started_ = true;
+					if (connect(socket_.handle(), address_.name(), address_.size()) == 0)
+						return Complete(0);
+
+					return errno == EINPROGRESS ? false : Complete(-1);
+				}
+
+				int error = 0;
+				if (!socket_.GetOption(options::PENDING_ERROR, error))
+					return Complete(-1);
+
+				if (error == 0)
+				{
+					// Writability without an error may also be reported before the handshake has finished.
+					sockaddr_storage peer;
+					socklen_t peerLength = sizeof(peer);
+					if (getpeername(socket_.handle(), (sockaddr*)&peer, &peerLength) != 0)
+						return false;
+
+					return Complete(0);
+				}
+
+				errno = error;
+
+				return Complete(-1);
+			}
+		};
+
+		/**
+		 * @brief Receives data into a buffer, suspending the awaiting coroutine until some is available.
+		 *
+		 * @param {MutableBuffer} buffer - The buffer to store the received data.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {ReceiveAwaitable} Yields the number of bytes received, 0 at the end of the stream or a negated error code.
+		 */
+		ReceiveAwaitable AsyncReceive(const MutableBuffer buffer, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			return ReceiveAwaitable(*this, buffer, (int)flags);
+		}
+
+		/**
+		 * @brief Receives data into a buffer, suspending the awaiting coroutine until some is available.
+		 *
+		 * @param {char*} buffer - The buffer to store the received data.
+		 * @param {size_t} length - The length of the buffer.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {ReceiveAwaitable} Yields the number of bytes received, 0 at the end of the stream or a negated error code.
+		 */
+		ReceiveAwaitable AsyncReceive(char* buffer, const size_t length, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			return AsyncReceive(MutableBuffer(buffer, length), flags);
+		}
+
+		/**
+		 * @brief Sends data from a buffer, suspending the awaiting coroutine until the socket accepts some of it.
+		 *
+		 * @param {ConstBuffer} buffer - The buffer of data to send.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {SendAwaitable} Yields the number of bytes sent, which may be less than the buffer, or a negated error code.
+		 */
+		SendAwaitable AsyncSend(const ConstBuffer buffer, const SendFlags flags = SendFlags::NONE)
+		{
+			return SendAwaitable(*this, buffer, (int)flags);
+		}
+
+		/**
+		 * @brief Sends data from a buffer, suspending the awaiting coroutine until the socket accepts some of it.
+		 *
+		 * @param {const char*} buffer - The buffer of data to send.
+		 * @param {size_t} length - The length of the buffer.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {SendAwaitable} Yields the number of bytes sent, which may be less than the buffer, or a negated error code.
+		 */
+		SendAwaitable AsyncSend(const char* buffer, const size_t length, const SendFlags flags = SendFlags::NONE)
+		{
+			return AsyncSend(ConstBuffer(buffer, length), flags);
+		}
+
+		/**
+		 * @brief Accepts a connection on a listening socket, suspending the awaiting coroutine until one is pending.
+		 *
+		 * @param {Address*} peer - Receives the address of the peer. Defaults to nullptr if not needed.
+		 * @return {AcceptAwaitable} Yields the non-blocking SOCKET handle of the connection, or a negated error code.
+		 */
+		AcceptAwaitable AsyncAccept(Address* peer = nullptr)
+		{
+			return AcceptAwaitable(*this, peer);
+		}
+
+		/**
+		 * @brief Connects the socket, suspending the awaiting coroutine until the connection is established.
+		 *
+		 * @param {const Address&} address - The address to connect to, which must stay alive until the connect completes.
+		 * @return {ConnectAwaitable} Yields 0 once connected, or a negated error code.
+		 */
+		ConnectAwaitable AsyncConnect(const Address& address)
+		{
+			return ConnectAwaitable(*this, address);
+		}
+	};
+
+	inline void SocketAwaitable::await_suspend(const std::coroutine_handle<> waiting)
+	{
+		waiting_ = waiting;
+		(reading_ ? socket_.reader_ : socket_.writer_) = this;
+
+		const uint64_t timeout = reading_ ? socket_.receiveTimeout_ : socket_.sendTimeout_;
+		if (timeout != 0)
+			socket_.reactor_.Schedule(*this, timeout);
+	}
+
+	inline void SocketAwaitable::OnExpire()
+	{
+		(reading_ ? socket_.reader_ : socket_.writer_) = nullptr;
+		result_ = -ETIMEDOUT;
+		waiting_.resume();
+	}
+} // namespace netstack
+
+#endif // __linux__ && __cpp_impl_coroutine
+
+#endif // CPP_COROUTINE_HPP
@@ -0,0 +1,551 @@
+#ifndef CPP_IOBUF_HPP
+#define CPP_IOBUF_HPP
+
+#include <new>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "buffer.hpp"
+#include "pool.hpp"
+
+namespace netstack
+{
+	/**
+	 * @brief A chain of reference-counted memory slices, used to frame and forward data without copying it.
+	 *
+	 * Each segment of the chain views part of a shared block of memory. Splitting or cloning a chain only copies
+	 * segment views and bumps reference counts, so a message received on one socket can be sliced into frames and
+	 * sent on another with no memcpy. The space before the first segment (headroom) and after the last (tailroom)
+	 * can be written in place to add headers or append data, as long as no other chain shares that block. The chain
+	 * is only made contiguous on demand, by Gather or Coalesce.
+	 *
+	 * Segments are kept as an array of ConstBuffer views, which is what Socket::SendV takes.
+	 */
+	class IOBuf
+	{
+	private:
+		static constexpr size_t MIN_CAPACITY = 4096;	///< The smallest block allocated to append to.
+
+		/**
+		 * @brief A block of memory shared by the segments viewing it.
+		 */
+		struct Storage
+		{
+			std::atomic<uint32_t> refs;	///< The number of segments viewing the block.
+			size_t capacity;			///< The size of the block.
+			char* memory;				///< The start of the block.
+			PooledBuffer pooled;		///< The buffer the block came from, if it was drawn from a pool.
+
+			/**
+			 * @brief Allocates a block with its memory right after its header.
+			 */
+			static Storage* Allocate(const size_t capacity)
+			{
+				void* raw = ::operator new(sizeof(Storage) + capacity);
+				Storage* storage = new (raw) Storage();
+				storage->refs.store(1, std::memory_order_relaxed);
+				storage->capacity = capacity;
+				storage->memory = (char*)raw + sizeof(Storage);
+
+				return storage;
+			}
+
+			/**
+			 * @brief Adopts the memory of a pooled buffer, returned to its pool once the last view is gone.
+			 */
+			static Storage* Adopt(PooledBuffer&& buffer)
+			{
+				void* raw = ::operator new(sizeof(Storage));
+				Storage* storage = new (raw) Storage();
+				storage->refs.store(1, std::memory_order_relaxed);
+				storage->capacity = buffer.capacity();
+				storage->memory = buffer.data();
+				storage->pooled = std::move(buffer);
+
+				return storage;
+			}
+
+			void Retain()
+			{
+				refs.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void Release()
+			{
+				if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					this->~Storage();
+					::operator delete((void*)this);
+				}
+			}
+
+			bool unique() const
+			{
+				return refs.load(std::memory_order_acquire) == 1;
+			}
+		};
+
+		std::vector<Storage*> storages_;	///< The block of each segment.
+		std::vector<ConstBuffer> views_;	///< The bytes of each segment.
+		size_t size_;						///< The number of bytes in every segment.
+
+		void Push(Storage* storage, const char* data, const size_t length)
+		{
+			storages_.push_back(storage);
+			views_.emplace_back(data, length);
+		}
+
+		/**
+		 * @brief Removes a segment and releases its block.
+		 */
+		void Erase(const size_t index)
+		{
+			storages_[index]->Release();
+			storages_.erase(storages_.begin() + index);
+			views_.erase(views_.begin() + index);
+		}
+
+		/**
+		 * @brief Returns the space after the last segment that can be written in place.
+		 */
+		size_t WritableTailroom() const
+		{
+			if (storages_.empty() || !storages_.back()->unique())
+				return 0;
+
+			const Storage* storage = storages_.back();
+
+			return storage->memory + storage->capacity - (views_.back().data() + views_.back().size());
+		}
+
+		/**
+		 * @brief Replaces the first count segments with a single one holding a copy of their bytes.
+		 */
+		void Merge(const size_t count)
+		{
+			size_t length = 0;
+			for (size_t i = 0; i < count; ++i)
+				length += views_[i].size();
+
+			const size_t headroom = this->headroom();
+			Storage* storage = Storage::Allocate(headroom + length);
+			char* data = storage->memory + headroom;
+
+			size_t offset = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				std::memcpy(data + offset, views_[i].data(), views_[i].size());
+				offset += views_[i].size();
+				storages_[i]->Release();
+			}
+
+			storages_.erase(storages_.begin() + 1, storages_.begin() + count);
+			views_.erase(views_.begin() + 1, views_.begin() + count);
+			storages_[0] = storage;
+			views_[0] = ConstBuffer(data, length);
+		}
+
+	public:
+		/**
+		 * @brief Creates an empty chain with no segments.
+		 */
+		IOBuf() : size_(0) {}
+
+		IOBuf(IOBuf&& other) noexcept :
+			storages_(std::move(other.storages_)), views_(std::move(other.views_)), size_(std::exchange(other.size_, 0))
+		{
+			other.storages_.clear();
+			other.views_.clear();
+		}
+
+		IOBuf& operator=(IOBuf&& other) noexcept
+		{
+			if (this != &other)
+			{
+				clear();
+				storages_ = std::move(other.storages_);
+				views_ = std::move(other.views_);
+				size_ = std::exchange(other.size_, 0);
+				other.storages_.clear();
+				other.views_.clear();
+			}
+
+			return *this;
+		}
+
+		IOBuf(const IOBuf&) = delete;
+		IOBuf& operator=(const IOBuf&) = delete;
+
+		/**
+		 * @brief Releases every segment, freeing blocks no other chain views.
+		 */
+		~IOBuf()
+		{
+			clear();
+		}
+
+		/**
+		 * @brief Creates an empty chain with room to write into.
+		 *
+		 * @param {size_t} capacity - The size of the block, including the headroom.
+		 * @param {size_t} headroom - The space kept in front of the data for headers. Defaults to 0 if not specified.
+		 * @return {IOBuf} The chain, with a single empty segment.
+		 */
+		static IOBuf Create(const size_t capacity, const size_t headroom = 0)
+		{
+			IOBuf buffer;
+			Storage* storage = Storage::Allocate(std::max(capacity, headroom));
+			buffer.Push(storage, storage->memory + headroom, 0);
+
+			return buffer;
+		}
+
+		/**
+		 * @brief Creates a chain holding a copy of some data.
+		 *
+		 * @param {const void*} data - The data to copy.
+		 * @param {size_t} size - The size of the data.
+		 * @param {size_t} headroom - The space kept in front of the data. Defaults to 0 if not specified.
+		 * @param {size_t} tailroom - The space kept after the data. Defaults to 0 if not specified.
+		 * @return {IOBuf} The chain.
+		 */
+		static IOBuf Copy(const void* data, const size_t size, const size_t headroom = 0, const size_t tailroom = 0)
+		{
+			IOBuf buffer = Create(headroom + size + tailroom, headroom);
+			std::memcpy(buffer.Append(size), data, size);
+
+			return buffer;
+		}
+
+		/**
+		 * @brief Creates a chain viewing the contents of a pooled buffer, which returns to its pool once the chain
+		 * and every clone and split of it are gone.
+		 *
+		 * @param {PooledBuffer&&} pooled - The buffer, whose size is the length of the data.
+		 * @return {IOBuf} The chain.
+		 */
+		static IOBuf Wrap(PooledBuffer&& pooled)
+		{
+			IOBuf buffer;
+			const size_t size = pooled.size();
+			Storage* storage = Storage::Adopt(std::move(pooled));
+			buffer.Push(storage, storage->memory, size);
+			buffer.size_ = size;
+
+			return buffer;
+		}
+
+		/**
+		 * @brief Creates another chain viewing the same bytes, without copying them.
+		 *
+		 * @return {IOBuf} The clone.
+		 */
+		IOBuf Clone() const
+		{
+			IOBuf clone;
+			clone.storages_ = storages_;
+			clone.views_ = views_;
+			clone.size_ = size_;
+
+			for (Storage* storage : storages_)
+				storage->Retain();
+
+			return clone;
+		}
+
+		/**
+		 * @brief Removes the first bytes of the chain and returns them as a chain of their own, without copying them.
+		 *
+		 * @param {size_t} length - The number of bytes to split off, at most the size of the chain.
+		 * @return {IOBuf} The bytes split off.
+		 */
+		IOBuf Split(size_t length)
+		{
+			IOBuf front;
+			length = std::min(length, size_);
+
+			size_t whole = 0;
+			size_t taken = 0;
+			while (whole < views_.size() && taken + views_[whole].size() <= length)
+				taken += views_[whole++].size();
+
+			// Whole segments move over, a segment cut in two is shared by both chains.
+			front.storages_.assign(storages_.begin(), storages_.begin() + whole);
+			front.views_.assign(views_.begin(), views_.begin() + whole);
+			storages_.erase(storages_.begin(), storages_.begin() + whole);
+			views_.erase(views_.begin(), views_.begin() + whole);
+
+			if (taken < length)
+			{
+				const size_t cut = length - taken;
+				storages_[0]->Retain();
+				front.Push(storages_[0], views_[0].data(), cut);
+				views_[0] = ConstBuffer(views_[0].data() + cut, views_[0].size() - cut);
+			}
+
+			front.size_ = length;
+			size_ -= length;
+
+			return front;
+		}
+
+		/**
+		 * @brief Appends another chain to this one, taking over its segments.
+		 *
+		 * @param {IOBuf&&} other - The chain to append, left empty.
+		 */
+		void Append(IOBuf&& other)
+		{
+			// A trailing empty segment holds no data, only the room to write into.
+			if (!views_.empty() && views_.back().size() == 0)
+				Erase(views_.size() - 1);
+
+			storages_.insert(storages_.end(), other.storages_.begin(), other.storages_.end());
+			views_.insert(views_.end(), other.views_.begin(), other.views_.end());
+			size_ += std::exchange(other.size_, 0);
+			other.storages_.clear();
+			other.views_.clear();
+		}
+
+		/**
+		 * @brief Extends the chain at its end and returns the new bytes to be written.
+		 *
+		 * The tailroom of the last segment is used when it is large enough and not shared, otherwise a new block
+		 * of at least 4 KiB is chained on.
+		 *
+		 * @param {size_t} length - The number of bytes to add.
+		 * @return {char*} The added bytes.
+		 */
+		char* Append(const size_t length)
+		{
+			if (views_.empty() || WritableTailroom() < length)
+			{
+				if (!views_.empty() && views_.back().size() == 0)
+					Erase(views_.size() - 1);
+
+				Storage* storage = Storage::Allocate(std::max(length, MIN_CAPACITY));
+				Push(storage, storage->memory, 0);
+			}
+
+			ConstBuffer& last = views_.back();
+			char* data = const_cast<char*>(last.data()) + last.size();
+			last = ConstBuffer(last.data(), last.size() + length);
+			size_ += length;
+
+			return data;
+		}
+
+		/**
+		 * @brief Appends a copy of some data to the chain.
+		 *
+		 * @param {const void*} data - The data to copy.
+		 * @param {size_t} length - The size of the data.
+		 */
+		void Append(const void* data, const size_t length)
+		{
+			std::memcpy(Append(length), data, length);
+		}
+
+		/**
+		 * @brief Extends the chain at its front and returns the new bytes to be written, such as a frame header.
+		 *
+		 * The headroom of the first segment is used when it is large enough and not shared, otherwise a new block
+		 * is chained in front.
+		 *
+		 * @param {size_t} length - The number of bytes to add.
+		 * @return {char*} The added bytes.
+		 */
+		char* Prepend(const size_t length)
+		{
+			if (storages_.empty() || !storages_.front()->unique() || headroom() < length)
+			{
+				Storage* storage = Storage::Allocate(length);
+				storages_.insert(storages_.begin(), storage);
+				views_.insert(views_.begin(), ConstBuffer(storage->memory + length, 0));
+			}
+
+			ConstBuffer& first = views_.front();
+			first = ConstBuffer(first.data() - length, first.size() + length);
+			size_ += length;
+
+			return const_cast<char*>(first.data());
+		}
+
+		/**
+		 * @brief Drops bytes from the front of the chain.
+		 *
+		 * @param {size_t} length - The number of bytes to drop, at most the size of the chain.
+		 */
+		void TrimFront(size_t length)
+		{
+			length = std::min(length, size_);
+			size_ -= length;
+
+			while (length > 0)
+			{
+				const size_t cut = std::min(length, views_.front().size());
+				views_.front() = ConstBuffer(views_.front().data() + cut, views_.front().size() - cut);
+				length -= cut;
+
+				if (views_.front().size() == 0 && views_.size() > 1)
+					Erase(0);
+			}
+		}
+
+		/**
+		 * @brief Drops bytes from the end of the chain.
+		 *
+		 * @param {size_t} length - The number of bytes to drop, at most the size of the chain.
+		 */
+		void TrimBack(size_t length)
+		{
+			length = std::min(length, size_);
+			size_ -= length;
+
+			while (length > 0)
+			{
+				const size_t cut = std::min(length, views_.back().size());
+				views_.back() = ConstBuffer(views_.back().data(), views_.back().size() - cut);
+				length -= cut;
+
+				if (views_.back().size() == 0 && views_.size() > 1)
+					Erase(views_.size() - 1);
+			}
+		}
+
+		/**
+		 * @brief Makes the first bytes of the chain contiguous, copying only the segments they span.
+		 *
+		 * @param {size_t} length - The number of bytes to make contiguous, such as the size of a frame header.
+		 * @return {const char*} The first byte of the chain, or nullptr if the chain holds fewer bytes.
+		 */
+		const char* Gather(const size_t length)
+		{
+			if (length > size_ || views_.empty())
+				return nullptr;
+
+			size_t count = 0;
+			size_t spanned = 0;
+			while (spanned < length)
+				spanned += views_[count++].size();
+
+			if (count > 1)
+				Merge(count);
+
+			return views_.front().data();
+		}
+
+		/**
+		 * @brief Makes the whole chain contiguous.
+		 *
+		 * @return {const char*} The first byte of the chain, or nullptr if it is empty.
+		 */
+		const char* Coalesce()
+		{
+			if (views_.empty())
+				return nullptr;
+
+			if (views_.size() > 1)
+				Merge(views_.size());
+
+			return views_.front().data();
+		}
+
+		/**
+		 * @brief Returns a copy of the bytes of the chain.
+		 *
+		 * @return {std::string} The bytes of every segment, in order.
+		 */
+		std::string ToString() const
+		{
+			std::string result;
+			result.reserve(size_);
+
+			for (const ConstBuffer& view : views_)
+				result.append(view.data(), view.size());
+
+			return result;
+		}
+
+		/**
+		 * @brief Releases every segment, leaving the chain empty.
+		 */
+		void clear()
+		{
+			for (Storage* storage : storages_)
+				storage->Release();
+
+			storages_.clear();
+			views_.clear();
+			size_ = 0;
+		}
+
+		/**
+		 * @brief Returns the segments of the chain, as passed to Socket::SendV.
+		 *
+		 * @return {const std::vector<ConstBuffer>&} A view of each segment.
+		 */
+		const std::vector<ConstBuffer>& buffers() const
+		{
+			return views_;
+		}
+
+		/**
+		 * @brief Returns the number of bytes in the chain.
+		 *
+		 * @return {size_t} The number of bytes.
+		 */
+		size_t size() const
+		{
+			return size_;
+		}
+
+		/**
+		 * @brief Returns whether the chain holds no bytes.
+		 *
+		 * @return {bool} True if the chain is empty.
+		 */
+		bool empty() const
+		{
+			return size_ == 0;
+		}
+
+		/**
+		 * @brief Returns the number of segments in the chain.
+		 *
+		 * @return {size_t} The number of segments.
+		 */
+		size_t segments() const
+		{
+			return views_.size();
+		}
+
+		/**
+		 * @brief Returns the space in front of the first segment.
+		 *
+		 * @return {size_t} The headroom in bytes.
+		 */
+		size_t headroom() const
+		{
+			return views_.empty() ? 0 : (size_t)(views_.front().data() - storages_.front()->memory);
+		}
+
+		/**
+		 * @brief Returns the space after the last segment that can be appended to without allocating.
+		 *
+		 * @return {size_t} The tailroom in bytes, 0 if the last block is shared with another chain.
+		 */
+		size_t tailroom() const
+		{
+			return WritableTailroom();
+		}
+	};
+} // namespace netstack
+
+#endif // CPP_IOBUF_HPP
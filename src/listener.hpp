@@ -0,0 +1,187 @@
+#ifndef CPP_LISTENER_HPP
+#define CPP_LISTENER_HPP
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "netstack.h"
+#include "address.hpp"
+#include "socket.hpp"
+#include "option.hpp"
+
+namespace netstack
+{
+	/**
+	 * @brief The tunables of TcpListener::Listen.
+	 */
+	struct ListenerOptions
+	{
+		int backlog = SOMAXCONN;	///< The longest queue of connections waiting to be accepted, capped by net.core.somaxconn.
+		int deferAccept = 0;		///< Seconds the kernel holds a connection until its first data arrives, 0 to disable. Linux only.
+		bool reuseAddress = true;	///< Whether to bind over connections of a previous listener still in TIME_WAIT.
+		bool reusePort = false;		///< Whether other sockets may listen on the same address and share its connections.
+	};
+
+	/**
+	 * @brief A connection taken from a TcpListener and the address it came from.
+	 */
+	struct AcceptedConnection
+	{
+		Socket socket;	///< The connection, non-blocking and closed on exec.
+		Address peer;	///< The address of the peer.
+	};
+
+	/**
+	 * @brief A non-blocking TCP listening socket that drains its accept queue in batches.
+	 *
+	 * The listener is meant to be registered with a Reactor for readability, edge triggered or not, and to call
+	 * AcceptBatch when it is ready. Every connection comes out non-blocking and closed on exec in a single accept4
+	 * call on Linux, so no fcntl follows each accept.
+	 */
+	class TcpListener
+	{
+	private:
+		Socket socket_;		///< The listening socket, empty until Listen succeeds.
+		Address address_;	///< The bound address, with the port picked for port 0.
+
+	public:
+		/**
+		 * @brief Creates a listener that is not yet listening.
+		 */
+		TcpListener() = default;
+
+		/**
+		 * @brief Creates the listening socket, binds it to an address and starts listening.
+		 *
+		 * @param {const Address&} address - The local address and port. Port 0 picks an ephemeral port, see address().
+		 * @param {const ListenerOptions&} options - The backlog and socket options of the listener.
+		 * @returns {bool} - True if the listener is listening, otherwise nsSocketError tells why.
+		 */
+		bool Listen(const Address& address, const ListenerOptions& options = ListenerOptions())
+		{
+			const int family = address.name()->sa_family;
+#if defined(__linux__)
+			Socket listener(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+#else
+			Socket listener(family, SOCK_STREAM, IPPROTO_TCP);
+			if (listener && !listener.SetBlocking(false))
+				return false;
+#endif
+			if (!listener)
+				return false;
+
+			if (options.reuseAddress && !listener.SetOption(options::REUSE_ADDRESS, true))
+				return false;
+
+#if !defined(_WIN32)
+			if (options.reusePort && !listener.SetOption(options::REUSE_PORT, true))
+				return false;
+#endif
+			if (!listener.Bind(address) || !listener.Listen(options.backlog))
+				return false;
+
+#if defined(__linux__)
+			if (options.deferAccept > 0 && !listener.SetOption(options::DEFER_ACCEPT, options.deferAccept))
+				return false;
+#endif
+			address_ = listener.GetLocalAddress();
+			socket_ = std::move(listener);
+
+			return true;
+		}
+
+		/**
+		 * @brief Accepts the connections waiting in the queue until it is empty or a limit is reached.
+		 *
+		 * Connections reset by their peer while queued are skipped. A batch that ends early on an error other than an
+		 * empty queue, such as EMFILE when out of descriptors, keeps what it accepted and leaves the error in
+		 * nsSocketError, so the caller can tell it from EAGAIN.
+		 *
+		 * @param {std::vector<AcceptedConnection>&} connections - Receives the connections, appended after any it holds.
+		 * Reserving it up front keeps batches from allocating.
+		 * @param {size_t} max - The most connections to accept. Defaults to 64, so one busy listener cannot starve the
+		 * other sockets of an event loop.
+		 * @return {size_t} The number of connections accepted.
+		 */
+		size_t AcceptBatch(std::vector<AcceptedConnection>& connections, const size_t max = 64)
+		{
+			size_t accepted = 0;
+
+			while (accepted < max)
+			{
+				Address peer;
+				Socket connection = socket_.Accept(&peer, false);
+
+				if (connection)
+				{
+					connections.push_back({ std::move(connection), peer });
+					++accepted;
+					continue;
+				}
+
+				const int error = nsSocketError();
+#if defined(_WIN32)
+				if (error == WSAECONNRESET || error == WSAEINTR)
+					continue;
+#else
+				if (error == ECONNABORTED || error == EINTR)
+					continue;
+#endif
+				break;
+			}
+
+			return accepted;
+		}
+
+		/**
+		 * @brief Accepts a single waiting connection.
+		 *
+		 * @param {Address*} peer - Receives the address of the peer. Defaults to nullptr if not needed.
+		 * @return {Socket} The non-blocking connection, which is empty if none was waiting.
+		 */
+		Socket Accept(Address* peer = nullptr)
+		{
+			return socket_.Accept(peer, false);
+		}
+
+		/**
+		 * @brief Stops listening, refusing connections still in the queue.
+		 */
+		void Close()
+		{
+			socket_.reset();
+		}
+
+		/**
+		 * @brief Returns whether the listener is listening.
+		 */
+		explicit operator bool() const
+		{
+			return (bool)socket_;
+		}
+
+		/**
+		 * @brief Returns the address the listener is bound to.
+		 *
+		 * @return {const Address&} The local address, with its port filled in.
+		 */
+		const Address& address() const
+		{
+			return address_;
+		}
+
+		/**
+		 * @brief Returns the listening socket, such as to register it with a Reactor.
+		 *
+		 * @return {Socket&} The listening socket.
+		 */
+		Socket& socket()
+		{
+			return socket_;
+		}
+	};
+} // namespace netstack
+
+#endif // CPP_LISTENER_HPP
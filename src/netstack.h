@@ -26,6 +26,7 @@ extern "C" {
     #include <arpa/inet.h>
     #include <netdb.h>
     #include <unistd.h>
+    #include <fcntl.h>
     #include <errno.h>
 #endif
 
@@ -1,2 +1,22 @@
 #include "socket.hpp"
-#include "address.hpp"
\ No newline at end of file
+#include "option.hpp"
+#include "text.hpp"
+#include "address.hpp"
+#include "connect.hpp"
+#include "listener.hpp"
+#include "session.hpp"
+#include "batch.hpp"
+#include "buffer.hpp"
+#include "pipe.hpp"
+#include "pool.hpp"
+#include "table.hpp"
+#include "ring.hpp"
+#include "iobuf.hpp"
+#include "zerocopy.hpp"
+#include "capture.hpp"
+#include "timer.hpp"
+#include "reactor.hpp"
+#include "resolver.hpp"
+#include "proactor.hpp"
+#include "coroutine.hpp"
+#include "server.hpp"
\ No newline at end of file
@@ -0,0 +1,258 @@
+#ifndef CPP_OPTION_HPP
+#define CPP_OPTION_HPP
+
+#include <tuple>
+#include <chrono>
+#include <utility>
+#include <type_traits>
+
+#include "netstack.h"
+
+#if !defined(_WIN32)
+#include <netinet/tcp.h>
+#endif
+#if defined(__linux__)
+#include <netinet/udp.h>
+#endif
+
+namespace netstack
+{
+	/**
+	 * @brief Whether an option can be changed, or only read.
+	 */
+	enum class OptionAccess
+	{
+		READ_WRITE,	///< The option can be set and read.
+		READ_ONLY,	///< The option reports state and can only be read.
+	};
+
+	/**
+	 * @brief Converts the value of an option to and from the representation passed to setsockopt and getsockopt.
+	 *
+	 * Values are passed as they are by default.
+	 */
+	template <typename T>
+	struct OptionTraits
+	{
+		using Native = T;
+
+		static Native Encode(const T& value) { return value; }
+		static T Decode(const Native& value) { return value; }
+	};
+
+	/**
+	 * @brief Boolean options are passed as an int.
+	 */
+	template <>
+	struct OptionTraits<bool>
+	{
+		using Native = int;
+
+		static Native Encode(const bool value) { return value ? 1 : 0; }
+		static bool Decode(const Native value) { return value != 0; }
+	};
+
+	/**
+	 * @brief Timeouts are passed as a timeval, or as milliseconds in a DWORD on Windows.
+	 */
+	template <>
+	struct OptionTraits<std::chrono::milliseconds>
+	{
+#if defined(_WIN32)
+		using Native = DWORD;
+
+		static Native Encode(const std::chrono::milliseconds value) { return (DWORD)value.count(); }
+		static std::chrono::milliseconds Decode(const Native value) { return std::chrono::milliseconds(value); }
+#else
+		using Native = timeval;
+
+		static Native Encode(const std::chrono::milliseconds value)
+		{
+			return timeval{ (time_t)(value.count() / 1000), (suseconds_t)(value.count() % 1000 * 1000) };
+		}
+
+		static std::chrono::milliseconds Decode(const Native& value)
+		{
+			return std::chrono::milliseconds((int64_t)value.tv_sec * 1000 + value.tv_usec / 1000);
+		}
+#endif
+	};
+
+	template <typename T, OptionAccess A>
+	struct OptionSetting;
+
+	/**
+	 * @brief Enables a function taking the value of an option only for values of exactly its type, so that a value
+	 * which merely converts to it, such as 3.7 or true for an int option, fails to compile rather than being narrowed.
+	 */
+	template <typename T, typename U>
+	using EnableIfOptionValue = typename std::enable_if<std::is_same<typename std::decay<U>::type, T>::value>::type;
+
+	/**
+	 * @brief Describes a socket option by its level, name and value type, so that reading or writing it with the
+	 * wrong type, or writing a read-only option, fails to compile.
+	 */
+	template <typename T, OptionAccess A = OptionAccess::READ_WRITE>
+	struct SocketOption
+	{
+		using value_type = T;
+
+		int level;	///< The protocol level of the option (e.g. SOL_SOCKET, IPPROTO_TCP).
+		int name;	///< The name of the option at its level (e.g. SO_RCVBUF).
+
+		/**
+		 * @brief Pairs the option with a value, for use in an OptionProfile.
+		 *
+		 * @param {T} value - The value to set the option to.
+		 * @return {OptionSetting} The option and value.
+		 */
+		template <typename U, typename = EnableIfOptionValue<T, U>>
+		constexpr OptionSetting<T, A> operator()(const U value) const
+		{
+			return OptionSetting<T, A>{ *this, value };
+		}
+	};
+
+	/**
+	 * @brief An option together with the value to set it to.
+	 */
+	template <typename T, OptionAccess A>
+	struct OptionSetting
+	{
+		static_assert(A == OptionAccess::READ_WRITE, "Read-only options cannot be set.");
+
+		SocketOption<T, A> option;	///< The option to set.
+		T value;					///< The value to set it to.
+	};
+
+	/**
+	 * @brief Sets an option on a SOCKET handle.
+	 *
+	 * @param {SOCKET} socket - The SOCKET handle.
+	 * @param {const SocketOption&} option - The option to set.
+	 * @param {T} value - The value to set the option to.
+	 * @return {bool} True if the option was set.
+	 */
+	template <typename T, OptionAccess A, typename U, typename = EnableIfOptionValue<T, U>>
+	bool SetOption(const SOCKET socket, const SocketOption<T, A>& option, const U& value)
+	{
+		static_assert(A == OptionAccess::READ_WRITE, "Read-only options cannot be set.");
+
+		const typename OptionTraits<T>::Native native = OptionTraits<T>::Encode(value);
+
+		return setsockopt(socket, option.level, option.name, (const char*)&native, sizeof(native)) == 0;
+	}
+
+	/**
+	 * @brief Reads an option of a SOCKET handle.
+	 *
+	 * @param {SOCKET} socket - The SOCKET handle.
+	 * @param {const SocketOption&} option - The option to read.
+	 * @param {T&} value - Receives the value of the option.
+	 * @return {bool} True if the option was read.
+	 */
+	template <typename T, OptionAccess A, typename U, typename = EnableIfOptionValue<T, U>>
+	bool GetOption(const SOCKET socket, const SocketOption<T, A>& option, U& value)
+	{
+		typename OptionTraits<T>::Native native{};
+		socklen_t length = sizeof(native);
+
+		if (getsockopt(socket, option.level, option.name, (char*)&native, &length) != 0)
+			return false;
+
+		value = OptionTraits<T>::Decode(native);
+
+		return true;
+	}
+
+	/**
+	 * @brief A fixed set of option values applied to a socket in one call.
+	 */
+	template <typename... Settings>
+	struct OptionProfile
+	{
+		std::tuple<Settings...> settings;	///< The options and their values, applied in order.
+
+		constexpr OptionProfile(const Settings... settings) : settings(settings...) {}
+
+		/**
+		 * @brief Sets every option of the profile on a SOCKET handle.
+		 *
+		 * Options the platform or the process is not allowed to set are skipped, the others are still applied.
+		 *
+		 * @param {SOCKET} socket - The SOCKET handle.
+		 * @return {bool} True if every option was set.
+		 */
+		bool Apply(const SOCKET socket) const
+		{
+			return std::apply([socket](const Settings&... setting) {
+				bool applied = true;
+				((applied &= SetOption(socket, setting.option, setting.value)), ...);
+
+				return applied;
+			}, settings);
+		}
+	};
+
+	/**
+	 * @brief Descriptors of common socket options.
+	 */
+	namespace options
+	{
+		constexpr SocketOption<bool> REUSE_ADDRESS{ SOL_SOCKET, SO_REUSEADDR };		///< Allows binding an address in TIME_WAIT.
+		constexpr SocketOption<bool> KEEP_ALIVE{ SOL_SOCKET, SO_KEEPALIVE };		///< Probes idle connections.
+		constexpr SocketOption<bool> BROADCAST{ SOL_SOCKET, SO_BROADCAST };			///< Allows sending datagrams to broadcast addresses.
+		constexpr SocketOption<int> RECEIVE_BUFFER{ SOL_SOCKET, SO_RCVBUF };		///< The size of the kernel receive buffer in bytes.
+		constexpr SocketOption<int> SEND_BUFFER{ SOL_SOCKET, SO_SNDBUF };			///< The size of the kernel send buffer in bytes.
+		constexpr SocketOption<linger> LINGER{ SOL_SOCKET, SO_LINGER };				///< How close treats unsent data, {1, 0} resets the connection.
+		constexpr SocketOption<std::chrono::milliseconds> RECEIVE_TIMEOUT{ SOL_SOCKET, SO_RCVTIMEO };	///< The longest a blocking receive waits.
+		constexpr SocketOption<std::chrono::milliseconds> SEND_TIMEOUT{ SOL_SOCKET, SO_SNDTIMEO };		///< The longest a blocking send waits.
+		constexpr SocketOption<int, OptionAccess::READ_ONLY> PENDING_ERROR{ SOL_SOCKET, SO_ERROR };		///< Reads and clears the pending error.
+		constexpr SocketOption<int, OptionAccess::READ_ONLY> TYPE{ SOL_SOCKET, SO_TYPE };				///< The SocketType of the socket.
+		constexpr SocketOption<bool> NO_DELAY{ IPPROTO_TCP, TCP_NODELAY };			///< Sends small segments without waiting to coalesce them.
+#if !defined(_WIN32)
+		constexpr SocketOption<bool> REUSE_PORT{ SOL_SOCKET, SO_REUSEPORT };		///< Lets several sockets bind the same address and share its traffic.
+#endif
+#if defined(__linux__)
+		constexpr SocketOption<int> BUSY_POLL{ SOL_SOCKET, SO_BUSY_POLL };			///< Microseconds to busy poll the device when a receive would block.
+		constexpr SocketOption<int> PRIORITY{ SOL_SOCKET, SO_PRIORITY };			///< The queueing priority of outgoing packets.
+		constexpr SocketOption<bool> QUICK_ACK{ IPPROTO_TCP, TCP_QUICKACK };		///< Acknowledges right away rather than delaying.
+		constexpr SocketOption<bool> CORK{ IPPROTO_TCP, TCP_CORK };					///< Holds partial segments until uncorked.
+		constexpr SocketOption<int> NOT_SENT_LOW_WATERMARK{ IPPROTO_TCP, TCP_NOTSENT_LOWAT };	///< Limits unsent data before the socket stops being writable.
+		constexpr SocketOption<int> DEFER_ACCEPT{ IPPROTO_TCP, TCP_DEFER_ACCEPT };	///< Seconds to hold a connection until its first data arrives.
+		constexpr SocketOption<int> INCOMING_CPU{ SOL_SOCKET, SO_INCOMING_CPU };	///< The CPU that processes the packets of the socket.
+#endif
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+		constexpr SocketOption<bool> ZERO_COPY{ SOL_SOCKET, SO_ZEROCOPY };			///< Allows sends with MSG_ZEROCOPY.
+#endif
+#if defined(__linux__) && defined(UDP_SEGMENT) && defined(UDP_GRO)
+		constexpr SocketOption<int> SEGMENT_SIZE{ IPPROTO_UDP, UDP_SEGMENT };		///< Splits every UDP send into datagrams of this size, 0 to disable.
+		constexpr SocketOption<bool> RECEIVE_OFFLOAD{ IPPROTO_UDP, UDP_GRO };		///< Delivers runs of UDP datagrams coalesced into one buffer.
+#endif
+	}
+
+	/**
+	 * @brief Socket presets, applied with Socket::ApplyProfile.
+	 */
+	namespace profiles
+	{
+		/**
+		 * @brief Favours the latency of small messages: no Nagle delay, immediate acknowledgements and a small unsent
+		 * backlog. Busy polling is left out, as setting it needs CAP_NET_ADMIN; set options::BUSY_POLL on its own.
+		 */
+#if defined(__linux__)
+		constexpr OptionProfile LOW_LATENCY(options::NO_DELAY(true), options::QUICK_ACK(true),
+			options::NOT_SENT_LOW_WATERMARK(16 * 1024));
+#else
+		constexpr OptionProfile LOW_LATENCY(options::NO_DELAY(true));
+#endif
+
+		/**
+		 * @brief Favours bulk transfers: large kernel buffers and full segments.
+		 */
+		constexpr OptionProfile THROUGHPUT(options::NO_DELAY(false), options::RECEIVE_BUFFER(4 * 1024 * 1024),
+			options::SEND_BUFFER(4 * 1024 * 1024));
+	}
+} // namespace netstack
+
+#endif // CPP_OPTION_HPP
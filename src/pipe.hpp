@@ -0,0 +1,99 @@
+#ifndef CPP_PIPE_HPP
+#define CPP_PIPE_HPP
+
+#include <cstddef>
+
+#include "netstack.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace netstack
+{
+	/**
+	 * @brief A kernel pipe used by Socket::Splice to move data between sockets without copying it to user space.
+	 *
+	 * Data spliced in from the source but not yet accepted by the destination stays in the pipe and is delivered
+	 * first by the next Splice, so a pipe belongs to one forwarding direction at a time.
+	 */
+	class SplicePipe
+	{
+		friend class Socket;
+	private:
+		int read_;			///< The read end of the pipe.
+		int write_;			///< The write end of the pipe.
+		size_t capacity_;	///< The size of the pipe buffer.
+		size_t pending_;	///< The bytes spliced in and not yet spliced out.
+
+	public:
+		/**
+		 * @brief Creates a pipe.
+		 *
+		 * @param {size_t} capacity - The size of the pipe buffer to request, limited by /proc/sys/fs/pipe-max-size
+		 * for unprivileged processes. Defaults to 1 MiB if not specified.
+		 */
+		SplicePipe(const size_t capacity = 1024 * 1024) : read_(-1), write_(-1), capacity_(0), pending_(0)
+		{
+			int ends[2];
+
+			// Both ends block, so the blocking mode of the sockets alone decides whether a splice waits.
+			if (pipe2(ends, O_CLOEXEC) != 0)
+				return;
+
+			read_ = ends[0];
+			write_ = ends[1];
+
+			// The kernel rounds the size up to whole pages, and may refuse it, leaving the default.
+			fcntl(write_, F_SETPIPE_SZ, (int)capacity);
+			const int size = fcntl(write_, F_GETPIPE_SZ);
+			capacity_ = size > 0 ? (size_t)size : 64 * 1024;
+		}
+
+		SplicePipe(const SplicePipe&) = delete;
+		SplicePipe& operator=(const SplicePipe&) = delete;
+
+		/**
+		 * @brief Closes both ends of the pipe, dropping any data still in it.
+		 */
+		~SplicePipe()
+		{
+			if (read_ >= 0)
+				close(read_);
+			if (write_ >= 0)
+				close(write_);
+		}
+
+		/**
+		 * @brief Returns whether the pipe was created successfully.
+		 */
+		explicit operator bool() const
+		{
+			return read_ >= 0 && write_ >= 0;
+		}
+
+		/**
+		 * @brief Returns the size of the pipe buffer.
+		 *
+		 * @return {size_t} The most bytes moved by a single splice.
+		 */
+		size_t capacity() const
+		{
+			return capacity_;
+		}
+
+		/**
+		 * @brief Returns the bytes read from a source that the destination has not accepted yet.
+		 *
+		 * @return {size_t} The bytes held by the pipe.
+		 */
+		size_t pending() const
+		{
+			return pending_;
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__
+
+#endif // CPP_PIPE_HPP
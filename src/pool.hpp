@@ -0,0 +1,542 @@
+#ifndef CPP_POOL_HPP
+#define CPP_POOL_HPP
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+#include "netstack.h"
+#include "buffer.hpp"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+namespace netstack
+{
+	class BufferPool;
+
+	/**
+	 * @brief A buffer drawn from a BufferPool, returned to it when destroyed.
+	 *
+	 * The buffer has a fixed capacity and a size, which receives set to the number of bytes received. It converts to
+	 * a MutableBuffer over its whole capacity and to a ConstBuffer over its contents.
+	 */
+	class PooledBuffer
+	{
+		friend class BufferPool;
+	private:
+		BufferPool* pool_;	///< The pool the buffer returns to, or null if empty.
+		char* data_;		///< The memory of the buffer.
+		size_t capacity_;	///< The size of the memory.
+		size_t size_;		///< The number of bytes held.
+
+		PooledBuffer(BufferPool* pool, char* data, const size_t capacity) : pool_(pool), data_(data), capacity_(capacity), size_(0) {}
+
+	public:
+		/**
+		 * @brief Creates an empty buffer, which holds no memory.
+		 */
+		PooledBuffer() : pool_(nullptr), data_(nullptr), capacity_(0), size_(0) {}
+
+		PooledBuffer(PooledBuffer&& other) noexcept :
+			pool_(std::exchange(other.pool_, nullptr)), data_(std::exchange(other.data_, nullptr)),
+			capacity_(std::exchange(other.capacity_, 0)), size_(std::exchange(other.size_, 0)) {}
+
+		PooledBuffer& operator=(PooledBuffer&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				pool_ = std::exchange(other.pool_, nullptr);
+				data_ = std::exchange(other.data_, nullptr);
+				capacity_ = std::exchange(other.capacity_, 0);
+				size_ = std::exchange(other.size_, 0);
+			}
+
+			return *this;
+		}
+
+		PooledBuffer(const PooledBuffer&) = delete;
+		PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+		/**
+		 * @brief Returns the buffer to its pool.
+		 */
+		~PooledBuffer()
+		{
+			reset();
+		}
+
+		/**
+		 * @brief Returns the buffer to its pool now, leaving this one empty.
+		 */
+		void reset();
+
+		/**
+		 * @brief Returns whether the buffer holds memory, which it does not if the pool was exhausted.
+		 */
+		explicit operator bool() const
+		{
+			return data_ != nullptr;
+		}
+
+		/**
+		 * @brief Returns a view of the whole memory of the buffer, to receive into.
+		 */
+		operator MutableBuffer() const
+		{
+			return MutableBuffer(data_, capacity_);
+		}
+
+		/**
+		 * @brief Returns a view of the bytes held by the buffer, to send from.
+		 */
+		operator ConstBuffer() const
+		{
+			return ConstBuffer(data_, size_);
+		}
+
+		/**
+		 * @brief Returns a pointer to the memory of the buffer.
+		 *
+		 * @return {char*} The memory of the buffer.
+		 */
+		char* data() const
+		{
+			return data_;
+		}
+
+		/**
+		 * @brief Returns the number of bytes held by the buffer.
+		 *
+		 * @return {size_t} The number of bytes held.
+		 */
+		size_t size() const
+		{
+			return size_;
+		}
+
+		/**
+		 * @brief Sets the number of bytes held by the buffer.
+		 *
+		 * @param {size_t} size - The number of bytes held, at most the capacity.
+		 */
+		void resize(const size_t size)
+		{
+			size_ = size < capacity_ ? size : capacity_;
+		}
+
+		/**
+		 * @brief Returns the size of the memory of the buffer.
+		 *
+		 * @return {size_t} The capacity of the buffer.
+		 */
+		size_t capacity() const
+		{
+			return capacity_;
+		}
+	};
+
+	/**
+	 * @brief Fixed-size buffers carved out of large slabs, shared by every socket and event loop of a process.
+	 *
+	 * Each thread keeps a small free list of its own, so acquiring and releasing a buffer takes no lock and no
+	 * allocation once the pool has warmed up. Threads trade buffers with a shared list in batches when their own
+	 * list runs empty or grows too long, and a new slab is mapped when a thread finds both its own list and the
+	 * shared list empty. The lists of other threads are never drawn on, so up to 2 * BATCH - 1 free buffers per
+	 * thread may sit idle while a slab is mapped, or while Acquire fails at the slab limit. Slabs can be backed by
+	 * huge pages to save TLB misses on large pools. Slabs are only unmapped when the pool is destroyed, which must
+	 * not happen before every buffer has been released.
+	 */
+	class BufferPool
+	{
+		friend class PooledBuffer;
+	private:
+		static constexpr size_t THREAD_SLOTS = 64;		///< The number of threads with a free list of their own.
+		static constexpr size_t BATCH = 32;				///< The number of buffers moved to or from the shared list at once.
+		static constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;	///< The size slabs are rounded up to when backed by huge pages.
+
+		/**
+		 * @brief A free buffer, linked into a free list.
+		 */
+		struct Block
+		{
+			Block* next;	///< The next free buffer.
+		};
+
+		/**
+		 * @brief The free list of one thread, on a cache line of its own.
+		 */
+		struct alignas(64) Cache
+		{
+			Block* head = nullptr;	///< The first free buffer.
+			size_t count = 0;		///< The number of free buffers.
+		};
+
+		/**
+		 * @brief A mapped slab.
+		 */
+		struct Slab
+		{
+			void* memory;	///< The start of the slab.
+			size_t size;	///< The size of the mapping.
+		};
+
+		/**
+		 * @brief Hands out thread slots, reusing those of threads that have exited.
+		 */
+		class ThreadSlot
+		{
+		private:
+			size_t index_;	///< The slot of the calling thread.
+
+			static std::mutex& Lock()
+			{
+				static std::mutex lock;
+
+				return lock;
+			}
+
+			static std::vector<size_t>& Free()
+			{
+				static std::vector<size_t> free;
+
+				return free;
+			}
+
+		public:
+			ThreadSlot()
+			{
+				static size_t next = 0;
+				std::lock_guard<std::mutex> guard(Lock());
+
+				if (Free().empty())
+					index_ = next++;
+				else
+				{
+					index_ = Free().back();
+					Free().pop_back();
+				}
+			}
+
+			// The list left behind is still valid, and is adopted by the next thread given the slot.
+			~ThreadSlot()
+			{
+				std::lock_guard<std::mutex> guard(Lock());
+				Free().push_back(index_);
+			}
+
+			static size_t Current()
+			{
+				thread_local ThreadSlot slot;
+
+				return slot.index_;
+			}
+		};
+
+		size_t bufferSize_;					///< The size of every buffer.
+		size_t buffersPerSlab_;				///< The number of buffers carved out of each slab.
+		size_t maxSlabs_;					///< The most slabs to map, or 0 for no limit.
+		bool hugePages_;					///< Whether slabs are requested on huge pages.
+		std::unique_ptr<Cache[]> caches_;	///< The free list of each thread slot.
+		std::mutex lock_;					///< Guards the shared list and the slabs.
+		Block* shared_;						///< The free buffers shared by every thread.
+		size_t sharedCount_;				///< The number of buffers in the shared list.
+		std::vector<Slab> slabs_;			///< Every slab mapped.
+		std::atomic<size_t> capacity_;		///< The number of buffers in every slab.
+		std::atomic<size_t> used_;			///< The number of buffers acquired and not yet released.
+		std::atomic<size_t> hugeSlabs_;		///< The number of slabs backed by huge pages.
+
+		/**
+		 * @brief Maps a new slab and links its buffers into the shared list. The lock must be held.
+		 */
+		bool Grow()
+		{
+			if (maxSlabs_ != 0 && slabs_.size() >= maxSlabs_)
+				return false;
+
+			size_t size = bufferSize_ * buffersPerSlab_;
+			void* memory = nullptr;
+			bool huge = false;
+#if defined(_WIN32)
+			memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+#if defined(MAP_HUGETLB)
+			if (hugePages_)
+			{
+				const size_t hugeSize = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+				memory = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if (memory == MAP_FAILED)
+					memory = nullptr;
+				else
+				{
+					size = hugeSize;
+					huge = true;
+				}
+			}
+#endif
+			// Without reserved huge pages, transparent huge pages are the next best thing.
+			if (memory == nullptr)
+			{
+				memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (memory == MAP_FAILED)
+					memory = nullptr;
+#if defined(MADV_HUGEPAGE)
+				else if (hugePages_)
+					madvise(memory, size, MADV_HUGEPAGE);
+#endif
+			}
+#endif
+			if (memory == nullptr)
+				return false;
+
+			slabs_.push_back({ memory, size });
+
+			// A huge page slab may fit more buffers than asked for.
+			const size_t count = size / bufferSize_;
+			char* start = (char*)memory;
+			for (size_t i = count; i-- > 0;)
+			{
+				Block* block = (Block*)(start + i * bufferSize_);
+				block->next = shared_;
+				shared_ = block;
+			}
+
+			sharedCount_ += count;
+			capacity_.fetch_add(count, std::memory_order_relaxed);
+			if (huge)
+				hugeSlabs_.fetch_add(1, std::memory_order_relaxed);
+
+			return true;
+		}
+
+		/**
+		 * @brief Takes a buffer from the shared list, mapping a new slab if it is empty. The lock must be held.
+		 */
+		Block* TakeShared()
+		{
+			if (shared_ == nullptr && !Grow())
+				return nullptr;
+
+			Block* block = shared_;
+			shared_ = block->next;
+			--sharedCount_;
+
+			return block;
+		}
+
+		/**
+		 * @brief Acquires free memory for a buffer, or null if the pool is exhausted.
+		 */
+		char* Take()
+		{
+			const size_t slot = ThreadSlot::Current();
+			if (slot >= THREAD_SLOTS)
+			{
+				std::lock_guard<std::mutex> guard(lock_);
+
+				return (char*)TakeShared();
+			}
+
+			Cache& cache = caches_[slot];
+			if (cache.head == nullptr)
+			{
+				// Refills the list of the thread with a batch, leaving the first buffer out for the caller.
+				std::lock_guard<std::mutex> guard(lock_);
+
+				Block* first = TakeShared();
+				if (first == nullptr)
+					return nullptr;
+
+				while (cache.count < BATCH && shared_ != nullptr)
+				{
+					Block* block = TakeShared();
+					block->next = cache.head;
+					cache.head = block;
+					++cache.count;
+				}
+
+				return (char*)first;
+			}
+
+			Block* block = cache.head;
+			cache.head = block->next;
+			--cache.count;
+
+			return (char*)block;
+		}
+
+		/**
+		 * @brief Returns the memory of a buffer to the list of the calling thread.
+		 */
+		void Give(char* data)
+		{
+			Block* block = (Block*)data;
+			const size_t slot = ThreadSlot::Current();
+
+			if (slot >= THREAD_SLOTS)
+			{
+				std::lock_guard<std::mutex> guard(lock_);
+				block->next = shared_;
+				shared_ = block;
+				++sharedCount_;
+			}
+			else
+			{
+				Cache& cache = caches_[slot];
+				block->next = cache.head;
+				cache.head = block;
+
+				// A thread that mostly releases hands the surplus back, so other threads can draw on it.
+				if (++cache.count >= BATCH * 2)
+				{
+					std::lock_guard<std::mutex> guard(lock_);
+					for (size_t i = 0; i < BATCH; ++i)
+					{
+						Block* surplus = cache.head;
+						cache.head = surplus->next;
+						surplus->next = shared_;
+						shared_ = surplus;
+					}
+
+					cache.count -= BATCH;
+					sharedCount_ += BATCH;
+				}
+			}
+
+			used_.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+	public:
+		/**
+		 * @brief Creates a pool. No memory is mapped until the first buffer is acquired.
+		 *
+		 * @param {size_t} bufferSize - The size of every buffer, rounded up to a multiple of 64 bytes. Defaults to 16 KiB.
+		 * @param {size_t} buffersPerSlab - The number of buffers mapped at once. Defaults to 128.
+		 * @param {bool} hugePages - Whether to back slabs by huge pages, falling back to transparent huge pages when
+		 * none are reserved. Defaults to false.
+		 * @param {size_t} maxSlabs - The most slabs to map before Acquire fails, or 0 for no limit. Defaults to 0.
+		 */
+		BufferPool(const size_t bufferSize = 16 * 1024, const size_t buffersPerSlab = 128, const bool hugePages = false, const size_t maxSlabs = 0) :
+			bufferSize_((std::max(bufferSize, sizeof(Block)) + 63) / 64 * 64), buffersPerSlab_(std::max<size_t>(buffersPerSlab, 1)),
+			maxSlabs_(maxSlabs), hugePages_(hugePages), caches_(new Cache[THREAD_SLOTS]), shared_(nullptr), sharedCount_(0),
+			capacity_(0), used_(0), hugeSlabs_(0) {}
+
+		BufferPool(const BufferPool&) = delete;
+		BufferPool& operator=(const BufferPool&) = delete;
+
+		/**
+		 * @brief Unmaps every slab.
+		 */
+		~BufferPool()
+		{
+			for (const Slab& slab : slabs_)
+			{
+#if defined(_WIN32)
+				VirtualFree(slab.memory, 0, MEM_RELEASE);
+#else
+				munmap(slab.memory, slab.size);
+#endif
+			}
+		}
+
+		/**
+		 * @brief Draws a buffer from the pool.
+		 *
+		 * @return {PooledBuffer} The buffer, which is empty if the pool has reached its slab limit or mapping failed.
+		 * It may be empty even while other threads hold free buffers in their own lists.
+		 */
+		PooledBuffer Acquire()
+		{
+			char* data = Take();
+			if (data == nullptr)
+				return PooledBuffer();
+
+			used_.fetch_add(1, std::memory_order_relaxed);
+
+			return PooledBuffer(this, data, bufferSize_);
+		}
+
+		/**
+		 * @brief Returns the size of every buffer.
+		 *
+		 * @return {size_t} The size of a buffer in bytes.
+		 */
+		size_t bufferSize() const
+		{
+			return bufferSize_;
+		}
+
+		/**
+		 * @brief Returns the number of buffers mapped so far, free or not.
+		 *
+		 * @return {size_t} The number of buffers.
+		 */
+		size_t capacity() const
+		{
+			return capacity_.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Returns the number of buffers acquired and not yet released.
+		 *
+		 * @return {size_t} The number of buffers in use.
+		 */
+		size_t used() const
+		{
+			return used_.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Returns the share of mapped buffers in use.
+		 *
+		 * @return {double} The occupancy, between 0 and 1.
+		 */
+		double occupancy() const
+		{
+			const size_t total = capacity();
+
+			return total == 0 ? 0.0 : (double)used() / total;
+		}
+
+		/**
+		 * @brief Returns the number of slabs mapped so far.
+		 *
+		 * @return {size_t} The number of slabs.
+		 */
+		size_t slabs()
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+
+			return slabs_.size();
+		}
+
+		/**
+		 * @brief Returns the number of slabs backed by reserved huge pages.
+		 *
+		 * @return {size_t} The number of huge page slabs.
+		 */
+		size_t hugeSlabs() const
+		{
+			return hugeSlabs_.load(std::memory_order_relaxed);
+		}
+	};
+
+	inline void PooledBuffer::reset()
+	{
+		if (pool_ != nullptr)
+			pool_->Give(data_);
+
+		pool_ = nullptr;
+		data_ = nullptr;
+		capacity_ = 0;
+		size_ = 0;
+	}
+} // namespace netstack
+
+#endif // CPP_POOL_HPP
@@ -0,0 +1,992 @@
+#ifndef CPP_PROACTOR_HPP
+#define CPP_PROACTOR_HPP
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "netstack.h"
+#include "address.hpp"
+#include "buffer.hpp"
+#include "socket.hpp"
+#include "reactor.hpp"
+
+#if defined(__linux__)
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define NS_HAS_IO_URING 1
+#endif
+
+namespace netstack
+{
+	/**
+	 * @brief An asynchronous operation submitted to a Proactor, notified once it has completed.
+	 *
+	 * Operations are owned by the caller and must stay alive, together with their buffers and addresses, until
+	 * OnComplete has been called. An operation can be resubmitted from within its own OnComplete.
+	 */
+	class Operation
+	{
+		friend class Proactor;
+	private:
+		/**
+		 * @brief The kind of an operation.
+		 */
+		enum class Type : uint8_t
+		{
+			RECEIVE,
+			SEND,
+			ACCEPT,
+			CONNECT,
+		};
+
+		Type type_;				///< The kind of the operation.
+		Socket* socket_;		///< The socket the operation runs on.
+		char* buffer_;			///< The buffer to receive into or send from.
+		size_t length_;			///< The length of the buffer.
+		int flags_;				///< The flags of the receive or send.
+		int bufferIndex_;		///< The registered buffer the buffer lies in, or -1.
+		Address* address_;		///< The peer of an accept, or the destination of a connect.
+
+	public:
+		virtual ~Operation() = default;
+
+		/**
+		 * @brief Called on the thread running the Proactor once the operation has completed.
+		 *
+		 * @param {int} result - The number of bytes transferred, the accepted SOCKET handle or 0 for a connect on
+		 * success, or a negated error code (e.g. -ECONNRESET) on failure.
+		 */
+		virtual void OnComplete(int result) = 0;
+	};
+
+	/**
+	 * @brief An operation that forwards its completion to a callable.
+	 */
+	template <typename Callback>
+	class CallbackOperation : public Operation
+	{
+	private:
+		Callback callback_;	///< Invoked with the result of the operation.
+
+	public:
+		/**
+		 * @brief Creates an operation.
+		 *
+		 * @param {Callback} callback - Invoked with the result of the operation.
+		 */
+		CallbackOperation(Callback callback) : callback_(std::move(callback)) {}
+
+		void OnComplete(const int result) override
+		{
+			callback_(result);
+		}
+	};
+
+	/**
+	 * @brief A completion based I/O engine for sockets.
+	 *
+	 * Receives, sends, accepts and connects are queued and submitted to io_uring together, then their completions
+	 * are dispatched by RunOnce or Run. Registered buffers and registered sockets avoid the per operation cost of
+	 * pinning pages and looking up file descriptors.
+	 *
+	 * When io_uring is unavailable, or lacks one of the required operations, the same API is served by a Reactor
+	 * that performs each operation once its socket is ready. Registration calls then succeed without effect, and each
+	 * socket can have one receive or accept and one send or connect pending at a time.
+	 */
+	class Proactor : private Handler
+	{
+	private:
+		/**
+		 * @brief The operations waiting for readiness on one socket, used without io_uring.
+		 */
+		struct Pending
+		{
+			Operation* reading;		///< A pending receive or accept.
+			Operation* writing;		///< A pending send or connect.
+			bool registered;		///< Whether the socket is registered with the reactor.
+		};
+
+		/**
+		 * @brief A completed operation waiting to be dispatched, used without io_uring.
+		 */
+		struct Completed
+		{
+			Operation* operation;	///< The completed operation.
+			int result;				///< The result to dispatch.
+		};
+
+		std::atomic<bool> stopping_;			///< Whether Run should return.
+		size_t inFlight_;						///< The number of operations that have not completed yet.
+
+		std::unique_ptr<Reactor> reactor_;		///< Serves the operations when io_uring is unavailable.
+		std::vector<Pending> pending_;			///< Pending operations indexed by socket handle.
+		std::vector<Completed> completed_;		///< Operations completed since the last dispatch.
+		std::vector<Completed> dispatching_;	///< Operations being dispatched.
+
+#if defined(NS_HAS_IO_URING)
+		static constexpr uint64_t WAKEUP_TAG = 1;	///< User data of the read on the wakeup eventfd.
+		static constexpr uint64_t TIMEOUT_TAG = 2;	///< User data of a timeout used in place of IORING_ENTER_EXT_ARG.
+
+		int ring_;								///< The io_uring instance, or -1 when unavailable.
+		unsigned features_;						///< The features reported by io_uring_setup.
+		void* sqRing_;							///< The mapped submission queue ring.
+		size_t sqRingSize_;						///< The size of the submission queue mapping.
+		void* cqRing_;							///< The mapped completion queue ring.
+		size_t cqRingSize_;						///< The size of the completion queue mapping.
+		io_uring_sqe* sqes_;					///< The mapped submission queue entries.
+		size_t sqesSize_;						///< The size of the entries mapping.
+		unsigned* sqHead_;						///< Consumer index of the submission queue, advanced by the kernel.
+		unsigned* sqTail_;						///< Producer index of the submission queue.
+		unsigned sqMask_;						///< Mask applied to submission queue indices.
+		unsigned sqEntries_;					///< The number of submission queue entries.
+		unsigned* sqArray_;						///< Maps submission queue slots to entries.
+		unsigned* cqHead_;						///< Consumer index of the completion queue.
+		unsigned* cqTail_;						///< Producer index of the completion queue, advanced by the kernel.
+		unsigned cqMask_;						///< Mask applied to completion queue indices.
+		io_uring_cqe* cqes_;					///< The completion queue entries.
+		unsigned queued_;						///< Entries queued since the last submission.
+
+		int wakeup_;							///< An eventfd read by the ring so other threads can interrupt a wait.
+		uint64_t wakeupValue_;					///< The buffer of the read on the wakeup eventfd.
+		bool wakeupArmed_;						///< Whether a read of the wakeup eventfd is queued or in flight.
+		__kernel_timespec timeout_;				///< The timeout of the current wait.
+		std::vector<unsigned> fileSlots_;		///< The registered file slot of each socket handle, plus one.
+		std::vector<unsigned> freeSlots_;		///< Registered file slots not used by any socket.
+
+		static int Setup(const unsigned entries, io_uring_params* params)
+		{
+			return (int)syscall(__NR_io_uring_setup, entries, params);
+		}
+
+		static int Enter(const int ring, const unsigned submit, const unsigned wait, const unsigned flags, const void* argument, const size_t size)
+		{
+			return (int)syscall(__NR_io_uring_enter, ring, submit, wait, flags, argument, size);
+		}
+
+		static int Register(const int ring, const unsigned opcode, const void* argument, const unsigned count)
+		{
+			return (int)syscall(__NR_io_uring_register, ring, opcode, argument, count);
+		}
+
+		/**
+		 * @brief Maps the rings of a new io_uring instance and checks the kernel supports every operation used.
+		 *
+		 * @return {bool} False if the ring cannot be used, in which case it has been closed again.
+		 */
+		bool SetupRing(const unsigned entries, const unsigned fixedFiles)
+		{
+			io_uring_params params = {};
+			ring_ = Setup(entries, &params);
+			if (ring_ < 0)
+				return false;
+
+			features_ = params.features;
+			sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+			if (features_ & IORING_FEAT_SINGLE_MMAP)
+				sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+			sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+			cqRing_ = (features_ & IORING_FEAT_SINGLE_MMAP) ? sqRing_ : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING);
+			sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+			sqes_ = (io_uring_sqe*)mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES);
+
+			if (sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || (void*)sqes_ == MAP_FAILED)
+			{
+				TeardownRing();
+				return false;
+			}
+
+			char* sq = (char*)sqRing_;
+			sqHead_ = (unsigned*)(sq + params.sq_off.head);
+			sqTail_ = (unsigned*)(sq + params.sq_off.tail);
+			sqMask_ = *(unsigned*)(sq + params.sq_off.ring_mask);
+			sqEntries_ = params.sq_entries;
+			sqArray_ = (unsigned*)(sq + params.sq_off.array);
+
+			char* cq = (char*)cqRing_;
+			cqHead_ = (unsigned*)(cq + params.cq_off.head);
+			cqTail_ = (unsigned*)(cq + params.cq_off.tail);
+			cqMask_ = *(unsigned*)(cq + params.cq_off.ring_mask);
+			cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+			// Every opcode used by this class must be supported, otherwise the reactor serves all of them.
+			const size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+			std::unique_ptr<char[]> probeStorage(new char[probeSize]());
+			io_uring_probe* probe = (io_uring_probe*)probeStorage.get();
+
+			if (Register(ring_, IORING_REGISTER_PROBE, probe, 256) < 0)
+			{
+				TeardownRing();
+				return false;
+			}
+
+			const uint8_t required[] = { IORING_OP_RECV, IORING_OP_SEND, IORING_OP_ACCEPT, IORING_OP_CONNECT, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED, IORING_OP_TIMEOUT };
+			for (const uint8_t opcode : required)
+			{
+				if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+				{
+					TeardownRing();
+					return false;
+				}
+			}
+
+			if (fixedFiles > 0)
+			{
+				std::vector<int> files(fixedFiles, -1);
+				if (Register(ring_, IORING_REGISTER_FILES, files.data(), fixedFiles) < 0)
+				{
+					TeardownRing();
+					return false;
+				}
+
+				for (unsigned slot = fixedFiles; slot > 0; --slot)
+					freeSlots_.push_back(slot - 1);
+			}
+
+			wakeup_ = eventfd(0, EFD_CLOEXEC);
+			ArmWakeup();
+
+			return true;
+		}
+
+		void TeardownRing()
+		{
+			if (sqes_ != nullptr && (void*)sqes_ != MAP_FAILED)
+				munmap(sqes_, sqesSize_);
+			if (cqRing_ != nullptr && cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+				munmap(cqRing_, cqRingSize_);
+			if (sqRing_ != nullptr && sqRing_ != MAP_FAILED)
+				munmap(sqRing_, sqRingSize_);
+
+			close(ring_);
+			ring_ = -1;
+			sqes_ = nullptr;
+			sqRing_ = cqRing_ = nullptr;
+			freeSlots_.clear();
+		}
+
+		/**
+		 * @brief Returns the next free submission queue entry, submitting queued entries first if the queue is full.
+		 *
+		 * @return {io_uring_sqe*} The entry, or null with errno set if the queue stayed full, such as while the
+		 * completion queue overflows, as overwriting an unsubmitted entry would lose its operation.
+		 */
+		io_uring_sqe* NextEntry()
+		{
+			const unsigned tail = *sqTail_;
+			if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+			{
+				if (Submit() >= 0)
+					errno = EAGAIN;
+
+				if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+					return nullptr;
+			}
+
+			io_uring_sqe* entry = &sqes_[tail & sqMask_];
+			*entry = {};
+			sqArray_[tail & sqMask_] = tail & sqMask_;
+			++queued_;
+
+			__atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+			return entry;
+		}
+
+		/**
+		 * @brief Queues a read of the wakeup eventfd, which completes when another thread calls Wake. If the queue is
+		 * full it is armed by the next RunOnce instead, and a Wake in between is kept by the eventfd.
+		 */
+		void ArmWakeup()
+		{
+			io_uring_sqe* entry = NextEntry();
+			wakeupArmed_ = entry != nullptr;
+			if (entry == nullptr)
+				return;
+
+			entry->opcode = IORING_OP_READ;
+			entry->fd = wakeup_;
+			entry->addr = (uint64_t)&wakeupValue_;
+			entry->len = sizeof(wakeupValue_);
+			entry->user_data = WAKEUP_TAG;
+		}
+
+		/**
+		 * @brief Queues an operation on the ring.
+		 *
+		 * @return {bool} True if the operation was queued, false with errno set if the submission queue is full.
+		 */
+		bool Queue(Operation& operation)
+		{
+			io_uring_sqe* entry = NextEntry();
+			if (entry == nullptr)
+				return false;
+
+			const SOCKET handle = operation.socket_->handle();
+
+			entry->fd = handle;
+			entry->user_data = (uint64_t)&operation;
+
+			if ((size_t)handle < fileSlots_.size() && fileSlots_[handle] != 0)
+			{
+				entry->fd = fileSlots_[handle] - 1;
+				entry->flags |= IOSQE_FIXED_FILE;
+			}
+
+			switch (operation.type_)
+			{
+			case Operation::Type::RECEIVE:
+			case Operation::Type::SEND:
+			{
+				const bool receiving = operation.type_ == Operation::Type::RECEIVE;
+				entry->addr = (uint64_t)operation.buffer_;
+				entry->len = (unsigned)operation.length_;
+
+				if (operation.bufferIndex_ >= 0)
+				{
+					entry->opcode = receiving ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+					entry->buf_index = (uint16_t)operation.bufferIndex_;
+				}
+				else
+				{
+					entry->opcode = receiving ? IORING_OP_RECV : IORING_OP_SEND;
+					entry->msg_flags = (unsigned)operation.flags_;
+				}
+				break;
+			}
+
+			case Operation::Type::ACCEPT:
+				entry->opcode = IORING_OP_ACCEPT;
+				entry->accept_flags = SOCK_CLOEXEC;
+				if (operation.address_ != nullptr)
+				{
+					*operation.address_->ptr() = sizeof(sockaddr_storage);
+					entry->addr = (uint64_t)operation.address_->name();
+					entry->addr2 = (uint64_t)operation.address_->ptr();
+				}
+				break;
+
+			case Operation::Type::CONNECT:
+				entry->opcode = IORING_OP_CONNECT;
+				entry->addr = (uint64_t)operation.address_->name();
+				entry->off = operation.address_->size();
+				break;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Dispatches every completion available in the completion queue.
+		 */
+		int Reap()
+		{
+			int dispatched = 0;
+			unsigned head = *cqHead_;
+
+			while (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+			{
+				const io_uring_cqe& cqe = cqes_[head & cqMask_];
+				const uint64_t tag = cqe.user_data;
+				const int result = cqe.res;
+
+				// The entry is released before dispatching so callbacks can submit freely.
+				__atomic_store_n(cqHead_, ++head, __ATOMIC_RELEASE);
+
+				if (tag == WAKEUP_TAG)
+				{
+					ArmWakeup();
+					continue;
+				}
+
+				if (tag == TIMEOUT_TAG)
+					continue;
+
+				--inFlight_;
+				++dispatched;
+				((Operation*)tag)->OnComplete(result);
+				head = *cqHead_;
+			}
+
+			return dispatched;
+		}
+#endif
+
+		/**
+		 * @brief Performs an operation without blocking, used without io_uring.
+		 *
+		 * @return {bool} True if the operation completed, false if it has to wait for readiness.
+		 */
+		static bool Attempt(Operation& operation, int& result)
+		{
+			const SOCKET handle = operation.socket_->handle();
+			long status = 0;
+
+			switch (operation.type_)
+			{
+			case Operation::Type::RECEIVE:
+				status = recv(handle, operation.buffer_, operation.length_, operation.flags_ | MSG_DONTWAIT);
+				break;
+
+			case Operation::Type::SEND:
+				status = send(handle, operation.buffer_, operation.length_, operation.flags_ | MSG_DONTWAIT | MSG_NOSIGNAL);
+				break;
+
+			case Operation::Type::ACCEPT:
+				if (operation.address_ != nullptr)
+					*operation.address_->ptr() = sizeof(sockaddr_storage);
+
+				status = accept4(handle, operation.address_ == nullptr ? nullptr : operation.address_->name(), operation.address_ == nullptr ? nullptr : operation.address_->ptr(), SOCK_CLOEXEC | SOCK_NONBLOCK);
+				if (status >= 0)
+				{
+					// Accepted sockets are blocking, as they are with io_uring.
+					const int flags = fcntl((int)status, F_GETFL, 0);
+					fcntl((int)status, F_SETFL, flags & ~O_NONBLOCK);
+				}
+				break;
+
+			case Operation::Type::CONNECT:
+			{
+				int error = 0;
+				status = GetOption(handle, options::PENDING_ERROR, error) ? 0 : -1;
+				if (status == 0 && error != 0)
+				{
+					errno = error;
+					status = -1;
+				}
+				break;
+			}
+			}
+
+			if (status < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+				return false;
+
+			result = status < 0 ? -errno : (int)status;
+
+			return true;
+		}
+
+		/**
+		 * @brief Records an operation waiting for readiness and updates the interest of its socket.
+		 */
+		void Wait(Operation& operation, const bool reading)
+		{
+			const SOCKET handle = operation.socket_->handle();
+			if ((size_t)handle >= pending_.size())
+				pending_.resize((size_t)handle + 1, Pending{ nullptr, nullptr, false });
+
+			(reading ? pending_[handle].reading : pending_[handle].writing) = &operation;
+			UpdateInterest(*operation.socket_);
+		}
+
+		void UpdateInterest(Socket& socket)
+		{
+			Pending& pending = pending_[socket.handle()];
+			const Interest interest = (pending.reading != nullptr ? Interest::READ : Interest::NONE) | (pending.writing != nullptr ? Interest::WRITE : Interest::NONE);
+
+			if (interest == Interest::NONE)
+			{
+				if (pending.registered)
+					reactor_->Remove(socket);
+
+				pending.registered = false;
+			}
+			else if (pending.registered)
+			{
+				reactor_->Modify(socket, interest);
+			}
+			else
+			{
+				pending.registered = reactor_->Add(socket, *this, interest);
+			}
+		}
+
+		/**
+		 * @brief Retries a pending operation on a ready socket.
+		 */
+		void Retry(Socket& socket, const bool reading)
+		{
+			Pending& pending = pending_[socket.handle()];
+			Operation*& operation = reading ? pending.reading : pending.writing;
+			int result;
+
+			if (operation != nullptr && Attempt(*operation, result))
+			{
+				completed_.push_back({ operation, result });
+				operation = nullptr;
+			}
+		}
+
+		void OnReadable(Socket& socket) override
+		{
+			Retry(socket, true);
+			UpdateInterest(socket);
+		}
+
+		void OnWritable(Socket& socket) override
+		{
+			Retry(socket, false);
+			UpdateInterest(socket);
+		}
+
+		void OnError(Socket& socket) override
+		{
+			Retry(socket, true);
+			Retry(socket, false);
+			UpdateInterest(socket);
+		}
+
+		/**
+		 * @brief Starts an operation, either on the ring or on the reactor.
+		 */
+		bool Start(Operation& operation)
+		{
+			++inFlight_;
+
+#if defined(NS_HAS_IO_URING)
+			if (ring_ >= 0)
+			{
+				if (Queue(operation))
+					return true;
+
+				--inFlight_;
+				return false;
+			}
+#endif
+			int result;
+			switch (operation.type_)
+			{
+			case Operation::Type::RECEIVE:
+			case Operation::Type::SEND:
+				if (Attempt(operation, result))
+					completed_.push_back({ &operation, result });
+				else
+					Wait(operation, operation.type_ == Operation::Type::RECEIVE);
+				break;
+
+			case Operation::Type::ACCEPT:
+				Wait(operation, true);
+				break;
+
+			case Operation::Type::CONNECT:
+				operation.socket_->SetBlocking(false);
+				if (connect(operation.socket_->handle(), operation.address_->name(), operation.address_->size()) == 0)
+					completed_.push_back({ &operation, 0 });
+				else if (errno == EINPROGRESS)
+					Wait(operation, false);
+				else
+					completed_.push_back({ &operation, -errno });
+				break;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Fills in the description of an operation and starts it.
+		 */
+		bool Start(Operation& operation, const Operation::Type type, Socket& socket, char* buffer, const size_t length, const int flags, const int bufferIndex, Address* address)
+		{
+			operation.type_ = type;
+			operation.socket_ = &socket;
+			operation.buffer_ = buffer;
+			operation.length_ = length;
+			operation.flags_ = flags;
+			operation.bufferIndex_ = bufferIndex;
+			operation.address_ = address;
+
+			return Start(operation);
+		}
+
+	public:
+		/**
+		 * @brief Creates an engine, backed by io_uring when the kernel supports it.
+		 *
+		 * @param {unsigned} entries - The size of the submission queue. Defaults to 256 if not specified.
+		 * @param {unsigned} fixedFiles - The number of sockets that can be registered. Defaults to 0 if not specified.
+		 * @param {bool} allowIoUring - Whether io_uring may be used. Defaults to true if not specified.
+		 */
+		Proactor(const unsigned entries = 256, const unsigned fixedFiles = 0, const bool allowIoUring = true) : stopping_(false), inFlight_(0)
+		{
+#if defined(NS_HAS_IO_URING)
+			ring_ = -1;
+			features_ = 0;
+			sqRing_ = cqRing_ = nullptr;
+			sqes_ = nullptr;
+			queued_ = 0;
+			wakeup_ = -1;
+			wakeupArmed_ = false;
+
+			if (allowIoUring && SetupRing(entries, fixedFiles))
+				return;
+#else
+			(void)entries;
+			(void)fixedFiles;
+			(void)allowIoUring;
+#endif
+			reactor_.reset(new Reactor());
+		}
+
+		Proactor(const Proactor&) = delete;
+		Proactor& operator=(const Proactor&) = delete;
+
+		/**
+		 * @brief Destroys the engine. Operations still in flight are abandoned without being completed.
+		 */
+		~Proactor()
+		{
+#if defined(NS_HAS_IO_URING)
+			if (ring_ >= 0)
+			{
+				TeardownRing();
+				close(wakeup_);
+			}
+#endif
+		}
+
+		/**
+		 * @brief Returns whether operations are served by io_uring rather than the fallback reactor.
+		 *
+		 * @return {bool} True if io_uring is in use.
+		 */
+		bool UsingIoUring() const
+		{
+#if defined(NS_HAS_IO_URING)
+			return ring_ >= 0;
+#else
+			return false;
+#endif
+		}
+
+		/**
+		 * @brief Registers buffers with the kernel so receives and sends within them skip pinning pages each time.
+		 *
+		 * Replaces any buffers registered before. Does nothing without io_uring.
+		 *
+		 * @param {const MutableBuffer*} buffers - The buffers to register.
+		 * @param {size_t} count - The number of buffers.
+		 * @return {bool} True if the buffers were registered, or io_uring is not in use.
+		 */
+		bool RegisterBuffers(const MutableBuffer* buffers, const size_t count)
+		{
+#if defined(NS_HAS_IO_URING)
+			if (ring_ < 0)
+				return true;
+
+			std::vector<iovec> vectors(count);
+			for (size_t i = 0; i < count; ++i)
+				vectors[i] = { buffers[i].data(), buffers[i].size() };
+
+			Register(ring_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+
+			return Register(ring_, IORING_REGISTER_BUFFERS, vectors.data(), (unsigned)count) == 0;
+#else
+			(void)buffers;
+			(void)count;
+			return true;
+#endif
+		}
+
+		/**
+		 * @brief Registers a socket so operations on it skip the file descriptor lookup.
+		 *
+		 * Does nothing without io_uring. The socket must be unregistered before it is closed.
+		 *
+		 * @param {Socket&} socket - The socket to register.
+		 * @return {bool} True if the socket was registered, or io_uring is not in use. False if every slot is taken.
+		 */
+		bool RegisterSocket(Socket& socket)
+		{
+#if defined(NS_HAS_IO_URING)
+			if (ring_ < 0)
+				return true;
+
+			const SOCKET handle = socket.handle();
+			if (freeSlots_.empty() || !nsIsValidSocket(handle))
+				return false;
+
+			const unsigned slot = freeSlots_.back();
+			io_uring_files_update update = {};
+			update.offset = slot;
+			update.fds = (uint64_t)&handle;
+
+			if (Register(ring_, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1)
+				return false;
+
+			freeSlots_.pop_back();
+			if ((size_t)handle >= fileSlots_.size())
+				fileSlots_.resize((size_t)handle + 1, 0);
+			fileSlots_[handle] = slot + 1;
+#else
+			(void)socket;
+#endif
+			return true;
+		}
+
+		/**
+		 * @brief Releases the slot of a registered socket.
+		 *
+		 * @param {Socket&} socket - The registered socket.
+		 */
+		void UnregisterSocket(Socket& socket)
+		{
+#if defined(NS_HAS_IO_URING)
+			const SOCKET handle = socket.handle();
+			if (ring_ < 0 || (size_t)handle >= fileSlots_.size() || fileSlots_[handle] == 0)
+				return;
+
+			const int none = -1;
+			io_uring_files_update update = {};
+			update.offset = fileSlots_[handle] - 1;
+			update.fds = (uint64_t)&none;
+			Register(ring_, IORING_REGISTER_FILES_UPDATE, &update, 1);
+
+			freeSlots_.push_back(fileSlots_[handle] - 1);
+			fileSlots_[handle] = 0;
+#else
+			(void)socket;
+#endif
+		}
+
+		/**
+		 * @brief Starts receiving data into a buffer.
+		 *
+		 * @param {Socket&} socket - The socket to receive from.
+		 * @param {char*} buffer - The buffer to store the received data.
+		 * @param {size_t} length - The length of the buffer.
+		 * @param {Operation&} operation - Notified with the number of bytes received, 0 at the end of the stream.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {bool} True if the operation was started.
+		 */
+		bool Receive(Socket& socket, char* buffer, const size_t length, Operation& operation, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			return Start(operation, Operation::Type::RECEIVE, socket, buffer, length, (int)flags, -1, nullptr);
+		}
+
+		/**
+		 * @brief Starts receiving data into part of a registered buffer.
+		 *
+		 * @param {Socket&} socket - The socket to receive from.
+		 * @param {unsigned} bufferIndex - The index of the registered buffer.
+		 * @param {char*} buffer - The start of the region to receive into, inside the registered buffer.
+		 * @param {size_t} length - The length of the region.
+		 * @param {Operation&} operation - Notified with the number of bytes received, 0 at the end of the stream.
+		 * @return {bool} True if the operation was started.
+		 */
+		bool ReceiveFixed(Socket& socket, const unsigned bufferIndex, char* buffer, const size_t length, Operation& operation)
+		{
+			return Start(operation, Operation::Type::RECEIVE, socket, buffer, length, 0, (int)bufferIndex, nullptr);
+		}
+
+		/**
+		 * @brief Starts sending data from a buffer. The operation may complete after sending only part of it.
+		 *
+		 * @param {Socket&} socket - The socket to send on.
+		 * @param {const char*} buffer - The buffer of data to send.
+		 * @param {size_t} length - The length of the buffer.
+		 * @param {Operation&} operation - Notified with the number of bytes sent.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {bool} True if the operation was started.
+		 */
+		bool Send(Socket& socket, const char* buffer, const size_t length, Operation& operation, const SendFlags flags = SendFlags::NONE)
+		{
+			return Start(operation, Operation::Type::SEND, socket, (char*)buffer, length, (int)flags | MSG_NOSIGNAL, -1, nullptr);
+		}
+
+		/**
+		 * @brief Starts sending data from part of a registered buffer.
+		 *
+		 * @param {Socket&} socket - The socket to send on.
+		 * @param {unsigned} bufferIndex - The index of the registered buffer.
+		 * @param {const char*} buffer - The start of the region to send, inside the registered buffer.
+		 * @param {size_t} length - The length of the region.
+		 * @param {Operation&} operation - Notified with the number of bytes sent.
+		 * @return {bool} True if the operation was started.
+		 */
+		bool SendFixed(Socket& socket, const unsigned bufferIndex, const char* buffer, const size_t length, Operation& operation)
+		{
+			return Start(operation, Operation::Type::SEND, socket, (char*)buffer, length, MSG_NOSIGNAL, (int)bufferIndex, nullptr);
+		}
+
+		/**
+		 * @brief Starts accepting a connection on a listening socket.
+		 *
+		 * @param {Socket&} listener - The listening socket.
+		 * @param {Operation&} operation - Notified with the SOCKET handle of the accepted connection.
+		 * @param {Address*} peer - Receives the address of the peer. Defaults to nullptr if not needed.
+		 * @return {bool} True if the operation was started.
+		 */
+		bool Accept(Socket& listener, Operation& operation, Address* peer = nullptr)
+		{
+			return Start(operation, Operation::Type::ACCEPT, listener, nullptr, 0, 0, -1, peer);
+		}
+
+		/**
+		 * @brief Starts connecting a socket. Without io_uring the socket is switched to non-blocking mode.
+		 *
+		 * @param {Socket&} socket - The socket to connect.
+		 * @param {Address&} address - The address to connect to.
+		 * @param {Operation&} operation - Notified with 0 once connected.
+		 * @return {bool} True if the operation was started.
+		 */
+		bool Connect(Socket& socket, Address& address, Operation& operation)
+		{
+			return Start(operation, Operation::Type::CONNECT, socket, nullptr, 0, 0, -1, &address);
+		}
+
+		/**
+		 * @brief Submits every queued operation to the kernel in a single call.
+		 *
+		 * @return {int} The number of operations submitted, or SOCKET_ERROR on failure.
+		 */
+		int Submit()
+		{
+#if defined(NS_HAS_IO_URING)
+			if (ring_ >= 0 && queued_ > 0)
+			{
+				const int submitted = Enter(ring_, queued_, 0, 0, nullptr, 0);
+				if (submitted > 0)
+					queued_ -= submitted;
+
+				return submitted;
+			}
+#endif
+			return 0;
+		}
+
+		/**
+		 * @brief Submits queued operations, waits for at least one completion and dispatches every completion available.
+		 *
+		 * @param {int} timeout - The maximum time to wait in milliseconds, 0 to poll or -1 to wait indefinitely. Defaults to -1.
+		 * @return {int} The number of operations completed, or SOCKET_ERROR if waiting failed.
+		 */
+		int RunOnce(const int timeout = -1)
+		{
+#if defined(NS_HAS_IO_URING)
+			if (ring_ >= 0)
+			{
+				if (!wakeupArmed_)
+					ArmWakeup();
+
+				int dispatched = Reap();
+				if (dispatched > 0 || timeout == 0)
+				{
+					Submit();
+					return dispatched + Reap();
+				}
+
+				unsigned flags = IORING_ENTER_GETEVENTS;
+				const void* argument = nullptr;
+				size_t size = 0;
+				io_uring_getevents_arg extended = {};
+
+				if (timeout > 0)
+				{
+					timeout_.tv_sec = timeout / 1000;
+					timeout_.tv_nsec = (timeout % 1000) * 1000000L;
+
+					if (features_ & IORING_FEAT_EXT_ARG)
+					{
+						extended.ts = (uint64_t)&timeout_;
+						flags |= IORING_ENTER_EXT_ARG;
+						argument = &extended;
+						size = sizeof(extended);
+					}
+					else
+					{
+						// Without room for the timeout the wait could outlast it, so only what has completed is reaped.
+						io_uring_sqe* entry = NextEntry();
+						if (entry == nullptr)
+							return Reap();
+
+						entry->opcode = IORING_OP_TIMEOUT;
+						entry->addr = (uint64_t)&timeout_;
+						entry->len = 1;
+						entry->user_data = TIMEOUT_TAG;
+					}
+				}
+
+				const int status = Enter(ring_, queued_, 1, flags, argument, size);
+				if (status < 0 && errno != ETIME && errno != EINTR)
+					return -1;
+				if (status > 0)
+					queued_ -= status;
+
+				return Reap();
+			}
+#endif
+			if (reactor_->RunOnce(completed_.empty() ? timeout : 0) < 0)
+				return -1;
+
+			dispatching_.swap(completed_);
+			for (const Completed& completion : dispatching_)
+			{
+				--inFlight_;
+				completion.operation->OnComplete(completion.result);
+			}
+
+			const int dispatched = (int)dispatching_.size();
+			dispatching_.clear();
+
+			return dispatched;
+		}
+
+		/**
+		 * @brief Dispatches completions until Stop is called.
+		 */
+		void Run()
+		{
+			while (!stopping_.load(std::memory_order_acquire))
+				RunOnce();
+
+			stopping_.store(false, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Makes Run return after the current dispatch, or right away if it is not running yet. May be called from any thread.
+		 */
+		void Stop()
+		{
+			stopping_.store(true, std::memory_order_release);
+			Wake();
+		}
+
+		/**
+		 * @brief Interrupts a blocking wait. May be called from any thread.
+		 */
+		void Wake()
+		{
+#if defined(NS_HAS_IO_URING)
+			if (ring_ >= 0)
+			{
+				const uint64_t value = 1;
+				(void)!write(wakeup_, &value, sizeof(value));
+				return;
+			}
+#endif
+			reactor_->Wake();
+		}
+
+		/**
+		 * @brief Returns the number of operations that have been started but not completed.
+		 *
+		 * @return {size_t} The number of operations in flight.
+		 */
+		size_t size() const
+		{
+			return inFlight_;
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__
+
+#endif // CPP_PROACTOR_HPP
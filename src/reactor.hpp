@@ -0,0 +1,395 @@
+#ifndef CPP_REACTOR_HPP
+#define CPP_REACTOR_HPP
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#include <chrono>
+
+#include "netstack.h"
+#include "socket.hpp"
+#include "timer.hpp"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace netstack
+{
+	/**
+	 * @brief The readiness a Reactor watches a socket for.
+	 */
+	enum class Interest : uint32_t
+	{
+		NONE = 0,							///< Only errors and hang ups are reported.
+		READ = EPOLLIN | EPOLLRDHUP,		///< Data, a connection or the end of the stream is ready to be received.
+		WRITE = EPOLLOUT,					///< The socket can accept more data to send.
+		READ_WRITE = READ | WRITE,			///< Both READ and WRITE.
+	};
+
+	/**
+	 * @brief Combines two interests.
+	 */
+	inline Interest operator|(const Interest left, const Interest right)
+	{
+		return (Interest)((uint32_t)left | (uint32_t)right);
+	}
+
+	/**
+	 * @brief How a Reactor reports readiness.
+	 */
+	enum class Trigger : uint32_t
+	{
+		LEVEL = 0,				///< Reported on every poll for as long as the socket stays ready.
+		EDGE = EPOLLET,			///< Reported once each time the socket becomes ready, the handler must drain it.
+		ONESHOT = EPOLLONESHOT,	///< Reported once, then disarmed until the interest is modified again.
+	};
+
+	/**
+	 * @brief Receives the readiness events of the sockets registered with a Reactor.
+	 *
+	 * Every callback is invoked on the thread running the Reactor. Handlers may add, modify or remove any
+	 * registration, including their own, from within a callback.
+	 */
+	class Handler
+	{
+	public:
+		virtual ~Handler() = default;
+
+		/**
+		 * @brief Called when the socket has data, a pending connection or the end of the stream to receive.
+		 *
+		 * @param {Socket&} socket - The ready socket.
+		 */
+		virtual void OnReadable(Socket& socket) { (void)socket; }
+
+		/**
+		 * @brief Called when the socket can accept more data to send.
+		 *
+		 * @param {Socket&} socket - The ready socket.
+		 */
+		virtual void OnWritable(Socket& socket) { (void)socket; }
+
+		/**
+		 * @brief Called when an error or hang up is pending on the socket.
+		 *
+		 * @param {Socket&} socket - The failed socket.
+		 */
+		virtual void OnError(Socket& socket) { (void)socket; }
+	};
+
+	/**
+	 * @brief An epoll based event loop that dispatches socket readiness to handlers.
+	 *
+	 * Registrations are stored in a table indexed by the socket handle, so lookups during dispatch are O(1) and
+	 * idle sockets cost one small table entry each. Timers armed on the reactor, such as deadlines and idle
+	 * timeouts, are kept in a millisecond TimerWheel and expire on the thread running it.
+	 */
+	class Reactor
+	{
+	private:
+		/**
+		 * @brief A registered socket and the handler its events are dispatched to.
+		 */
+		struct Registration
+		{
+			Socket* socket;			///< The registered socket, null when the slot is free.
+			Handler* handler;		///< The handler for the socket.
+			uint32_t generation;	///< Distinguishes a registration from earlier ones of the same handle.
+		};
+
+		static constexpr size_t MAX_EVENTS = 256;	///< The number of events collected by a single poll.
+
+		int epoll_;									///< The epoll instance.
+		int wakeup_;								///< An eventfd used to interrupt a blocking poll.
+		std::atomic<bool> stopping_;				///< Whether Run should return.
+		size_t count_;								///< The number of registered sockets.
+		uint32_t generation_;						///< The generation given to the next registration.
+		std::vector<Registration> registrations_;	///< Registrations indexed by socket handle.
+		std::vector<epoll_event> events_;			///< Events collected by the last poll.
+		TimerWheel timers_;							///< The armed timers, in milliseconds.
+
+		/**
+		 * @brief Packs a handle and the generation of its registration into epoll user data.
+		 */
+		static uint64_t Key(const SOCKET handle, const uint32_t generation)
+		{
+			return ((uint64_t)generation << 32) | (uint32_t)handle;
+		}
+
+		/**
+		 * @brief Returns the registration an event was reported for, or null if it has since been removed.
+		 */
+		Registration* Find(const uint64_t key)
+		{
+			const uint32_t handle = (uint32_t)key;
+			if (handle >= registrations_.size())
+				return nullptr;
+
+			Registration& registration = registrations_[handle];
+			if (registration.socket == nullptr || registration.generation != (uint32_t)(key >> 32))
+				return nullptr;
+
+			return &registration;
+		}
+
+	public:
+		/**
+		 * @brief Creates an event loop with no registered sockets.
+		 */
+		Reactor() : stopping_(false), count_(0), generation_(0), events_(MAX_EVENTS), timers_(Now())
+		{
+			epoll_ = epoll_create1(EPOLL_CLOEXEC);
+			wakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.u64 = UINT64_MAX;
+			epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeup_, &event);
+		}
+
+		Reactor(const Reactor&) = delete;
+		Reactor& operator=(const Reactor&) = delete;
+
+		/**
+		 * @brief Destroys the event loop. Registered sockets are not closed.
+		 */
+		~Reactor()
+		{
+			close(wakeup_);
+			close(epoll_);
+		}
+
+		/**
+		 * @brief Returns whether the event loop was created successfully.
+		 */
+		explicit operator bool() const
+		{
+			return epoll_ >= 0 && wakeup_ >= 0;
+		}
+
+		/**
+		 * @brief Starts watching a socket. Edge triggered sockets should be non-blocking.
+		 *
+		 * @param {Socket&} socket - The socket to watch, which must outlive its registration.
+		 * @param {Handler&} handler - The handler to dispatch the events of the socket to.
+		 * @param {Interest} interest - The readiness to watch for.
+		 * @param {Trigger} trigger - How readiness is reported. Defaults to LEVEL if not specified.
+		 * @return {bool} True if the socket was registered.
+		 */
+		bool Add(Socket& socket, Handler& handler, const Interest interest, const Trigger trigger = Trigger::LEVEL)
+		{
+			const SOCKET handle = socket.handle();
+			if (!nsIsValidSocket(handle))
+				return false;
+
+			if ((size_t)handle >= registrations_.size())
+				registrations_.resize(std::max((size_t)handle + 1, registrations_.size() * 2), Registration{ nullptr, nullptr, 0 });
+
+			Registration& registration = registrations_[handle];
+			if (registration.socket != nullptr)
+				return false;
+
+			epoll_event event = {};
+			event.events = (uint32_t)interest | (uint32_t)trigger;
+			event.data.u64 = Key(handle, generation_);
+
+			if (epoll_ctl(epoll_, EPOLL_CTL_ADD, handle, &event) != 0)
+				return false;
+
+			registration = { &socket, &handler, generation_++ };
+			++count_;
+
+			return true;
+		}
+
+		/**
+		 * @brief Changes the readiness watched for on a registered socket, rearming ONESHOT registrations.
+		 *
+		 * @param {Socket&} socket - The registered socket.
+		 * @param {Interest} interest - The readiness to watch for.
+		 * @param {Trigger} trigger - How readiness is reported. Defaults to LEVEL if not specified.
+		 * @return {bool} True if the registration was changed.
+		 */
+		bool Modify(Socket& socket, const Interest interest, const Trigger trigger = Trigger::LEVEL)
+		{
+			const SOCKET handle = socket.handle();
+			if ((size_t)handle >= registrations_.size() || registrations_[handle].socket != &socket)
+				return false;
+
+			epoll_event event = {};
+			event.events = (uint32_t)interest | (uint32_t)trigger;
+			event.data.u64 = Key(handle, registrations_[handle].generation);
+
+			return epoll_ctl(epoll_, EPOLL_CTL_MOD, handle, &event) == 0;
+		}
+
+		/**
+		 * @brief Stops watching a socket. Events already collected for it are discarded.
+		 *
+		 * @param {Socket&} socket - The registered socket.
+		 * @return {bool} True if the socket was registered.
+		 */
+		bool Remove(Socket& socket)
+		{
+			const SOCKET handle = socket.handle();
+			if ((size_t)handle >= registrations_.size() || registrations_[handle].socket != &socket)
+				return false;
+
+			epoll_ctl(epoll_, EPOLL_CTL_DEL, handle, nullptr);
+			registrations_[handle].socket = nullptr;
+			registrations_[handle].handler = nullptr;
+			--count_;
+
+			return true;
+		}
+
+		/**
+		 * @brief Arms a timer to expire on the thread running the reactor, or moves it if it is already armed.
+		 *
+		 * Re-arming is O(1), so an idle timeout can simply be scheduled again on every activity.
+		 *
+		 * @param {Timer&} timer - The timer, which must stay alive or be cancelled before it is destroyed.
+		 * @param {uint64_t} milliseconds - The time from now to expire the timer after.
+		 */
+		void Schedule(Timer& timer, const uint64_t milliseconds)
+		{
+			const uint64_t now = Now();
+
+			// An idle wheel is brought up to date first, so the timer lands in the finest slot it can.
+			if (timers_.size() == 0)
+				timers_.Advance(now);
+
+			// Now() truncates to the millisecond, so the next tick is the first one a full delay is sure to have passed by.
+			timers_.Schedule(timer, now + milliseconds + 1);
+		}
+
+		/**
+		 * @brief Returns the number of armed timers.
+		 *
+		 * @return {size_t} The number of armed timers.
+		 */
+		size_t timers() const
+		{
+			return timers_.size();
+		}
+
+		/**
+		 * @brief Returns the monotonic time timers are measured in.
+		 *
+		 * @return {uint64_t} The time in milliseconds.
+		 */
+		static uint64_t Now()
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		/**
+		 * @brief Waits for readiness once, dispatches every event collected, then expires every timer due.
+		 *
+		 * @param {int} timeout - The maximum time to wait in milliseconds, 0 to poll or -1 to wait indefinitely. The wait
+		 * is shortened to the next timer. Defaults to -1.
+		 * @return {int} The number of socket events dispatched, or SOCKET_ERROR if polling failed.
+		 */
+		int RunOnce(int timeout = -1)
+		{
+			if (timers_.size() != 0 && timeout != 0)
+			{
+				const uint64_t next = timers_.NextExpiry();
+				const uint64_t now = Now();
+				const int until = next <= now ? 0 : (int)std::min<uint64_t>(next - now, INT_MAX);
+
+				if (timeout < 0 || until < timeout)
+					timeout = until;
+			}
+
+			const int ready = epoll_wait(epoll_, events_.data(), (int)events_.size(), timeout);
+			if (ready < 0)
+				return errno == EINTR ? 0 : -1;
+
+			int dispatched = 0;
+			for (int i = 0; i < ready; ++i)
+			{
+				const epoll_event& event = events_[i];
+
+				if (event.data.u64 == UINT64_MAX)
+				{
+					uint64_t value;
+					while (read(wakeup_, &value, sizeof(value)) > 0) {}
+					continue;
+				}
+
+				Registration* registration = Find(event.data.u64);
+				if (registration == nullptr)
+					continue;
+
+				++dispatched;
+
+				// Each callback may remove the registration, so it is looked up again before the next one.
+				if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLPRI))
+				{
+					registration->handler->OnReadable(*registration->socket);
+					registration = Find(event.data.u64);
+				}
+
+				if (registration != nullptr && (event.events & EPOLLOUT))
+				{
+					registration->handler->OnWritable(*registration->socket);
+					registration = Find(event.data.u64);
+				}
+
+				if (registration != nullptr && (event.events & (EPOLLERR | EPOLLHUP)))
+					registration->handler->OnError(*registration->socket);
+			}
+
+			if (timers_.size() != 0)
+				timers_.Advance(Now());
+
+			return dispatched;
+		}
+
+		/**
+		 * @brief Dispatches events until Stop is called.
+		 */
+		void Run()
+		{
+			while (!stopping_.load(std::memory_order_acquire))
+				RunOnce();
+
+			stopping_.store(false, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Makes Run return after the current dispatch, or right away if it is not running yet. May be called from any thread.
+		 */
+		void Stop()
+		{
+			stopping_.store(true, std::memory_order_release);
+			Wake();
+		}
+
+		/**
+		 * @brief Interrupts a blocking poll. May be called from any thread.
+		 */
+		void Wake()
+		{
+			const uint64_t value = 1;
+			(void)!write(wakeup_, &value, sizeof(value));
+		}
+
+		/**
+		 * @brief Returns the number of registered sockets.
+		 *
+		 * @return {size_t} The number of registered sockets.
+		 */
+		size_t size() const
+		{
+			return count_;
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__
+
+#endif // CPP_REACTOR_HPP
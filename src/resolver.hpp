@@ -0,0 +1,837 @@
+#ifndef CPP_RESOLVER_HPP
+#define CPP_RESOLVER_HPP
+
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "netstack.h"
+#include "address.hpp"
+#include "socket.hpp"
+#include "reactor.hpp"
+
+#if defined(__linux__)
+
+namespace netstack
+{
+	/**
+	 * @brief The tunables of a Resolver.
+	 */
+	struct ResolverOptions
+	{
+		uint64_t timeout = 1000;		///< The milliseconds to wait for an answer before asking again.
+		int attempts = 3;				///< The times a query is sent, rotating through the name servers.
+		uint32_t negativeTtl = 30;		///< The seconds a missing name is cached for when the server gives no SOA record.
+		uint32_t maxTtl = 86400;		///< The longest a name is cached for, in seconds, whatever its records say.
+		size_t capacity = 4096;			///< The number of names cached.
+	};
+
+	/**
+	 * @brief An asynchronous DNS resolver, which looks names up on its own thread so event loops never block on them.
+	 *
+	 * Queries for A and AAAA records are sent over UDP to the configured name servers and their answers are cached
+	 * for as long as their TTL allows. Names that do not exist are cached as well, for as long as the SOA record of
+	 * their zone asks, and concurrent lookups of a name share a single query. Numeric addresses and "localhost" are
+	 * answered without a query. Names are looked up as given, without search domains or the hosts file; use
+	 * Address::GetAddressInfo where those are needed.
+	 */
+	class Resolver : private Handler
+	{
+	public:
+		/**
+		 * @brief Receives the result of a lookup.
+		 *
+		 * Called on the thread calling Resolve if the answer is already known, otherwise on the thread of the
+		 * resolver, which the callback should not block. The error is 0 on success, EAI_NONAME if the name has no
+		 * addresses and EAI_AGAIN if no server answered. IPv6 addresses come before IPv4 ones.
+		 */
+		using Callback = std::function<void(int error, const std::vector<Address>& addresses)>;
+
+	private:
+		static constexpr size_t MAX_MESSAGE = 1232;	///< The largest answer asked for, which avoids fragmentation.
+		static constexpr size_t MAX_NAME = 253;		///< The longest name in text.
+		static constexpr int MAX_CNAMES = 8;		///< The longest chain of aliases followed.
+		static constexpr uint16_t TYPE_A = 1;
+		static constexpr uint16_t TYPE_CNAME = 5;
+		static constexpr uint16_t TYPE_SOA = 6;
+		static constexpr uint16_t TYPE_AAAA = 28;
+		static constexpr uint16_t TYPE_OPT = 41;
+
+		/**
+		 * @brief A caller waiting for a lookup, with the port to give its addresses.
+		 */
+		struct Waiter
+		{
+			unsigned short port;
+			Callback callback;
+		};
+
+		/**
+		 * @brief The query for one record type of a lookup.
+		 */
+		struct Query
+		{
+			uint16_t type;							///< TYPE_A or TYPE_AAAA.
+			uint16_t id;							///< The id of the message, unique among outstanding queries.
+			bool done;								///< Whether an answer or a final timeout has been received.
+			int error;								///< 0 if answered, EAI_NONAME if the name has no such records, otherwise EAI_AGAIN.
+			uint32_t ttl;							///< The seconds the answer may be cached for.
+			std::vector<CompactAddress> records;	///< The addresses answered.
+		};
+
+		/**
+		 * @brief A lookup in flight, whose timer sends its queries again when no answer arrives.
+		 */
+		struct Lookup : Timer
+		{
+			Resolver& resolver;
+			std::string key;				///< The key of the lookup in the cache and the map of lookups in flight.
+			std::string name;				///< The name looked up, in lowercase without a trailing dot.
+			Query queries[2];
+			size_t count;					///< The number of queries, 2 for AddressFamily::UNSPEC.
+			int attempt;					///< The number of times the queries have been sent.
+			std::vector<Waiter> waiters;	///< The callers waiting, guarded by the mutex of the resolver.
+
+			Lookup(Resolver& resolver, std::string key, std::string name, const AddressFamily family) :
+				resolver(resolver), key(std::move(key)), name(std::move(name)), queries(), count(0), attempt(0)
+			{
+				if (family != AddressFamily::INET)
+					queries[count++].type = TYPE_AAAA;
+				if (family != AddressFamily::INET6)
+					queries[count++].type = TYPE_A;
+			}
+
+			void OnExpire() override
+			{
+				resolver.Retransmit(*this);
+			}
+		};
+
+		/**
+		 * @brief The result of a lookup, kept until its TTL runs out.
+		 */
+		struct Entry
+		{
+			int error;								///< 0 or EAI_NONAME.
+			uint64_t expiry;						///< When the entry runs out, in the milliseconds of Reactor::Now.
+			std::vector<CompactAddress> records;	///< The addresses, without a port.
+		};
+
+		ResolverOptions options_;
+		Reactor reactor_;											///< Runs the queries and their timers.
+		std::deque<Socket> sockets_;								///< A socket connected to each name server.
+		std::thread thread_;										///< Runs the reactor.
+		std::atomic<bool> stopping_;								///< Whether the thread should exit.
+		std::atomic<uint64_t> queries_;								///< The number of queries sent.
+		std::mt19937 random_;										///< Picks the ids of queries, on the thread only.
+		std::unordered_map<uint16_t, std::pair<Lookup*, size_t>> ids_;	///< Outstanding queries by id, on the thread only.
+
+		mutable std::mutex mutex_;									///< Guards the members below.
+		std::unordered_map<std::string, Entry> cache_;				///< Results by key.
+		std::unordered_map<std::string, std::unique_ptr<Lookup>> lookups_;	///< Lookups in flight by key.
+		std::vector<Lookup*> submitted_;							///< Lookups not yet sent by the thread.
+
+		static uint16_t Read16(const uint8_t* data)
+		{
+			return (uint16_t)(data[0] << 8 | data[1]);
+		}
+
+		static uint32_t Read32(const uint8_t* data)
+		{
+			return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+		}
+
+		static void Write16(uint8_t* data, const uint16_t value)
+		{
+			data[0] = (uint8_t)(value >> 8);
+			data[1] = (uint8_t)value;
+		}
+
+		static char Lower(const char c)
+		{
+			return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+		}
+
+		/**
+		 * @brief Lowercases a name and drops its trailing dot, returning false if it is not a valid name.
+		 */
+		static bool Normalize(const char* host, std::string& name)
+		{
+			name.clear();
+			for (const char* c = host; *c != '\0'; ++c)
+				name += Lower(*c);
+
+			if (!name.empty() && name.back() == '.')
+				name.pop_back();
+
+			if (name.empty() || name.size() > MAX_NAME)
+				return false;
+
+			// Every label is 1 to 63 characters.
+			size_t label = 0;
+			for (const char c : name)
+			{
+				if (c == '.' && label == 0)
+					return false;
+
+				label = c == '.' ? 0 : label + 1;
+				if (label > 63)
+					return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Reads a possibly compressed name at an offset into a message, in lowercase, moving the offset past it.
+		 */
+		static bool ReadName(const uint8_t* message, const size_t size, size_t& offset, std::string& name)
+		{
+			name.clear();
+			size_t position = offset;
+			bool jumped = false;
+
+			for (int jumps = 0; ; )
+			{
+				if (position >= size)
+					return false;
+
+				const uint8_t length = message[position];
+				if ((length & 0xc0) == 0xc0)
+				{
+					// A pointer to the rest of the name, which may only point backwards.
+					const size_t target = (size_t)(length & 0x3f) << 8 | (position + 1 < size ? message[position + 1] : 0);
+					if (position + 1 >= size || target >= position || ++jumps > 64)
+						return false;
+
+					if (!jumped)
+						offset = position + 2;
+
+					jumped = true;
+					position = target;
+					continue;
+				}
+
+				if ((length & 0xc0) != 0)
+					return false;
+
+				if (length == 0)
+				{
+					if (!jumped)
+						offset = position + 1;
+
+					return true;
+				}
+
+				if (position + 1 + length > size || name.size() + length + 1 > MAX_NAME + 1)
+					return false;
+
+				if (!name.empty())
+					name += '.';
+
+				for (size_t i = 0; i < length; ++i)
+					name += Lower((char)message[position + 1 + i]);
+
+				position += 1 + length;
+			}
+		}
+
+		/**
+		 * @brief Writes a query for a record type of a name, asking for answers of up to MAX_MESSAGE bytes.
+		 */
+		static size_t WriteQuery(uint8_t* message, const uint16_t id, const std::string& name, const uint16_t type)
+		{
+			uint8_t* out = message;
+			Write16(out, id);
+			Write16(out + 2, 0x0100);	// Recursion desired.
+			Write16(out + 4, 1);
+			Write16(out + 6, 0);
+			Write16(out + 8, 0);
+			Write16(out + 10, 1);
+			out += 12;
+
+			size_t start = 0;
+			while (start <= name.size())
+			{
+				size_t end = name.find('.', start);
+				if (end == std::string::npos)
+					end = name.size();
+
+				*out++ = (uint8_t)(end - start);
+				std::memcpy(out, name.data() + start, end - start);
+				out += end - start;
+				start = end + 1;
+			}
+
+			*out++ = 0;
+			Write16(out, type);
+			Write16(out + 2, 1);
+			out += 4;
+
+			// An EDNS record raises the size of answers over UDP from 512 bytes.
+			*out++ = 0;
+			Write16(out, TYPE_OPT);
+			Write16(out + 2, (uint16_t)MAX_MESSAGE);
+			std::memset(out + 4, 0, 6);
+			out += 10;
+
+			return (size_t)(out - message);
+		}
+
+		/**
+		 * @brief Reads the answer to a query, returning false if the message does not answer it.
+		 */
+		bool ParseAnswer(Query& query, const std::string& name, const uint8_t* message, const size_t size) const
+		{
+			const uint16_t flags = Read16(message + 2);
+			if ((flags & 0x8000) == 0 || (flags & 0x7800) != 0 || Read16(message + 4) != 1)
+				return false;
+
+			size_t offset = 12;
+			std::string owner;
+			if (!ReadName(message, size, offset, owner) || owner != name || offset + 4 > size || Read16(message + offset) != query.type)
+				return false;
+
+			offset += 4;
+
+			// Only a missing name is final, other failures may be answered by the next server.
+			const uint16_t rcode = flags & 0x000f;
+			if (rcode != 0 && rcode != 3)
+			{
+				query.error = EAI_AGAIN;
+				return true;
+			}
+
+			struct Record
+			{
+				std::string owner;
+				uint16_t type;
+				uint32_t ttl;
+				size_t data;
+				uint16_t length;
+			};
+
+			const size_t answers = Read16(message + 6);
+			const size_t authorities = Read16(message + 8);
+			std::vector<Record> records;
+
+			for (size_t i = 0; i < answers + authorities; ++i)
+			{
+				Record record;
+				if (!ReadName(message, size, offset, record.owner) || offset + 10 > size)
+					return false;
+
+				record.type = Read16(message + offset);
+				record.ttl = Read32(message + offset + 4);
+				record.length = Read16(message + offset + 8);
+				record.data = offset + 10;
+				offset = record.data + record.length;
+
+				if (offset > size)
+					return false;
+
+				// TTLs with the top bit set are treated as 0.
+				if (record.ttl > 0x7fffffff)
+					record.ttl = 0;
+
+				records.push_back(std::move(record));
+			}
+
+			uint32_t ttl = options_.maxTtl;
+			std::string target = name;
+
+			// Follows the aliases of the name to the one holding the addresses.
+			for (int hop = 0; hop < MAX_CNAMES; ++hop)
+			{
+				const auto alias = std::find_if(records.begin(), records.begin() + answers, [&target](const Record& record) {
+					return record.type == TYPE_CNAME && record.owner == target;
+				});
+
+				if (alias == records.begin() + answers)
+					break;
+
+				size_t data = alias->data;
+				if (!ReadName(message, size, data, target))
+					return false;
+
+				ttl = std::min(ttl, alias->ttl);
+			}
+
+			const int family = query.type == TYPE_A ? AF_INET : AF_INET6;
+			const uint16_t length = query.type == TYPE_A ? 4 : 16;
+
+			query.records.clear();
+			for (size_t i = 0; i < answers; ++i)
+			{
+				const Record& record = records[i];
+				if (record.type != query.type || record.length != length || record.owner != target)
+					continue;
+
+				query.records.emplace_back(family, message + record.data, (uint16_t)0);
+				ttl = std::min(ttl, record.ttl);
+			}
+
+			if (!query.records.empty())
+			{
+				query.error = 0;
+				query.ttl = ttl;
+				return true;
+			}
+
+			// A truncated answer without addresses says nothing about the name.
+			if ((flags & 0x0200) != 0)
+			{
+				query.error = EAI_AGAIN;
+				return true;
+			}
+
+			// A missing name or record type is cached for the lesser of the TTL and minimum of the SOA record.
+			query.error = EAI_NONAME;
+			query.ttl = std::min(ttl, options_.negativeTtl);
+
+			for (size_t i = answers; i < records.size(); ++i)
+			{
+				const Record& record = records[i];
+				if (record.type != TYPE_SOA)
+					continue;
+
+				size_t data = record.data;
+				std::string server, mailbox;
+				if (ReadName(message, size, data, server) && ReadName(message, size, data, mailbox) && data + 20 <= record.data + record.length)
+					query.ttl = std::min({ ttl, record.ttl, Read32(message + data + 16) });
+
+				break;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Sends the unanswered queries of a lookup to the next name server and arms its timer.
+		 */
+		void Send(Lookup& lookup)
+		{
+			Socket& socket = sockets_[(size_t)lookup.attempt % sockets_.size()];
+			++lookup.attempt;
+
+			for (size_t i = 0; i < lookup.count; ++i)
+			{
+				const Query& query = lookup.queries[i];
+				if (query.done)
+					continue;
+
+				uint8_t message[512];
+				const size_t length = WriteQuery(message, query.id, lookup.name, query.type);
+				socket.Send((const char*)message, (int)length);
+				queries_.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			reactor_.Schedule(lookup, options_.timeout);
+		}
+
+		/**
+		 * @brief Sends the lookups submitted since the last call.
+		 */
+		void Submit()
+		{
+			std::vector<Lookup*> submitted;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				submitted.swap(submitted_);
+			}
+
+			for (Lookup* lookup : submitted)
+			{
+				for (size_t i = 0; i < lookup->count; ++i)
+				{
+					uint16_t id;
+					do
+						id = (uint16_t)random_();
+					while (ids_.count(id) != 0);
+
+					lookup->queries[i].id = id;
+					ids_.emplace(id, std::make_pair(lookup, i));
+				}
+
+				Send(*lookup);
+			}
+		}
+
+		void Retransmit(Lookup& lookup)
+		{
+			if (lookup.attempt < options_.attempts)
+			{
+				Send(lookup);
+				return;
+			}
+
+			for (size_t i = 0; i < lookup.count; ++i)
+			{
+				Query& query = lookup.queries[i];
+				if (!query.done)
+				{
+					query.done = true;
+					query.error = EAI_AGAIN;
+				}
+			}
+
+			Finish(lookup);
+		}
+
+		/**
+		 * @brief Caches the result of a lookup whose queries are all done and hands it to its waiters.
+		 */
+		void Finish(Lookup& lookup)
+		{
+			lookup.Cancel();
+
+			Entry entry{ EAI_NONAME, 0, {} };
+			uint32_t ttl = options_.maxTtl;
+			bool cacheable = true;
+
+			for (size_t i = 0; i < lookup.count; ++i)
+			{
+				Query& query = lookup.queries[i];
+				ids_.erase(query.id);
+
+				if (query.error == 0)
+				{
+					entry.error = 0;
+					entry.records.insert(entry.records.end(), query.records.begin(), query.records.end());
+				}
+
+				if (query.error == EAI_AGAIN)
+					cacheable = false;
+				else
+					ttl = std::min(ttl, query.ttl);
+			}
+
+			// A name with some addresses is usable even if the query for the other family failed, but is not cached.
+			if (entry.error != 0 && !cacheable)
+				entry.error = EAI_AGAIN;
+
+			std::unique_ptr<Lookup> finished;
+			std::vector<Waiter> waiters;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				if (cacheable && ttl != 0)
+				{
+					entry.expiry = Reactor::Now() + (uint64_t)ttl * 1000;
+					Store(lookup.key, entry);
+				}
+
+				waiters.swap(lookup.waiters);
+
+				auto found = lookups_.find(lookup.key);
+				finished = std::move(found->second);
+				lookups_.erase(found);
+			}
+
+			for (const Waiter& waiter : waiters)
+				Deliver(waiter, entry.error, entry.records);
+		}
+
+		/**
+		 * @brief Adds an entry to the cache, making room by dropping expired entries, or any entry if none are. The mutex must be held.
+		 */
+		void Store(const std::string& key, const Entry& entry)
+		{
+			if (cache_.size() >= options_.capacity && cache_.count(key) == 0)
+			{
+				const uint64_t now = Reactor::Now();
+				for (auto i = cache_.begin(); i != cache_.end(); )
+					i = i->second.expiry <= now ? cache_.erase(i) : std::next(i);
+
+				if (cache_.size() >= options_.capacity)
+					cache_.erase(cache_.begin());
+			}
+
+			cache_[key] = entry;
+		}
+
+		static void Deliver(const Waiter& waiter, const int error, const std::vector<CompactAddress>& records)
+		{
+			std::vector<Address> addresses;
+			addresses.reserve(records.size());
+
+			for (const CompactAddress& record : records)
+				addresses.push_back(CompactAddress(record.family(), record.bytes(), waiter.port).ToAddress());
+
+			waiter.callback(error, addresses);
+		}
+
+		void OnReadable(Socket& socket) override
+		{
+			uint8_t message[MAX_MESSAGE];
+
+			for (;;)
+			{
+				const int received = socket.Receive((char*)message, (int)sizeof(message));
+				if (received < 0)
+					break;
+
+				if (received < 12)
+					continue;
+
+				const auto found = ids_.find(Read16(message));
+				if (found == ids_.end())
+					continue;
+
+				Lookup& lookup = *found->second.first;
+				Query& query = lookup.queries[found->second.second];
+				if (query.done || !ParseAnswer(query, lookup.name, message, (size_t)received))
+					continue;
+
+				query.done = true;
+
+				bool done = true;
+				for (size_t i = 0; i < lookup.count; ++i)
+					done &= lookup.queries[i].done;
+
+				if (done)
+					Finish(lookup);
+			}
+		}
+
+		void Run()
+		{
+			while (!stopping_.load(std::memory_order_acquire))
+			{
+				reactor_.RunOnce();
+				Submit();
+			}
+
+			// Lookups still in flight fail, so no caller waits forever.
+			std::vector<Lookup*> pending;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (auto& lookup : lookups_)
+					pending.push_back(lookup.second.get());
+				submitted_.clear();
+			}
+
+			for (Lookup* lookup : pending)
+			{
+				for (size_t i = 0; i < lookup->count; ++i)
+				{
+					lookup->queries[i].done = true;
+					lookup->queries[i].error = EAI_AGAIN;
+				}
+
+				Finish(*lookup);
+			}
+		}
+
+		/**
+		 * @brief Reads the name servers of the system from /etc/resolv.conf.
+		 */
+		static std::vector<Address> SystemNameServers()
+		{
+			std::vector<Address> servers;
+			std::ifstream file("/etc/resolv.conf");
+			std::string line;
+
+			while (std::getline(file, line))
+			{
+				if (line.compare(0, 10, "nameserver") != 0 || line.size() < 12 || (line[10] != ' ' && line[10] != '\t'))
+					continue;
+
+				// A keyword followed only by blanks names no server.
+				const size_t start = line.find_first_not_of(" \t", 10);
+				if (start == std::string::npos)
+					continue;
+
+				const size_t end = line.find_first_of(" \t#;", start);
+				const std::string text = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+
+				CompactAddress server;
+				if (ParseAddress(text.data(), text.size(), server))
+					servers.push_back(CompactAddress(server.family(), server.bytes(), 53, server.scope()).ToAddress());
+			}
+
+			if (servers.empty())
+				servers.emplace_back(AddressFamily::INET, "127.0.0.1", 53);
+
+			return servers;
+		}
+
+	public:
+		/**
+		 * @brief Creates a resolver using the name servers of the system, and starts its thread.
+		 *
+		 * @param {const ResolverOptions&} options - The tunables of the resolver.
+		 */
+		explicit Resolver(const ResolverOptions& options = ResolverOptions()) : Resolver(SystemNameServers(), options) {}
+
+		/**
+		 * @brief Creates a resolver using the specified name servers, and starts its thread.
+		 *
+		 * @param {const std::vector<Address>&} servers - The name servers, asked in turn when one does not answer.
+		 * @param {const ResolverOptions&} options - The tunables of the resolver.
+		 */
+		Resolver(const std::vector<Address>& servers, const ResolverOptions& options = ResolverOptions()) :
+			options_(options), stopping_(false), queries_(0), random_(std::random_device()())
+		{
+			for (const Address& server : servers)
+			{
+				sockets_.emplace_back((AddressFamily)server.name()->sa_family, SocketType::DATAGRAM, SocketProtocol::UDP);
+				Socket& socket = sockets_.back();
+
+				if (!socket.Connect(server) || !socket.SetBlocking(false) || !reactor_.Add(socket, *this, Interest::READ))
+					sockets_.pop_back();
+			}
+
+			if (*this)
+				thread_ = std::thread([this]() { Run(); });
+		}
+
+		Resolver(const Resolver&) = delete;
+		Resolver& operator=(const Resolver&) = delete;
+
+		/**
+		 * @brief Stops the thread of the resolver. Lookups still in flight complete with EAI_AGAIN.
+		 */
+		~Resolver()
+		{
+			stopping_.store(true, std::memory_order_release);
+			reactor_.Wake();
+
+			if (thread_.joinable())
+				thread_.join();
+
+			for (Socket& socket : sockets_)
+				reactor_.Remove(socket);
+		}
+
+		/**
+		 * @brief Returns whether the resolver has a name server to ask.
+		 */
+		explicit operator bool() const
+		{
+			return reactor_ && !sockets_.empty();
+		}
+
+		/**
+		 * @brief Looks up the addresses of a host.
+		 *
+		 * @param {const char*} host - The name or numeric address of the host.
+		 * @param {unsigned short} port - The port given to every address.
+		 * @param {Callback} callback - Receives the result, see Callback for the thread it is called on.
+		 * @param {AddressFamily} family - The family to look up. Defaults to UNSPEC for both IPv4 and IPv6.
+		 */
+		void Resolve(const char* host, const unsigned short port, Callback callback, const AddressFamily family = AddressFamily::UNSPEC)
+		{
+			Waiter waiter{ port, std::move(callback) };
+
+			const size_t length = std::strlen(host);
+			uint8_t bytes[16];
+			const int numeric = ParseIPv4(host, length, bytes) ? AF_INET : ParseIPv6(host, length, bytes) ? AF_INET6 : AF_UNSPEC;
+
+			if (numeric != AF_UNSPEC)
+			{
+				if (family != AddressFamily::UNSPEC && (int)family != numeric)
+					Deliver(waiter, EAI_NONAME, {});
+				else
+					Deliver(waiter, 0, { CompactAddress(numeric, bytes, 0) });
+
+				return;
+			}
+
+			std::string name;
+			if (!Normalize(host, name) || !*this)
+			{
+				Deliver(waiter, !*this ? EAI_AGAIN : EAI_NONAME, {});
+				return;
+			}
+
+			if (name == "localhost" || (name.size() > 10 && name.compare(name.size() - 10, 10, ".localhost") == 0))
+			{
+				std::vector<CompactAddress> loopback;
+				if (family != AddressFamily::INET)
+					loopback.push_back(CompactAddress(AF_INET6, in6addr_loopback.s6_addr, 0));
+				if (family != AddressFamily::INET6)
+					loopback.push_back(CompactAddress(AF_INET, (const uint8_t*)"\x7f\x00\x00\x01", 0));
+
+				Deliver(waiter, 0, loopback);
+				return;
+			}
+
+			const std::string key = name + (family == AddressFamily::INET ? "/4" : family == AddressFamily::INET6 ? "/6" : "/*");
+
+			std::unique_lock<std::mutex> lock(mutex_);
+
+			const auto cached = cache_.find(key);
+			if (cached != cache_.end())
+			{
+				if (cached->second.expiry > Reactor::Now())
+				{
+					const Entry entry = cached->second;
+					lock.unlock();
+
+					Deliver(waiter, entry.error, entry.records);
+					return;
+				}
+
+				cache_.erase(cached);
+			}
+
+			// A lookup already in flight answers this caller too.
+			std::unique_ptr<Lookup>& lookup = lookups_[key];
+			if (lookup == nullptr)
+			{
+				lookup.reset(new Lookup(*this, key, std::move(name), family));
+				submitted_.push_back(lookup.get());
+				reactor_.Wake();
+			}
+
+			lookup->waiters.push_back(std::move(waiter));
+		}
+
+		/**
+		 * @brief Forgets every cached result.
+		 */
+		void Clear()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			cache_.clear();
+		}
+
+		/**
+		 * @brief Returns the number of cached results, including expired ones not yet dropped.
+		 *
+		 * @return {size_t} The number of cached names.
+		 */
+		size_t cached() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return cache_.size();
+		}
+
+		/**
+		 * @brief Returns the number of queries sent, including retransmissions.
+		 *
+		 * @return {uint64_t} The number of queries sent.
+		 */
+		uint64_t queries() const
+		{
+			return queries_.load(std::memory_order_relaxed);
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__
+
+#endif // CPP_RESOLVER_HPP
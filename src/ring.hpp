@@ -0,0 +1,598 @@
+#ifndef CPP_RING_HPP
+#define CPP_RING_HPP
+
+#include <new>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#include "netstack.h"
+#include "socket.hpp"
+
+#if defined(__linux__)
+#include <climits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace netstack
+{
+	/**
+	 * @brief A connection between two processes on the same host over a pair of rings in shared memory, with the
+	 * Send and Receive surface of a stream Socket.
+	 *
+	 * One side offers the memory over a UNIX socket with Offer, passing a memfd sealed against resizing, and the other
+	 * maps it with Accept. Each direction is a single-producer single-consumer byte ring, so sending and receiving are
+	 * a memcpy and a couple of atomic operations with no system call while the peer keeps up. A side that has to wait
+	 * spins for a while, then sleeps on a futex in the shared memory, and is only woken with a system call when it
+	 * announced that it sleeps.
+	 *
+	 * Each side must be used by one thread at a time. The death of the peer process is not detected by the ring, so
+	 * callers should also watch the UNIX socket it was offered over.
+	 */
+	class RingSocket
+	{
+	private:
+		static constexpr uint32_t MAGIC = 0x52494e47;	///< "RING", identifies the memory.
+		static constexpr uint32_t VERSION = 1;			///< The layout of the memory.
+		static constexpr size_t CACHE_LINE = 64;
+
+		/**
+		 * @brief The positions of one ring. Each side only writes its own cache line.
+		 */
+		struct Ring
+		{
+			alignas(CACHE_LINE) std::atomic<uint64_t> head;	///< The bytes written, by the producer.
+			std::atomic<uint32_t> written;					///< A futex the consumer sleeps on, bumped by the producer.
+			std::atomic<uint32_t> producerWaiting;			///< Whether the producer sleeps for room.
+
+			alignas(CACHE_LINE) std::atomic<uint64_t> tail;	///< The bytes read, by the consumer.
+			std::atomic<uint32_t> read;						///< A futex the producer sleeps on, bumped by the consumer.
+			std::atomic<uint32_t> consumerWaiting;			///< Whether the consumer sleeps for data.
+
+			alignas(CACHE_LINE) std::atomic<uint32_t> closed;	///< Whether either side has closed.
+		};
+
+		/**
+		 * @brief The start of the shared memory, followed by the data of both rings.
+		 */
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t capacity;	///< The size of each ring, a power of two.
+			Ring rings[2];		///< The ring from the offering side, then the ring back to it.
+		};
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+			"Atomics in shared memory must be lock free");
+
+		static constexpr size_t DATA_OFFSET = (sizeof(Header) + 4095) & ~(size_t)4095;	///< Where the data of the rings starts.
+
+		Header* header_;		///< The shared memory, null if not connected.
+		size_t size_;			///< The size of the mapping.
+		Ring* out_;				///< The ring this side produces into.
+		Ring* in_;				///< The ring this side consumes from.
+		char* outData_;
+		char* inData_;
+		uint64_t mask_;			///< The capacity of a ring less one.
+		uint64_t peerTail_;		///< The last tail seen of the outgoing ring, so room is rarely read from the peer's line.
+		uint64_t peerHead_;		///< The last head seen of the incoming ring.
+		uint32_t spin_;			///< The polls made before sleeping.
+		bool blocking_;
+		bool broken_;			///< Whether the peer left the positions of a ring out of range.
+
+		RingSocket(Header* header, const size_t size, const bool offered) :
+			header_(header), size_(size), out_(&header->rings[offered ? 0 : 1]), in_(&header->rings[offered ? 1 : 0]),
+			outData_((char*)header + DATA_OFFSET + (offered ? 0 : header->capacity)),
+			inData_((char*)header + DATA_OFFSET + (offered ? header->capacity : 0)),
+			mask_(header->capacity - 1), peerTail_(0), peerHead_(0), spin_(DefaultSpin()), blocking_(true), broken_(false)
+		{
+			peerTail_ = out_->tail.load(std::memory_order_acquire);
+			peerHead_ = in_->head.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * @brief Returns the polls made before sleeping by default. Spinning only pays off while the peer runs on another core.
+		 */
+		static uint32_t DefaultSpin()
+		{
+			return std::thread::hardware_concurrency() > 1 ? 2000 : 0;
+		}
+
+		static void Pause()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+#elif defined(__aarch64__)
+			__asm__ __volatile__("yield");
+#endif
+		}
+
+		static void Wait(std::atomic<uint32_t>& futex, const uint32_t value)
+		{
+			syscall(SYS_futex, (uint32_t*)&futex, FUTEX_WAIT, value, nullptr, nullptr, 0);
+		}
+
+		static void Wake(std::atomic<uint32_t>& futex, std::atomic<uint32_t>& waiting)
+		{
+			// Sleepers announce themselves first, so a busy peer is never woken with a system call.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (waiting.load(std::memory_order_relaxed) == 0)
+				return;
+
+			futex.fetch_add(1, std::memory_order_release);
+			syscall(SYS_futex, (uint32_t*)&futex, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+		}
+
+		/**
+		 * @brief Waits until a condition holds, the ring is closed or, for a non-blocking socket, right away.
+		 */
+		template <typename Ready>
+		bool Await(Ring& ring, std::atomic<uint32_t>& futex, std::atomic<uint32_t>& waiting, Ready ready)
+		{
+			for (uint32_t i = 0; ; ++i)
+			{
+				if (ready() || ring.closed.load(std::memory_order_acquire) != 0)
+					return true;
+
+				if (!blocking_)
+					return false;
+
+				if (i >= spin_)
+					break;
+
+				Pause();
+			}
+
+			for (;;)
+			{
+				const uint32_t value = futex.load(std::memory_order_acquire);
+				waiting.store(1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (ready() || ring.closed.load(std::memory_order_acquire) != 0)
+					break;
+
+				Wait(futex, value);
+			}
+
+			waiting.store(0, std::memory_order_relaxed);
+
+			return true;
+		}
+
+		/**
+		 * @brief Marks both rings closed and wakes every sleeper on them.
+		 */
+		void Shut()
+		{
+			for (Ring& ring : header_->rings)
+			{
+				ring.closed.store(1, std::memory_order_release);
+				ring.written.fetch_add(1, std::memory_order_release);
+				ring.read.fetch_add(1, std::memory_order_release);
+				syscall(SYS_futex, (uint32_t*)&ring.written, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+				syscall(SYS_futex, (uint32_t*)&ring.read, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+			}
+		}
+
+		/**
+		 * @brief Ends a connection whose peer claims more data or room than a ring holds, rather than copying out of bounds.
+		 */
+		void Break()
+		{
+			broken_ = true;
+			Shut();
+		}
+
+		size_t Readable()
+		{
+			const uint64_t head = in_->head.load(std::memory_order_acquire);
+			const uint64_t available = head - in_->tail.load(std::memory_order_relaxed);
+			if (available > mask_ + 1)
+			{
+				Break();
+				return 0;
+			}
+
+			peerHead_ = head;
+
+			return (size_t)available;
+		}
+
+		size_t Writable()
+		{
+			const uint64_t head = out_->head.load(std::memory_order_relaxed);
+			if (head - peerTail_ > mask_)
+			{
+				const uint64_t tail = out_->tail.load(std::memory_order_acquire);
+				if (head - tail > mask_ + 1)
+				{
+					Break();
+					return 0;
+				}
+
+				peerTail_ = tail;
+			}
+
+			return (size_t)(mask_ + 1 - (head - peerTail_));
+		}
+
+		/**
+		 * @brief Copies up to length bytes out of the incoming ring, consuming them unless peeking.
+		 */
+		size_t Read(char* buffer, const size_t length, const bool peek)
+		{
+			const uint64_t tail = in_->tail.load(std::memory_order_relaxed);
+			size_t available = (size_t)(peerHead_ - tail);
+			if (available == 0 || available > mask_ + 1)
+				available = Readable();
+
+			const size_t count = std::min(available, length);
+			const size_t offset = (size_t)(tail & mask_);
+			const size_t first = std::min(count, (size_t)(mask_ + 1) - offset);
+
+			std::memcpy(buffer, inData_ + offset, first);
+			std::memcpy(buffer + first, inData_, count - first);
+
+			if (!peek && count != 0)
+			{
+				in_->tail.store(tail + count, std::memory_order_release);
+				Wake(in_->read, in_->producerWaiting);
+			}
+
+			return count;
+		}
+
+		/**
+		 * @brief Copies up to length bytes into the outgoing ring.
+		 */
+		size_t Write(const char* buffer, const size_t length)
+		{
+			const uint64_t head = out_->head.load(std::memory_order_relaxed);
+			const size_t count = std::min(Writable(), length);
+			const size_t offset = (size_t)(head & mask_);
+			const size_t first = std::min(count, (size_t)(mask_ + 1) - offset);
+
+			std::memcpy(outData_ + offset, buffer, first);
+			std::memcpy(outData_, buffer + first, count - first);
+
+			if (count != 0)
+			{
+				out_->head.store(head + count, std::memory_order_release);
+				Wake(out_->written, out_->consumerWaiting);
+			}
+
+			return count;
+		}
+
+	public:
+		/**
+		 * @brief Creates an unconnected ring socket.
+		 */
+		RingSocket() : header_(nullptr), size_(0), out_(nullptr), in_(nullptr), outData_(nullptr), inData_(nullptr),
+			mask_(0), peerTail_(0), peerHead_(0), spin_(DefaultSpin()), blocking_(true), broken_(false) {}
+
+		RingSocket(RingSocket&& other) noexcept : RingSocket()
+		{
+			*this = std::move(other);
+		}
+
+		RingSocket& operator=(RingSocket&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Close();
+				header_ = std::exchange(other.header_, nullptr);
+				size_ = std::exchange(other.size_, 0);
+				out_ = other.out_;
+				in_ = other.in_;
+				outData_ = other.outData_;
+				inData_ = other.inData_;
+				mask_ = other.mask_;
+				peerTail_ = other.peerTail_;
+				peerHead_ = other.peerHead_;
+				spin_ = other.spin_;
+				blocking_ = other.blocking_;
+				broken_ = other.broken_;
+			}
+
+			return *this;
+		}
+
+		RingSocket(const RingSocket&) = delete;
+		RingSocket& operator=(const RingSocket&) = delete;
+
+		/**
+		 * @brief Closes the connection and unmaps the shared memory.
+		 */
+		~RingSocket()
+		{
+			Close();
+		}
+
+		/**
+		 * @brief Creates the shared memory of a connection and passes it to the peer over a connected UNIX socket.
+		 *
+		 * @param {Socket&} control - The UNIX socket to the peer, which calls Accept on its end.
+		 * @param {size_t} capacity - The size of the ring in each direction, rounded up to a power of two of at least 4 KiB. Defaults to 256 KiB.
+		 * @return {RingSocket} The connection, which converts to false on failure.
+		 */
+		static RingSocket Offer(Socket& control, const size_t capacity = 256 * 1024)
+		{
+			size_t rounded = 4096;
+			while (rounded < capacity)
+				rounded *= 2;
+
+			const int memory = (int)syscall(SYS_memfd_create, "netstack-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+			if (memory < 0)
+				return RingSocket();
+
+			// Sealing the size keeps the peer from truncating the memory under both sides, which would fault every access.
+			const size_t size = DATA_OFFSET + rounded * 2;
+			void* mapping = ftruncate(memory, (off_t)size) == 0 && fcntl(memory, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == 0
+				? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0) : MAP_FAILED;
+			if (mapping == MAP_FAILED)
+			{
+				close(memory);
+				return RingSocket();
+			}
+
+			Header* header = new (mapping) Header();
+			header->magic = MAGIC;
+			header->version = VERSION;
+			header->capacity = rounded;
+
+			const bool sent = control.SendDescriptors("R", 1, &memory, 1) == 1;
+			close(memory);
+
+			if (!sent)
+			{
+				munmap(mapping, size);
+				return RingSocket();
+			}
+
+			return RingSocket(header, size, true);
+		}
+
+		/**
+		 * @brief Maps the shared memory of a connection offered by the peer over a connected UNIX socket, waiting for the offer.
+		 *
+		 * @param {Socket&} control - The UNIX socket to the peer, which calls Offer on its end.
+		 * @return {RingSocket} The connection, which converts to false on failure.
+		 */
+		static RingSocket Accept(Socket& control)
+		{
+			char tag;
+			int memory = -1;
+			size_t count = 1;
+
+			if (control.ReceiveDescriptors(&tag, 1, &memory, count) != 1 || count != 1 || tag != 'R')
+			{
+				if (count == 1)
+					close(memory);
+
+				return RingSocket();
+			}
+
+			// Memory the peer could still shrink is refused, as truncating it would fault every access to the ring.
+			const int seals = fcntl(memory, F_GET_SEALS);
+			struct stat status;
+			void* mapping = seals >= 0 && (seals & F_SEAL_SHRINK) != 0 && fstat(memory, &status) == 0 && (size_t)status.st_size > DATA_OFFSET
+				? mmap(nullptr, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0) : MAP_FAILED;
+			close(memory);
+
+			if (mapping == MAP_FAILED)
+				return RingSocket();
+
+			// The layout must match and the rings must fit in the memory that was passed.
+			Header* header = (Header*)mapping;
+			const size_t size = (size_t)status.st_size;
+			const uint64_t capacity = header->capacity;
+
+			if (header->magic != MAGIC || header->version != VERSION || capacity == 0 || (capacity & (capacity - 1)) != 0 || DATA_OFFSET + capacity * 2 != size)
+			{
+				munmap(mapping, size);
+				return RingSocket();
+			}
+
+			return RingSocket(header, size, false);
+		}
+
+		/**
+		 * @brief Returns whether the socket is connected to a peer.
+		 */
+		explicit operator bool() const
+		{
+			return header_ != nullptr;
+		}
+
+		/**
+		 * @brief Sends data to the peer. A blocking socket waits for room until all of it is sent.
+		 *
+		 * @param {const char*} buffer - The data to send.
+		 * @param {int} length - The length of the data.
+		 * @param {int} flags - Unused, for the signature of Socket::Send. Defaults to 0.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR with errno set to EAGAIN if a non-blocking socket is full
+		 * EPIPE if the connection is closed, ECONNRESET if the peer corrupted the ring and ENOTCONN if it never connected.
+		 */
+		int Send(const char* buffer, const int length, const int flags = 0)
+		{
+			(void)flags;
+			size_t sent = 0;
+
+			if (header_ == nullptr)
+			{
+				errno = ENOTCONN;
+				return -1;
+			}
+
+			while (sent < (size_t)length)
+			{
+				if (out_->closed.load(std::memory_order_acquire) != 0)
+				{
+					errno = broken_ ? ECONNRESET : EPIPE;
+					return sent > 0 ? (int)sent : -1;
+				}
+
+				sent += Write(buffer + sent, (size_t)length - sent);
+				if (sent == (size_t)length)
+					break;
+
+				if (!Await(*out_, out_->read, out_->producerWaiting, [this]() { return Writable() != 0; }))
+				{
+					errno = EAGAIN;
+					return sent > 0 ? (int)sent : -1;
+				}
+			}
+
+			return (int)sent;
+		}
+
+		/**
+		 * @brief Sends the contents of a buffer to the peer.
+		 *
+		 * @param {const std::string&} buffer - The data to send.
+		 * @param {SendFlags} flags - Unused, for the signature of Socket::Send. Defaults to NONE.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR.
+		 */
+		int Send(const std::string& buffer, const SendFlags flags = SendFlags::NONE)
+		{
+			return Send(buffer.data(), (int)buffer.size(), (int)flags);
+		}
+
+		/**
+		 * @brief Receives the data available from the peer. A blocking socket waits for at least one byte.
+		 *
+		 * @param {char*} buffer - The buffer to store the received data.
+		 * @param {int} length - The length of the buffer.
+		 * @param {int} flags - MSG_PEEK to leave the data in the ring, others are ignored. Defaults to 0.
+		 * @return {int} The number of bytes received, 0 once the peer has closed and everything it sent was received, or
+		 * SOCKET_ERROR with errno set to EAGAIN if a non-blocking socket has nothing to receive and ECONNRESET if the peer
+		 * corrupted the ring.
+		 */
+		int Receive(char* buffer, const int length, const int flags = 0)
+		{
+			if (header_ == nullptr)
+			{
+				errno = ENOTCONN;
+				return -1;
+			}
+
+			if (length <= 0)
+				return 0;
+
+			if (!Await(*in_, in_->written, in_->consumerWaiting, [this]() { return Readable() != 0; }))
+			{
+				errno = EAGAIN;
+				return -1;
+			}
+
+			// Data sent before closing is still delivered.
+			const size_t count = Read(buffer, (size_t)length, (flags & MSG_PEEK) != 0);
+			if (count == 0 && broken_)
+			{
+				errno = ECONNRESET;
+				return -1;
+			}
+
+			return (int)count;
+		}
+
+		/**
+		 * @brief Receives the data available from the peer and appends it to the specified buffer.
+		 *
+		 * @param {std::string&} buffer - The buffer to append the received data to.
+		 * @param {ReceiveFlags} flags - PEEK to leave the data in the ring. Defaults to NONE.
+		 * @return {int} The number of bytes appended, 0 if the peer closed the connection, or SOCKET_ERROR.
+		 */
+		int Receive(std::string& buffer, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			if (header_ == nullptr)
+			{
+				errno = ENOTCONN;
+				return -1;
+			}
+
+			if (!Await(*in_, in_->written, in_->consumerWaiting, [this]() { return Readable() != 0; }))
+			{
+				errno = EAGAIN;
+				return -1;
+			}
+
+			const size_t available = Readable();
+			if (broken_)
+			{
+				errno = ECONNRESET;
+				return -1;
+			}
+
+			const size_t size = buffer.size();
+			buffer.resize(size + available);
+
+			return (int)Read(&buffer[size], available, flags == ReceiveFlags::PEEK);
+		}
+
+		/**
+		 * @brief Switches the socket between blocking and non-blocking mode.
+		 *
+		 * @param {bool} blocking - Whether sends and receives should wait until they can make progress.
+		 * @returns {bool} - True if the socket is connected.
+		 */
+		bool SetBlocking(const bool blocking)
+		{
+			blocking_ = blocking;
+
+			return header_ != nullptr;
+		}
+
+		/**
+		 * @brief Sets how many times a blocking call polls the ring before sleeping. Spinning longer lowers the latency
+		 * of bursts at the cost of a busy core.
+		 *
+		 * @param {uint32_t} spin - The number of polls. 0 sleeps at once, the default on a single core.
+		 */
+		void SetSpin(const uint32_t spin)
+		{
+			spin_ = spin;
+		}
+
+		/**
+		 * @brief Closes both directions, waking the peer, and unmaps the shared memory.
+		 */
+		void Close()
+		{
+			if (header_ == nullptr)
+				return;
+
+			Shut();
+			munmap(header_, size_);
+			header_ = nullptr;
+		}
+
+		/**
+		 * @brief Returns the size of the ring in each direction.
+		 *
+		 * @return {size_t} The capacity of a ring.
+		 */
+		size_t capacity() const
+		{
+			return header_ == nullptr ? 0 : (size_t)(mask_ + 1);
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__
+
+#endif // CPP_RING_HPP
@@ -0,0 +1,325 @@
+#ifndef CPP_SERVER_HPP
+#define CPP_SERVER_HPP
+
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "netstack.h"
+#include "address.hpp"
+#include "socket.hpp"
+#include "listener.hpp"
+#include "reactor.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+
+namespace netstack
+{
+	/**
+	 * @brief One worker of a ShardedServer: a thread with its own listening socket and event loop.
+	 */
+	class Shard : private Handler
+	{
+		friend class ShardedServer;
+	public:
+		/**
+		 * @brief Called on the thread of a shard for every connection it accepts.
+		 *
+		 * The callback is given the non-blocking connection and would usually move it somewhere that outlives the call,
+		 * such as a SocketTable, and register it with the reactor of the shard, so the connection never leaves the
+		 * thread that accepted it. A connection left in the argument is closed.
+		 */
+		using AcceptCallback = std::function<void(Shard& shard, Socket connection, const Address& peer)>;
+
+	private:
+		static constexpr size_t BATCH = 64;	///< The most connections taken from the queue per accept batch.
+
+		size_t index_;					///< The position of the shard in its server.
+		TcpListener listener_;			///< The listening socket, bound with SO_REUSEPORT.
+		Reactor reactor_;				///< The event loop of the shard.
+		AcceptCallback& callback_;		///< Receives every accepted connection.
+		std::thread thread_;			///< Runs the event loop.
+		std::atomic<uint64_t> accepted_;///< The number of connections accepted.
+		std::atomic<uint64_t> dropped_;	///< The number of connections closed unserved for want of descriptors.
+		std::vector<AcceptedConnection> connections_;	///< The batch being handed to the callback.
+		int reserve_;					///< A descriptor held back to accept with when the process runs out.
+
+		void OnReadable(Socket&) override
+		{
+			// The listener is edge triggered, so the queue is drained until it reports empty, or no new edge would come.
+			for (;;)
+			{
+				const size_t count = listener_.AcceptBatch(connections_, BATCH);
+				const int error = nsSocketError();
+
+				for (AcceptedConnection& connection : connections_)
+				{
+					accepted_.fetch_add(1, std::memory_order_relaxed);
+					callback_(*this, std::move(connection.socket), connection.peer);
+				}
+
+				connections_.clear();
+
+				if (count == BATCH || ((error == EMFILE || error == ENFILE) && Shed()))
+					continue;
+
+				break;
+			}
+		}
+
+		/**
+		 * @brief Gives up the reserve descriptor to accept and close the oldest queued connection, when out of
+		 * descriptors. Otherwise the queue would stay full and the shard would never be woken again.
+		 *
+		 * @return {bool} True if a connection was dropped, or the queue may still hold some.
+		 */
+		bool Shed()
+		{
+			if (reserve_ < 0)
+				return false;
+
+			close(reserve_);
+			const SOCKET dropped = accept(listener_.socket().handle(), nullptr, nullptr);
+			const int error = errno;
+
+			// The connection is closed before the reserve is taken back, as it holds the only free descriptor.
+			if (nsIsValidSocket(dropped))
+			{
+				nsCloseSocket(dropped);
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			reserve_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+			return nsIsValidSocket(dropped) || error == ECONNABORTED || error == EINTR;
+		}
+
+	public:
+		/**
+		 * @brief Creates a shard. The server binds and starts it.
+		 */
+		Shard(const size_t index, AcceptCallback& callback) :
+			index_(index), callback_(callback), accepted_(0), dropped_(0), reserve_(open("/dev/null", O_RDONLY | O_CLOEXEC))
+		{
+			connections_.reserve(BATCH);
+		}
+
+		Shard(const Shard&) = delete;
+		Shard& operator=(const Shard&) = delete;
+
+		~Shard()
+		{
+			if (reserve_ >= 0)
+				close(reserve_);
+		}
+
+		/**
+		 * @brief Returns the event loop of the shard, for connections accepted by it.
+		 *
+		 * @return {Reactor&} The event loop.
+		 */
+		Reactor& reactor()
+		{
+			return reactor_;
+		}
+
+		/**
+		 * @brief Returns the position of the shard in its server.
+		 *
+		 * @return {size_t} The index of the shard.
+		 */
+		size_t index() const
+		{
+			return index_;
+		}
+
+		/**
+		 * @brief Returns the number of connections the shard has accepted.
+		 *
+		 * @return {uint64_t} The number of connections accepted.
+		 */
+		uint64_t accepted() const
+		{
+			return accepted_.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Returns the number of connections the shard closed unserved because the process was out of descriptors.
+		 *
+		 * @return {uint64_t} The number of connections dropped.
+		 */
+		uint64_t dropped() const
+		{
+			return dropped_.load(std::memory_order_relaxed);
+		}
+	};
+
+	/**
+	 * @brief A TCP server with one listening socket, event loop and thread per shard.
+	 *
+	 * Every shard binds its own socket to the same address with SO_REUSEPORT, so the kernel spreads incoming
+	 * connections across the accept queues of the shards. Accepting and serving a connection never crosses threads
+	 * or takes a lock, and each thread can be pinned to its own core. A shard that runs out of descriptors closes the
+	 * connections it cannot accept rather than letting its queue fill, see Shard::dropped.
+	 */
+	class ShardedServer
+	{
+	private:
+		std::deque<Shard> shards_;				///< The shards, which never move once created.
+		Shard::AcceptCallback callback_;		///< Receives the connections accepted by every shard.
+		Address address_;						///< The address every shard listens on.
+		size_t count_;							///< The number of shards.
+		bool running_;							///< Whether the shard threads are running.
+
+	public:
+		/**
+		 * @brief Creates a server with the specified number of shards.
+		 *
+		 * @param {size_t} shards - The number of shards. Defaults to one per hardware thread if 0.
+		 */
+		ShardedServer(const size_t shards = 0) :
+			count_(shards != 0 ? shards : std::max(1u, std::thread::hardware_concurrency())), running_(false) {}
+
+		ShardedServer(const ShardedServer&) = delete;
+		ShardedServer& operator=(const ShardedServer&) = delete;
+
+		/**
+		 * @brief Stops the server.
+		 */
+		~ShardedServer()
+		{
+			Stop();
+		}
+
+		/**
+		 * @brief Binds every shard to the address and starts their threads.
+		 *
+		 * @param {const Address&} address - The address to listen on. Port 0 picks one ephemeral port shared by every shard.
+		 * @param {Shard::AcceptCallback} callback - Called on the accepting shard for every connection.
+		 * @param {int} backlog - The accept queue length of each shard. Defaults to SOMAXCONN if not specified.
+		 * @param {bool} pin - Whether to pin the thread of shard i to core i modulo the number of cores. Defaults to true.
+		 * @return {bool} True if every shard is listening.
+		 */
+		bool Start(const Address& address, Shard::AcceptCallback callback, const int backlog = SOMAXCONN, const bool pin = true)
+		{
+			if (running_)
+				return false;
+
+			callback_ = std::move(callback);
+			address_ = address;
+
+			ListenerOptions options;
+			options.backlog = backlog;
+			options.reusePort = true;
+
+			for (size_t i = 0; i < count_; ++i)
+			{
+				shards_.emplace_back(i, callback_);
+				Shard& shard = shards_.back();
+
+				// Later shards reuse the port the first one was given.
+				if (!shard.listener_.Listen(address_, options))
+				{
+					shards_.clear();
+					return false;
+				}
+
+				if (i == 0)
+					address_ = shard.listener_.address();
+
+				shard.reactor_.Add(shard.listener_.socket(), shard, Interest::READ, Trigger::EDGE);
+			}
+
+			const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+			for (Shard& shard : shards_)
+			{
+				shard.thread_ = std::thread([&shard]() { shard.reactor_.Run(); });
+
+				if (pin)
+				{
+					cpu_set_t set;
+					CPU_ZERO(&set);
+					CPU_SET(shard.index_ % cores, &set);
+					pthread_setaffinity_np(shard.thread_.native_handle(), sizeof(set), &set);
+				}
+			}
+
+			running_ = true;
+
+			return true;
+		}
+
+		/**
+		 * @brief Stops the event loop of every shard, waits for their threads and closes the listening sockets.
+		 */
+		void Stop()
+		{
+			if (!running_)
+				return;
+
+			for (Shard& shard : shards_)
+				shard.reactor_.Stop();
+
+			for (Shard& shard : shards_)
+				shard.thread_.join();
+
+			shards_.clear();
+			running_ = false;
+		}
+
+		/**
+		 * @brief Returns the address the shards listen on, including the port picked for port 0.
+		 *
+		 * @return {const Address&} The listening address.
+		 */
+		const Address& address() const
+		{
+			return address_;
+		}
+
+		/**
+		 * @brief Returns a shard of a started server.
+		 *
+		 * @param {size_t} index - The index of the shard.
+		 * @return {Shard&} The shard.
+		 */
+		Shard& shard(const size_t index)
+		{
+			return shards_[index];
+		}
+
+		/**
+		 * @brief Returns the number of shards.
+		 *
+		 * @return {size_t} The number of shards.
+		 */
+		size_t size() const
+		{
+			return count_;
+		}
+
+		/**
+		 * @brief Returns the number of connections accepted by every shard together.
+		 *
+		 * @return {uint64_t} The number of connections accepted.
+		 */
+		uint64_t accepted() const
+		{
+			uint64_t total = 0;
+			for (const Shard& shard : shards_)
+				total += shard.accepted();
+
+			return total;
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__
+
+#endif // CPP_SERVER_HPP
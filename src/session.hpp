@@ -0,0 +1,440 @@
+#ifndef CPP_SESSION_HPP
+#define CPP_SESSION_HPP
+
+#include <new>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "address.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#ifndef NS_HAS_SSE2
+#define NS_HAS_SSE2 1
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace netstack
+{
+	/**
+	 * @brief An open-addressing hash table of per-peer state, keyed by the binary address of the peer, such as the
+	 * sessions of a UDP server looked up on every ReceiveFrom.
+	 *
+	 * Slots are split into groups of 16, each with a byte of control per slot holding 7 bits of the hash of its key.
+	 * A lookup compares all 16 control bytes of a group at once (with SSE2 where available) and only compares keys
+	 * whose hash bits match, so most lookups touch one control group and one slot. Entries record when they were
+	 * last seen, and Expire removes idle ones a bounded number of slots at a time, so expiry can run from an event
+	 * loop tick without a pause.
+	 *
+	 * Pointers to values are invalidated by any insertion that grows the table.
+	 */
+	template <typename Value>
+	class SessionTable
+	{
+	private:
+		static constexpr size_t GROUP_SIZE = 16;		///< The slots probed together.
+		static constexpr int8_t EMPTY = -128;			///< A slot never used since the last rehash.
+		static constexpr int8_t DELETED = -2;			///< A slot whose entry was erased, which does not end a probe.
+
+		/**
+		 * @brief A key, when it was last seen and its value, which is only constructed in full slots.
+		 */
+		struct Slot
+		{
+			CompactAddress key;
+			uint64_t seen;
+			union { Value value; };
+
+			Slot() {}
+			~Slot() {}
+		};
+
+		/**
+		 * @brief The control bytes of a group, matched 16 at a time.
+		 */
+		class Group
+		{
+		private:
+#if defined(NS_HAS_SSE2)
+			__m128i control_;
+
+		public:
+			explicit Group(const int8_t* control) : control_(_mm_loadu_si128((const __m128i*)control)) {}
+
+			uint32_t Match(const int8_t hash) const
+			{
+				return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(hash), control_));
+			}
+
+			// EMPTY and DELETED are the only control bytes with their top bit set.
+			uint32_t MatchFree() const
+			{
+				return (uint32_t)_mm_movemask_epi8(control_);
+			}
+#else
+			const int8_t* control_;
+
+		public:
+			explicit Group(const int8_t* control) : control_(control) {}
+
+			uint32_t Match(const int8_t hash) const
+			{
+				uint32_t mask = 0;
+				for (size_t i = 0; i < GROUP_SIZE; ++i)
+					mask |= (uint32_t)(control_[i] == hash) << i;
+
+				return mask;
+			}
+
+			uint32_t MatchFree() const
+			{
+				uint32_t mask = 0;
+				for (size_t i = 0; i < GROUP_SIZE; ++i)
+					mask |= (uint32_t)(control_[i] < 0) << i;
+
+				return mask;
+			}
+#endif
+			uint32_t MatchEmpty() const
+			{
+				return Match(EMPTY);
+			}
+		};
+
+		std::unique_ptr<int8_t[]> control_;	///< The control byte of every slot.
+		std::unique_ptr<Slot[]> slots_;		///< The entries.
+		size_t capacity_;					///< The number of slots, a power of two multiple of the group size.
+		size_t size_;						///< The number of entries.
+		size_t growth_;						///< The entries that can still be added before the table is rehashed.
+		size_t cursor_;						///< The next slot inspected by Expire.
+
+		static unsigned LowestBit(const uint32_t mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, mask);
+
+			return (unsigned)index;
+#else
+			return (unsigned)__builtin_ctz(mask);
+#endif
+		}
+
+		static int8_t Low(const size_t hash)
+		{
+			return (int8_t)(hash & 0x7f);
+		}
+
+		static size_t MaxLoad(const size_t capacity)
+		{
+			return capacity - capacity / 8;
+		}
+
+		size_t groups() const
+		{
+			return capacity_ / GROUP_SIZE;
+		}
+
+		/**
+		 * @brief Returns the slot of a key, or capacity_ if it is not in the table.
+		 */
+		size_t Locate(const CompactAddress& key, const size_t hash) const
+		{
+			const int8_t low = Low(hash);
+			const size_t mask = groups() - 1;
+
+			// Triangular steps over the groups visit every group of a power of two table.
+			for (size_t group = (hash >> 7) & mask, step = 1; ; group = (group + step++) & mask)
+			{
+				const Group probe(&control_[group * GROUP_SIZE]);
+
+				for (uint32_t match = probe.Match(low); match != 0; match &= match - 1)
+				{
+					const size_t index = group * GROUP_SIZE + LowestBit(match);
+					if (slots_[index].key == key)
+						return index;
+				}
+
+				if (probe.MatchEmpty() != 0 || step > mask)
+					return capacity_;
+			}
+		}
+
+		/**
+		 * @brief Returns the first empty or deleted slot on the probe sequence of a hash.
+		 */
+		size_t FindFree(const size_t hash) const
+		{
+			const size_t mask = groups() - 1;
+
+			for (size_t group = (hash >> 7) & mask, step = 1; ; group = (group + step++) & mask)
+			{
+				const uint32_t free = Group(&control_[group * GROUP_SIZE]).MatchFree();
+				if (free != 0)
+					return group * GROUP_SIZE + LowestBit(free);
+			}
+		}
+
+		void Allocate(const size_t capacity)
+		{
+			control_.reset(new int8_t[capacity]);
+			slots_.reset(new Slot[capacity]);
+			capacity_ = capacity;
+			growth_ = MaxLoad(capacity);
+			cursor_ = 0;
+
+			for (size_t i = 0; i < capacity; ++i)
+				control_[i] = EMPTY;
+		}
+
+		/**
+		 * @brief Moves every entry into a new array, doubling it unless erased slots alone were using up the room.
+		 */
+		void Rehash()
+		{
+			const size_t capacity = size_ * 2 >= MaxLoad(capacity_) ? capacity_ * 2 : capacity_;
+
+			std::unique_ptr<int8_t[]> control = std::move(control_);
+			std::unique_ptr<Slot[]> slots = std::move(slots_);
+			const size_t previous = capacity_;
+
+			Allocate(capacity);
+			growth_ -= size_;
+
+			for (size_t i = 0; i < previous; ++i)
+			{
+				if (control[i] < 0)
+					continue;
+
+				Slot& slot = slots[i];
+				const size_t hash = slot.key.hash();
+				const size_t index = FindFree(hash);
+
+				control_[index] = Low(hash);
+				slots_[index].key = slot.key;
+				slots_[index].seen = slot.seen;
+				new (&slots_[index].value) Value(std::move(slot.value));
+				slot.value.~Value();
+			}
+		}
+
+		void EraseAt(const size_t index)
+		{
+			slots_[index].value.~Value();
+			--size_;
+
+			// A group with an empty slot ends every probe that reaches it, so the erased slot can be empty too.
+			if (Group(&control_[index & ~(GROUP_SIZE - 1)]).MatchEmpty() != 0)
+			{
+				control_[index] = EMPTY;
+				++growth_;
+			}
+			else
+			{
+				control_[index] = DELETED;
+			}
+		}
+
+		void Destroy()
+		{
+			for (size_t i = 0; i < capacity_; ++i)
+				if (control_[i] >= 0)
+					slots_[i].value.~Value();
+		}
+
+	public:
+		/**
+		 * @brief Creates a table.
+		 *
+		 * @param {size_t} expected - The number of entries to make room for up front. Defaults to 0 if not specified.
+		 */
+		explicit SessionTable(const size_t expected = 0) : capacity_(0), size_(0), growth_(0), cursor_(0)
+		{
+			size_t capacity = GROUP_SIZE;
+			while (MaxLoad(capacity) < expected)
+				capacity *= 2;
+
+			Allocate(capacity);
+		}
+
+		SessionTable(const SessionTable&) = delete;
+		SessionTable& operator=(const SessionTable&) = delete;
+
+		~SessionTable()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief Looks up the state of a peer.
+		 *
+		 * @param {const CompactAddress&} key - The address of the peer.
+		 * @return {Value*} The state, or nullptr if the peer has none.
+		 */
+		Value* Find(const CompactAddress& key)
+		{
+			const size_t index = Locate(key, key.hash());
+
+			return index == capacity_ ? nullptr : &slots_[index].value;
+		}
+
+		/**
+		 * @brief Looks up the state of a peer and marks it as seen, postponing its expiry.
+		 *
+		 * @param {const CompactAddress&} key - The address of the peer.
+		 * @param {uint64_t} now - The current time, in the unit Expire is called with.
+		 * @return {Value*} The state, or nullptr if the peer has none.
+		 */
+		Value* Find(const CompactAddress& key, const uint64_t now)
+		{
+			const size_t index = Locate(key, key.hash());
+			if (index == capacity_)
+				return nullptr;
+
+			slots_[index].seen = now;
+
+			return &slots_[index].value;
+		}
+
+		/**
+		 * @brief Looks up the state of a peer, creating it if the peer has none, and marks it as seen.
+		 *
+		 * @param {const CompactAddress&} key - The address of the peer.
+		 * @param {uint64_t} now - The current time, in the unit Expire is called with.
+		 * @param {Args&&...} args - The arguments to construct new state with.
+		 * @return {std::pair<Value*, bool>} The state, and whether it was created.
+		 */
+		template <typename... Args>
+		std::pair<Value*, bool> Emplace(const CompactAddress& key, const uint64_t now, Args&&... args)
+		{
+			const size_t hash = key.hash();
+			size_t index = Locate(key, hash);
+
+			if (index != capacity_)
+			{
+				slots_[index].seen = now;
+				return { &slots_[index].value, false };
+			}
+
+			index = FindFree(hash);
+			if (control_[index] == EMPTY && growth_ == 0)
+			{
+				Rehash();
+				index = FindFree(hash);
+			}
+
+			if (control_[index] == EMPTY)
+				--growth_;
+
+			control_[index] = Low(hash);
+			slots_[index].key = key;
+			slots_[index].seen = now;
+			new (&slots_[index].value) Value(std::forward<Args>(args)...);
+			++size_;
+
+			return { &slots_[index].value, true };
+		}
+
+		/**
+		 * @brief Removes the state of a peer.
+		 *
+		 * @param {const CompactAddress&} key - The address of the peer.
+		 * @return {bool} True if the peer had state.
+		 */
+		bool Erase(const CompactAddress& key)
+		{
+			const size_t index = Locate(key, key.hash());
+			if (index == capacity_)
+				return false;
+
+			EraseAt(index);
+
+			return true;
+		}
+
+		/**
+		 * @brief Removes entries not seen for a while, inspecting at most a given number of slots and carrying on
+		 * from there on the next call.
+		 *
+		 * @param {uint64_t} now - The current time.
+		 * @param {uint64_t} idle - How long an entry may go unseen before it is removed.
+		 * @param {size_t} budget - The most slots to inspect, capacity() for a full sweep.
+		 * @param {Callback} onExpire - Called with the key and value of each entry before it is removed.
+		 * @return {size_t} The number of entries removed.
+		 */
+		template <typename Callback>
+		size_t Expire(const uint64_t now, const uint64_t idle, size_t budget, Callback onExpire)
+		{
+			size_t expired = 0;
+
+			for (budget = budget < capacity_ ? budget : capacity_; budget != 0; --budget)
+			{
+				const size_t index = cursor_;
+				cursor_ = (cursor_ + 1) & (capacity_ - 1);
+
+				if (control_[index] < 0 || now - slots_[index].seen < idle)
+					continue;
+
+				onExpire(slots_[index].key, slots_[index].value);
+				EraseAt(index);
+				++expired;
+			}
+
+			return expired;
+		}
+
+		/**
+		 * @brief Removes entries not seen for a while, inspecting every slot.
+		 *
+		 * @param {uint64_t} now - The current time.
+		 * @param {uint64_t} idle - How long an entry may go unseen before it is removed.
+		 * @return {size_t} The number of entries removed.
+		 */
+		size_t Expire(const uint64_t now, const uint64_t idle)
+		{
+			return Expire(now, idle, capacity_, [](const CompactAddress&, Value&) {});
+		}
+
+		/**
+		 * @brief Removes every entry, keeping the slots.
+		 */
+		void Clear()
+		{
+			Destroy();
+			size_ = 0;
+			growth_ = MaxLoad(capacity_);
+			cursor_ = 0;
+
+			for (size_t i = 0; i < capacity_; ++i)
+				control_[i] = EMPTY;
+		}
+
+		/**
+		 * @brief Returns the number of entries.
+		 *
+		 * @return {size_t} The number of peers with state.
+		 */
+		size_t size() const
+		{
+			return size_;
+		}
+
+		/**
+		 * @brief Returns the number of slots.
+		 *
+		 * @return {size_t} The number of slots, of which at most seven eighths are used before the table grows.
+		 */
+		size_t capacity() const
+		{
+			return capacity_;
+		}
+	};
+} // namespace netstack
+
+#endif // CPP_SESSION_HPP
@@ -5,9 +5,26 @@
 #include <vector>
 #include <memory>
 #include <climits>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
 
 #include "netstack.h"
 #include "address.hpp"
+#include "batch.hpp"
+#include "buffer.hpp"
+#include "option.hpp"
+#include "pipe.hpp"
+#include "pool.hpp"
+#include "iobuf.hpp"
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
 
 namespace netstack
 {
@@ -18,7 +35,7 @@ namespace netstack
 	{
 		STREAM = SOCK_STREAM,		///< Stream socket, typically used with TCP.
 		DATAGRAM = SOCK_DGRAM,		///< Datagram socket, typically used with UDP.
-		// RAW = SOCK_RAW,				///< Raw socket.
+		RAW = SOCK_RAW,				///< Raw socket, which sees packets with their headers.
 		// RDM = SOCK_RDM,				///< Reliably-delivered message socket.
 		// SEQPACKET = SOCK_SEQPACKET,	///< Sequential packet socket.
 	};
@@ -29,6 +46,7 @@ namespace netstack
 	enum class SocketProtocol
 	{
 		// IP = IPPROTO_IP,
+		DEFAULT = 0,			///< The default protocol of the family and type, the only one UNIX sockets have.
 		// ICMP = IPPROTO_ICMP,	///< Internet Control Message Protocol.
 		// IGMP = IPPROTO_IGMP,	///< Internet Group Management Protocol.
 		// GGP = IPPROTO_GGP,
@@ -79,14 +97,22 @@ namespace netstack
 	 */
 	class Socket
 	{
-		friend class SocketOption;
 	private:
+		static constexpr size_t MIN_RECEIVE_CHUNK = 16 * 1024;	///< Initial read size when receiving into a growable buffer.
+		static constexpr size_t MAX_RECEIVE_CHUNK = 1024 * 1024;	///< Upper bound on the geometric growth of a single read.
+		static constexpr size_t MAX_IO_VECTORS = 64;				///< The number of buffers passed to a single vectored call.
+		static constexpr size_t MAX_DESCRIPTORS = 64;				///< The most file descriptors passed by a single message.
 
 	protected:
 		SOCKET _socket;	///< SOCKET handle.
 
 	public:
-		Socket() = delete;
+		static constexpr SOCKET INVALID = (SOCKET)-1;	///< The handle of a socket that owns none, such as one moved from.
+
+		/**
+		 * @brief Creates an empty socket, which owns no handle until one is moved or reset into it.
+		 */
+		Socket() : _socket(INVALID) {}
 
 		/**
 		 * @brief Creates a socket.
@@ -120,24 +146,197 @@ namespace netstack
 		}
 
 		/**
-		* @brief Receives data from the socket and stores it in the specified buffer.
+		 * @brief Takes over the handle of another socket, leaving it empty.
+		 *
+		 * A socket registered with a Reactor or Proactor is known by its address, so it must not be moved while registered.
+		 *
+		 * @param {Socket&&} other - The socket to take the handle from.
+		 */
+		Socket(Socket&& other) noexcept : _socket(other.release()) {}
+
+		/**
+		 * @brief Closes the handle of the socket and takes over the handle of another, leaving it empty.
+		 *
+		 * @param {Socket&&} other - The socket to take the handle from.
+		 * @return {Socket&} This socket.
+		 */
+		Socket& operator=(Socket&& other) noexcept
+		{
+			if (this != &other)
+				reset(other.release());
+
+			return *this;
+		}
+
+		Socket(const Socket&) = delete;
+		Socket& operator=(const Socket&) = delete;
+
+#if !defined(_WIN32)
+		/**
+		 * @brief Creates a pair of connected UNIX sockets, such as for a parent and the child process it starts.
+		 * 
+		 * @param {SocketType} type - The type of both sockets, STREAM or DATAGRAM.
+		 * @param {Socket&} first - Receives one end, closing any handle it held.
+		 * @param {Socket&} second - Receives the other end, closing any handle it held.
+		 * @returns {bool} - True if the pair was created.
+		 */
+		static bool Pair(const SocketType type, Socket& first, Socket& second)
+		{
+			SOCKET handles[2];
+
+#if defined(__linux__)
+			if (socketpair(AF_UNIX, (int)type | SOCK_CLOEXEC, 0, handles) != 0)
+				return false;
+#else
+			if (socketpair(AF_UNIX, (int)type, 0, handles) != 0)
+				return false;
+
+			fcntl(handles[0], F_SETFD, FD_CLOEXEC);
+			fcntl(handles[1], F_SETFD, FD_CLOEXEC);
+#endif
+			first.reset(handles[0]);
+			second.reset(handles[1]);
+
+			return true;
+		}
+#endif
+
+		/**
+		 * @brief Assigns a local address to the socket.
+		 * 
+		 * @param {const Address&} address - The local address and port to bind to. Port 0 picks an ephemeral port.
+		 * @returns {bool} - True if the socket was bound.
+		 */
+		bool Bind(const Address& address)
+		{
+			return bind(_socket, address.name(), address.size()) == 0;
+		}
+
+		/**
+		 * @brief Marks the socket as accepting incoming connections.
+		 * 
+		 * @param {int} backlog - The maximum length of the queue of pending connections. Defaults to SOMAXCONN if not specified.
+		 * @returns {bool} - True if the socket is listening.
+		 */
+		bool Listen(const int backlog = SOMAXCONN)
+		{
+			return listen(_socket, backlog) == 0;
+		}
+
+		/**
+		 * @brief Accepts a pending connection on a listening socket.
+		 * 
+		 * @param {Address*} peer - Receives the address of the peer. Defaults to nullptr if not needed.
+		 * @param {bool} blocking - Whether the connection should be in blocking mode. Defaults to true if not specified.
+		 * @return {Socket} The connection, which is empty on failure.
+		 */
+		Socket Accept(Address* peer = nullptr, const bool blocking = true)
+		{
+			if (peer != nullptr)
+				peer->length_ = sizeof(peer->address_);
+
+#if defined(__linux__)
+			const SOCKET connection = accept4(_socket, peer == nullptr ? nullptr : peer->name(), peer == nullptr ? nullptr : peer->ptr(), SOCK_CLOEXEC | (blocking ? 0 : SOCK_NONBLOCK));
+#else
+			const SOCKET connection = accept(_socket, peer == nullptr ? nullptr : peer->name(), peer == nullptr ? nullptr : peer->ptr());
+			if (nsIsValidSocket(connection) && !blocking)
+				SetBlocking(connection, false);
+#endif
+			if (peer != nullptr)
+				peer->state_ = nsIsValidSocket(connection);
+
+			return Socket(connection);
+		}
+
+		/**
+		 * @brief Connects the socket to a remote address.
+		 * 
+		 * @param {const Address&} address - The address of the remote host.
+		 * @returns {bool} - True if the connection was established, or is in progress on a non-blocking socket.
+		 */
+		bool Connect(const Address& address)
+		{
+			if (connect(_socket, address.name(), address.size()) == 0)
+				return true;
+
+#if defined(_WIN32)
+			return nsSocketError() == WSAEWOULDBLOCK;
+#else
+			return errno == EINPROGRESS;
+#endif
+		}
+
+		/**
+		 * @brief Returns the local address the socket is bound to, including an ephemeral port picked by the system.
+		 * 
+		 * @return {Address} The local address, which converts to false on failure.
+		 */
+		Address GetLocalAddress() const
+		{
+			Address address;
+			address.length_ = sizeof(address.address_);
+			address.state_ = getsockname(_socket, address.name(), address.ptr()) == 0;
+
+			return address;
+		}
+
+		/**
+		* @brief Receives the data currently available on the socket and appends it to the specified buffer.
 		* 
-		* @param {std::string&} buffer - The buffer to store the received data.
+		* Data is read directly into the spare capacity of the buffer, growing it geometrically for as long as
+		* the socket keeps filling it. Reading stops on a short read, at the end of the stream or once no more
+		* data is immediately available.
+		* 
+		* @param {std::string&} buffer - The buffer to append the received data to.
 		* @param {ReceiveFlags} flags - The flags to use to modifiy the operation. Defaults to NONE if not specified.
-		* @return {int} The number of bytes received.
+		* @return {int} The number of bytes appended, 0 if the peer closed the connection or SOCKET_ERROR on failure.
 		*/
 		int Receive(std::string& buffer, const ReceiveFlags flags = ReceiveFlags::NONE)
 		{
-			std::vector<char> what(CHAR_MAX);
-			int received = 0;
-			do
+			const size_t start = buffer.size();
+			size_t received = 0;
+			size_t chunk = MIN_RECEIVE_CHUNK;
+			int recvFlags = (int)flags;
+
+			while (received < (size_t)INT_MAX - chunk)
 			{
-				received = Receive(&what[0], what.size(), (int)flags);
+				const size_t offset = start + received;
+				const size_t length = std::max(chunk, buffer.capacity() - offset);
+
+				buffer.resize(offset + length);
+				const int status = Receive(&buffer[offset], (int)std::min(length, (size_t)INT_MAX), recvFlags);
+
+				if (status <= 0)
+				{
+					buffer.resize(offset);
+
+					// Data already read is reported first, the end of stream or error will surface on the next call.
+					if (received == 0)
+						return status;
 
-				buffer.append(what.cbegin(), what.cend());
-			} while (received == CHAR_MAX);
+					break;
+				}
 
-			return received;
+				received += status;
+				buffer.resize(start + received);
+
+				if ((size_t)status < length || (recvFlags & MSG_PEEK))
+					break;
+
+				chunk = std::min(chunk * 2, MAX_RECEIVE_CHUNK);
+				// The socket filled the whole buffer, only keep going while more data is already queued.
+#if defined(MSG_DONTWAIT)
+				recvFlags |= MSG_DONTWAIT;
+#elif defined(_WIN32)
+				u_long queued = 0;
+				if (ioctlsocket(_socket, FIONREAD, &queued) != 0 || queued == 0)
+					break;
+#else
+				break;
+#endif
+			}
+
+			return (int)received;
 		}
 
 		/**
@@ -155,6 +354,107 @@ namespace netstack
 			return status;
 		}
 
+		/**
+		 * @brief Receives data into a buffer drawn from a BufferPool, replacing its contents.
+		 * 
+		 * @param {PooledBuffer&} buffer - The buffer to store the received data, resized to the number of bytes received.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes received, 0 if the peer closed the connection or SOCKET_ERROR on failure.
+		 */
+		int Receive(PooledBuffer& buffer, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			const int status = Receive(buffer.data(), (int)std::min(buffer.capacity(), (size_t)INT_MAX), (int)flags);
+			buffer.resize(status > 0 ? status : 0);
+
+			return status;
+		}
+
+		/**
+		 * @brief Receives data from the socket, scattering it across the specified buffers in order.
+		 * 
+		 * At most 64 buffers are filled by a single call.
+		 * 
+		 * @param {const MutableBuffer*} buffers - The buffers to store the received data.
+		 * @param {size_t} count - The number of buffers.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes received, or SOCKET_ERROR on failure.
+		 */
+		int ReceiveV(const MutableBuffer* buffers, const size_t count, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			const size_t used = std::min(count, MAX_IO_VECTORS);
+#if defined(_WIN32)
+			WSABUF vectors[MAX_IO_VECTORS];
+			for (size_t i = 0; i < used; ++i)
+				vectors[i] = { (ULONG)buffers[i].size(), buffers[i].data() };
+
+			DWORD received = 0;
+			DWORD receiveFlags = (DWORD)flags;
+			const int status = WSARecv(_socket, vectors, (DWORD)used, &received, &receiveFlags, nullptr, nullptr);
+
+			return status == 0 ? (int)received : status;
+#else
+			iovec vectors[MAX_IO_VECTORS];
+			for (size_t i = 0; i < used; ++i)
+				vectors[i] = { buffers[i].data(), buffers[i].size() };
+
+			msghdr message = {};
+			message.msg_iov = vectors;
+			message.msg_iovlen = used;
+
+			return (int)recvmsg(_socket, &message, (int)flags);
+#endif
+		}
+
+		/**
+		 * @brief Receives data from the socket, scattering it across the specified buffers in order.
+		 * 
+		 * @param {const Buffers&} buffers - A contiguous container of MutableBuffer views.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes received, or SOCKET_ERROR on failure.
+		 */
+		template <typename Buffers>
+		int ReceiveV(const Buffers& buffers, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			return ReceiveV(std::data(buffers), std::size(buffers), flags);
+		}
+
+		/**
+		 * @brief Receives data from the socket, scattering it across the specified buffers in order.
+		 * 
+		 * @param {std::initializer_list<MutableBuffer>} buffers - The buffers to store the received data.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes received, or SOCKET_ERROR on failure.
+		 */
+		int ReceiveV(const std::initializer_list<MutableBuffer> buffers, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			return ReceiveV(buffers.begin(), buffers.size(), flags);
+		}
+
+		/**
+		 * @brief Receives data onto the end of a chain of buffers.
+		 * 
+		 * The tailroom of the last segment is filled first, and the rest is scattered into a new segment by the same
+		 * call, so the chain only grows by what was actually received.
+		 * 
+		 * @param {IOBuf&} buffer - The chain to append the received data to.
+		 * @param {size_t} length - The most bytes to receive. Defaults to 16 KiB if not specified.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes received, 0 if the peer closed the connection or SOCKET_ERROR on failure.
+		 */
+		int ReceiveV(IOBuf& buffer, size_t length = 16 * 1024, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			length = std::min(length, (size_t)INT_MAX);
+
+			const size_t room = std::min(buffer.tailroom(), length);
+			char* tail = buffer.Append(room);
+			char* rest = room < length ? buffer.Append(length - room) : nullptr;
+
+			const int status = ReceiveV({ MutableBuffer(tail, room), MutableBuffer(rest, length - room) }, flags);
+			buffer.TrimBack(length - (status > 0 ? status : 0));
+
+			return status;
+		}
+
 		/**
 		 * @brief Receives data from the socket and stores it in the specified buffer.
 		 * 
@@ -173,24 +473,183 @@ namespace netstack
 		}
 
 		/**
-		 * @brief Receives data from the socket and stores it in the specified buffer.
+		 * @brief Receives a single datagram into a caller owned buffer without allocating.
 		 * 
-		 * @param {std::string&} buffer - The buffer to store the received data.
+		 * @param {char*} buffer - The buffer to store the received datagram.
+		 * @param {size_t} length - The length of the buffer.
+		 * @param {Address&} fromAddress - Receives the source address and port of the sender, including its actual length.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The length of the datagram, or SOCKET_ERROR on failure.
+		 */
+		int ReceiveFrom(char* buffer, const size_t length, Address& fromAddress, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			fromAddress.length_ = sizeof(fromAddress.address_);
+
+			const int status = ReceiveFrom(buffer, length, (int)flags, fromAddress.name(), fromAddress.ptr());
+
+			fromAddress.state_ = status >= 0;
+
+			return status;
+		}
+
+		/**
+		 * @brief Receives a single datagram and replaces the contents of the specified buffer with it.
+		 * 
+		 * The datagram is written straight into the string, so its size on entry is the largest datagram that can be
+		 * received and a longer one is truncated; an empty string discards the datagram. The string is then resized to
+		 * the datagram, so it must be sized again before it is reused. Shrinking keeps the capacity, so resizing it back
+		 * does not allocate. For buffers reused without refilling, see the char* and PooledBuffer overloads.
+		 * 
+		 * @param {std::string&} buffer - The buffer to store the received data, sized to the largest datagram expected.
 		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to 0 if not specified.
 		 * @param {Address&} fromAddress - The address that contains the source address and port of the sender. Defaults to an empty address.
-		 * @return {int} The number of bytes received.
+		 * @return {int} The length of the datagram, or SOCKET_ERROR on failure, which leaves the buffer as it was.
 		 */
 		int ReceiveFrom(std::string& buffer, const ReceiveFlags flags = ReceiveFlags::NONE, Address* fromAddress = nullptr)
 		{
-			std::unique_ptr<char[]> charBuffer = std::make_unique<char[]>(buffer.size());
+			const int result = fromAddress == nullptr
+				? ReceiveFrom(&buffer[0], buffer.size(), (int)flags)
+				: ReceiveFrom(&buffer[0], buffer.size(), *fromAddress, flags);
+
+			if (result >= 0 && (size_t)result < buffer.size())
+				buffer.resize((size_t)result);
 
-			const int result = ReceiveFrom(charBuffer.get(), buffer.size(), (int)flags,  fromAddress == nullptr ? nullptr : fromAddress->name(), fromAddress == nullptr ? 0 : fromAddress->size());
+			return result;
+		}
+
+		/**
+		 * @brief Receives a single datagram into a buffer drawn from a BufferPool, replacing its contents.
+		 * 
+		 * @param {PooledBuffer&} buffer - The buffer to store the datagram, resized to its length.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @param {Address*} fromAddress - Receives the address of the sender. Defaults to nullptr if not needed.
+		 * @return {int} The number of bytes received, or SOCKET_ERROR on failure.
+		 */
+		int ReceiveFrom(PooledBuffer& buffer, const ReceiveFlags flags = ReceiveFlags::NONE, Address* fromAddress = nullptr)
+		{
+			const int result = fromAddress == nullptr
+				? ReceiveFrom(buffer.data(), buffer.capacity(), (int)flags)
+				: ReceiveFrom(buffer.data(), buffer.capacity(), *fromAddress, flags);
 
-			buffer.assign(charBuffer.get());
+			buffer.resize(result > 0 ? result : 0);
 
 			return result;
 		}
 
+		/**
+		 * @brief Receives up to a full batch of datagrams and their source addresses, replacing the contents of the batch.
+		 * 
+		 * On Linux this is a single recvmmsg call that waits for the first datagram and then takes whatever else is
+		 * already queued. Other platforms receive one datagram per call. A datagram larger than the message size of the
+		 * batch is cut to fit, which MessageBatch::truncated reports.
+		 * 
+		 * @param {MessageBatch&} batch - The batch to store the received datagrams.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of datagrams received, or SOCKET_ERROR on failure.
+		 */
+		int ReceiveBatch(MessageBatch& batch, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			batch.Clear();
+#if defined(__linux__)
+			batch.Prepare(batch.capacity(), true);
+
+			const int status = recvmmsg(_socket, batch.headers_.data(), batch.capacity(), (int)flags | MSG_WAITFORONE, nullptr);
+
+			for (int i = 0; i < status; ++i)
+			{
+				Address& address = batch.addresses_[i];
+				address.length_ = batch.headers_[i].msg_hdr.msg_namelen;
+				address.state_ = true;
+
+				batch.lengths_[i] = batch.headers_[i].msg_len;
+				batch.truncated_[i] = (batch.headers_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+			}
+#else
+			int received = ReceiveFrom(batch.data(0), batch.messageSize(), batch.addresses_[0], flags);
+			batch.truncated_[0] = false;
+
+#if defined(_WIN32)
+			// Windows fills the slot and reports the rest of the datagram as lost with an error.
+			if (received < 0 && nsSocketError() == WSAEMSGSIZE)
+			{
+				received = (int)batch.messageSize();
+				batch.truncated_[0] = true;
+			}
+#endif
+			const int status = received < 0 ? received : 1;
+
+			if (received >= 0)
+				batch.lengths_[0] = received;
+#endif
+			if (status > 0)
+				batch.count_ = status;
+
+			return status;
+		}
+
+		/**
+		 * @brief Receives a run of datagrams that UDP receive offload coalesced into one buffer.
+		 * 
+		 * With options::RECEIVE_OFFLOAD enabled on Linux, consecutive datagrams of the same size from the same sender
+		 * arrive in a single call, and the segments describe where each one starts. Without it, or on other platforms,
+		 * a single datagram is received as a run of one. The buffer should hold 64 KiB, the largest run the kernel
+		 * builds, or datagrams past its end are dropped.
+		 * 
+		 * @param {MutableBuffer} buffer - The buffer to store the datagrams.
+		 * @param {DatagramSegments&} segments - Receives the length of the run and of each datagram in it.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @param {Address*} fromAddress - Receives the address of the sender. Defaults to nullptr if not needed.
+		 * @return {int} The number of bytes received, or SOCKET_ERROR on failure.
+		 */
+		int ReceiveSegmented(const MutableBuffer buffer, DatagramSegments& segments, const ReceiveFlags flags = ReceiveFlags::NONE, Address* fromAddress = nullptr)
+		{
+#if defined(__linux__) && defined(UDP_GRO)
+			iovec vector = { buffer.data(), buffer.size() };
+			alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+
+			msghdr message = {};
+			message.msg_iov = &vector;
+			message.msg_iovlen = 1;
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
+
+			if (fromAddress != nullptr)
+			{
+				message.msg_name = fromAddress->name();
+				message.msg_namelen = sizeof(fromAddress->address_);
+			}
+
+			const int status = (int)recvmsg(_socket, &message, (int)flags);
+
+			if (fromAddress != nullptr)
+			{
+				fromAddress->length_ = message.msg_namelen;
+				fromAddress->state_ = status >= 0;
+			}
+
+			segments.size = status > 0 ? status : 0;
+			segments.segmentSize = segments.size;
+
+			for (cmsghdr* header = CMSG_FIRSTHDR(&message); status > 0 && header != nullptr; header = CMSG_NXTHDR(&message, header))
+			{
+				if (header->cmsg_level == IPPROTO_UDP && header->cmsg_type == UDP_GRO)
+				{
+					int segmentSize = 0;
+					std::memcpy(&segmentSize, CMSG_DATA(header), sizeof(segmentSize));
+					segments.segmentSize = segmentSize;
+				}
+			}
+#else
+			const int status = fromAddress == nullptr
+				? ReceiveFrom(buffer.data(), buffer.size(), (int)flags)
+				: ReceiveFrom(buffer.data(), buffer.size(), *fromAddress, flags);
+
+			segments.size = status > 0 ? status : 0;
+			segments.segmentSize = segments.size;
+#endif
+			return status;
+		}
+
 		/**
 		 * @brief Sends the specified data over the socket.
 		 * 
@@ -219,6 +678,108 @@ namespace netstack
 			return Send(buffer.c_str(), buffer.length(), (int)flags);
 		}
 
+		/**
+		 * @brief Sends the contents of the specified buffers, in order, without coalescing them first.
+		 * 
+		 * Partial writes are resumed by advancing through the buffers until everything has been sent, the socket
+		 * would block or an error occurs.
+		 * 
+		 * @param {const ConstBuffer*} buffers - The buffers of data to send.
+		 * @param {size_t} count - The number of buffers.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR if nothing could be sent.
+		 */
+		int SendV(const ConstBuffer* buffers, const size_t count, const SendFlags flags = SendFlags::NONE)
+		{
+			size_t index = 0;	// The first buffer that has not been sent completely.
+			size_t offset = 0;	// The number of bytes of that buffer already sent.
+			size_t sent = 0;
+
+			while (index < count)
+			{
+				size_t used = 0;
+#if defined(_WIN32)
+				WSABUF vectors[MAX_IO_VECTORS];
+				for (size_t i = index; i < count && used < MAX_IO_VECTORS; ++i)
+				{
+					const size_t skip = i == index ? offset : 0;
+					vectors[used++] = { (ULONG)(buffers[i].size() - skip), (CHAR*)buffers[i].data() + skip };
+				}
+
+				DWORD written = 0;
+				const int status = WSASend(_socket, vectors, (DWORD)used, &written, (DWORD)flags, nullptr, nullptr) == 0 ? (int)written : -1;
+#else
+				iovec vectors[MAX_IO_VECTORS];
+				for (size_t i = index; i < count && used < MAX_IO_VECTORS; ++i)
+				{
+					const size_t skip = i == index ? offset : 0;
+					vectors[used++] = { (void*)(buffers[i].data() + skip), buffers[i].size() - skip };
+				}
+
+				msghdr message = {};
+				message.msg_iov = vectors;
+				message.msg_iovlen = used;
+
+				const long status = sendmsg(_socket, &message, (int)flags);
+#endif
+				if (status < 0)
+					return sent > 0 ? (int)sent : (int)status;
+
+				sent += status;
+
+				size_t remaining = status;
+				while (index < count && remaining >= buffers[index].size() - offset)
+				{
+					remaining -= buffers[index].size() - offset;
+					offset = 0;
+					++index;
+				}
+
+				offset += remaining;
+			}
+
+			return (int)sent;
+		}
+
+		/**
+		 * @brief Sends the contents of the specified buffers, in order, without coalescing them first.
+		 * 
+		 * @param {const Buffers&} buffers - A contiguous container of ConstBuffer views.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR if nothing could be sent.
+		 */
+		template <typename Buffers>
+		int SendV(const Buffers& buffers, const SendFlags flags = SendFlags::NONE)
+		{
+			return SendV(std::data(buffers), std::size(buffers), flags);
+		}
+
+		/**
+		 * @brief Sends the contents of the specified buffers, in order, without coalescing them first.
+		 * 
+		 * @param {std::initializer_list<ConstBuffer>} buffers - The buffers of data to send.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR if nothing could be sent.
+		 */
+		int SendV(const std::initializer_list<ConstBuffer> buffers, const SendFlags flags = SendFlags::NONE)
+		{
+			return SendV(buffers.begin(), buffers.size(), flags);
+		}
+
+		/**
+		 * @brief Sends the contents of a chain of buffers without coalescing it.
+		 * 
+		 * The chain is left untouched, so after a partial write the bytes sent are dropped with IOBuf::TrimFront.
+		 * 
+		 * @param {const IOBuf&} buffer - The chain of data to send.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR if nothing could be sent.
+		 */
+		int SendV(const IOBuf& buffer, const SendFlags flags = SendFlags::NONE)
+		{
+			return SendV(buffer.buffers().data(), buffer.segments(), flags);
+		}
+
 		/**
 		 * @brief Sends data from the buffer via the socket to an address. 
 		 * 
@@ -249,6 +810,291 @@ namespace netstack
 			return SendTo(buffer.c_str(), buffer.size(), (int)flags, address == nullptr? nullptr : address->name(), address == nullptr? 0 : address->size());
 		}
 
+		/**
+		 * @brief Sends every datagram held by the batch to its address.
+		 * 
+		 * On Linux the datagrams are handed to the kernel with as few sendmmsg calls as possible. Other platforms
+		 * send one datagram per call.
+		 * 
+		 * @param {MessageBatch&} batch - The datagrams to send.
+		 * @param {SendFlags} flags - Optional flags to be passed to the send function. Defaults to NONE if not specified.
+		 * @return {int} The number of datagrams sent, or SOCKET_ERROR if none could be sent.
+		 */
+		int SendBatch(MessageBatch& batch, const SendFlags flags = SendFlags::NONE)
+		{
+			size_t sent = 0;
+#if defined(__linux__)
+			batch.Prepare(batch.size(), false);
+#endif
+			while (sent < batch.size())
+			{
+#if defined(__linux__)
+				const int status = sendmmsg(_socket, &batch.headers_[sent], batch.size() - sent, (int)flags);
+#else
+				const int status = SendTo(batch.data(sent), batch.length(sent), (int)flags, batch.address(sent).name(), batch.address(sent).size()) < 0 ? -1 : 1;
+#endif
+				if (status <= 0)
+					return sent > 0 ? (int)sent : status;
+
+				sent += status;
+			}
+
+			return (int)sent;
+		}
+
+		/**
+		 * @brief Sends a buffer as consecutive datagrams of the specified size, leaving the kernel to split it.
+		 * 
+		 * On Linux the whole buffer goes down the stack as one packet with UDP segmentation offload, and is split
+		 * by the device or just before it, so the per-datagram cost of the stack is paid once. The kernel accepts at
+		 * most 64 segments and 64 KiB per call. Routes through a device that cannot checksum the segments refuse
+		 * offload, and like other platforms then send each datagram on its own.
+		 * 
+		 * @param {ConstBuffer} buffer - The datagrams to send, back to back.
+		 * @param {size_t} segmentSize - The length of every datagram but the last, which may be shorter.
+		 * @param {Address*} address - The destination of the datagrams. Defaults to nullptr for a connected socket.
+		 * @param {SendFlags} flags - Optional flags to be passed to the send function. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR if nothing could be sent.
+		 */
+		int SendSegmented(const ConstBuffer buffer, const size_t segmentSize, Address* address = nullptr, const SendFlags flags = SendFlags::NONE)
+		{
+			const DatagramSegments segments = { buffer.size(), segmentSize };
+#if defined(__linux__) && defined(UDP_SEGMENT)
+			if (segments.count() > 1)
+			{
+				iovec vector = { (void*)buffer.data(), buffer.size() };
+				alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+
+				msghdr message = {};
+				message.msg_name = address == nullptr ? nullptr : address->name();
+				message.msg_namelen = address == nullptr ? 0 : address->size();
+				message.msg_iov = &vector;
+				message.msg_iovlen = 1;
+				message.msg_control = control;
+				message.msg_controllen = sizeof(control);
+
+				cmsghdr* header = CMSG_FIRSTHDR(&message);
+				header->cmsg_level = IPPROTO_UDP;
+				header->cmsg_type = UDP_SEGMENT;
+				header->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+				const uint16_t size = (uint16_t)segmentSize;
+				std::memcpy(CMSG_DATA(header), &size, sizeof(size));
+
+				const int status = (int)sendmsg(_socket, &message, (int)flags);
+				if (status >= 0 || errno != EIO)
+					return status;
+			}
+#endif
+			size_t sent = 0;
+
+			for (size_t i = 0; i < segments.count(); ++i)
+			{
+				const int status = SendTo(buffer.data() + segments.offset(i), (int)segments.length(i), (int)flags,
+					address == nullptr ? nullptr : address->name(), address == nullptr ? 0 : address->size());
+				if (status < 0)
+					return sent > 0 ? (int)sent : status;
+
+				sent += status;
+			}
+
+			return (int)sent;
+		}
+
+		/**
+		 * @brief Sends part of a file without reading it into user space first.
+		 * 
+		 * On Linux the kernel moves the file pages straight to the socket with sendfile. Other platforms read the file
+		 * in chunks and send them. The offset is advanced past every byte sent, so a transfer that stopped early,
+		 * because a non-blocking socket would block or a signal interrupted it, resumes by calling again with the
+		 * same offset and the remaining length.
+		 * 
+		 * @param {int} file - The file descriptor to read from. Its own file position is not used or changed.
+		 * @param {int64_t&} offset - The position in the file to send from, advanced by the bytes sent.
+		 * @param {size_t} length - The number of bytes to send.
+		 * @return {int64_t} The number of bytes sent, which is less than the length at the end of the file or if the
+		 * socket would block, or SOCKET_ERROR if nothing could be sent.
+		 */
+		int64_t SendFile(const int file, int64_t& offset, const size_t length)
+		{
+			size_t sent = 0;
+
+			while (sent < length)
+			{
+#if defined(__linux__)
+				off_t position = (off_t)offset;
+				const ssize_t status = sendfile(_socket, file, &position, std::min(length - sent, (size_t)INT_MAX));
+#else
+				char chunk[64 * 1024];
+#if defined(_WIN32)
+				const long long read = _lseeki64(file, offset, SEEK_SET) < 0 ? -1 : _read(file, chunk, (unsigned)std::min(length - sent, sizeof(chunk)));
+#else
+				const ssize_t read = pread(file, chunk, std::min(length - sent, sizeof(chunk)), (off_t)offset);
+#endif
+				const long long status = read <= 0 ? read : send(_socket, chunk, (int)read, 0);
+#endif
+				if (status < 0)
+				{
+					if (errno == EINTR)
+						continue;
+
+					return sent > 0 ? (int64_t)sent : -1;
+				}
+
+				// The end of the file.
+				if (status == 0)
+					break;
+
+				offset += status;
+				sent += (size_t)status;
+			}
+
+			return (int64_t)sent;
+		}
+
+#if defined(__linux__)
+		/**
+		 * @brief Forwards data received on this socket to another one through a pipe, without copying it to user space.
+		 * 
+		 * Data is spliced from this socket into the pipe, then from the pipe into the destination, until the length
+		 * has been delivered, this socket reaches the end of its stream or either socket would block. Data left in
+		 * the pipe when the destination would block is delivered first by the next call with the same pipe.
+		 * 
+		 * @param {Socket&} destination - The socket to forward the data to.
+		 * @param {SplicePipe&} pipe - The pipe to move the data through.
+		 * @param {size_t} length - The most bytes to deliver to the destination.
+		 * @return {int64_t} The number of bytes delivered, 0 at the end of the stream, or SOCKET_ERROR if nothing could be delivered.
+		 */
+		int64_t Splice(Socket& destination, SplicePipe& pipe, const size_t length)
+		{
+			size_t delivered = 0;
+
+			while (delivered < length)
+			{
+				if (pipe.pending_ == 0)
+				{
+					const ssize_t status = splice(_socket, nullptr, pipe.write_, nullptr, std::min(length - delivered, pipe.capacity_), SPLICE_F_MOVE);
+					if (status < 0 && errno == EINTR)
+						continue;
+					if (status <= 0)
+						return delivered > 0 || status == 0 ? (int64_t)delivered : -1;
+
+					pipe.pending_ = (size_t)status;
+				}
+
+				const ssize_t status = splice(pipe.read_, nullptr, destination._socket, nullptr, std::min(pipe.pending_, length - delivered),
+					SPLICE_F_MOVE | (delivered + pipe.pending_ < length ? SPLICE_F_MORE : 0));
+				if (status < 0 && errno == EINTR)
+					continue;
+				if (status <= 0)
+					return delivered > 0 ? (int64_t)delivered : -1;
+
+				pipe.pending_ -= (size_t)status;
+				delivered += (size_t)status;
+			}
+
+			return (int64_t)delivered;
+		}
+#endif
+
+#if !defined(_WIN32)
+		/**
+		 * @brief Sends data together with open file descriptors over a UNIX socket, which the peer receives as
+		 * descriptors of its own for the same open files.
+		 * 
+		 * @param {const char*} buffer - The data to send with the descriptors, at least one byte on stream sockets.
+		 * @param {size_t} length - The length of the data.
+		 * @param {const int*} descriptors - The descriptors to pass, which stay open in this process.
+		 * @param {size_t} count - The number of descriptors, at most 64.
+		 * @param {SendFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR on failure.
+		 */
+		int SendDescriptors(const char* buffer, const size_t length, const int* descriptors, const size_t count, const SendFlags flags = SendFlags::NONE)
+		{
+			if (count > MAX_DESCRIPTORS)
+			{
+				errno = EINVAL;
+				return -1;
+			}
+
+			alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_DESCRIPTORS)] = {};
+			iovec vector = { (void*)buffer, length };
+
+			msghdr message = {};
+			message.msg_iov = &vector;
+			message.msg_iovlen = 1;
+
+			if (count != 0)
+			{
+				message.msg_control = control;
+				message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+				cmsghdr* header = CMSG_FIRSTHDR(&message);
+				header->cmsg_level = SOL_SOCKET;
+				header->cmsg_type = SCM_RIGHTS;
+				header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+				std::memcpy(CMSG_DATA(header), descriptors, sizeof(int) * count);
+			}
+
+			return (int)sendmsg(_socket, &message, (int)flags);
+		}
+
+		/**
+		 * @brief Receives data and any file descriptors passed with it over a UNIX socket.
+		 * 
+		 * The descriptors are opened with close-on-exec set on Linux, and belong to the caller. Descriptors beyond
+		 * the room given are closed by the system.
+		 * 
+		 * @param {char*} buffer - The buffer to store the received data.
+		 * @param {size_t} length - The length of the buffer.
+		 * @param {int*} descriptors - Receives the descriptors.
+		 * @param {size_t&} count - The room for descriptors, at most 64, set to the number received.
+		 * @param {ReceiveFlags} flags - The flags to use to modify the operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes received, 0 if the peer closed the connection or SOCKET_ERROR on failure.
+		 */
+		int ReceiveDescriptors(char* buffer, const size_t length, int* descriptors, size_t& count, const ReceiveFlags flags = ReceiveFlags::NONE)
+		{
+			alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_DESCRIPTORS)];
+			iovec vector = { buffer, length };
+			const size_t room = std::min(count, MAX_DESCRIPTORS);
+
+			msghdr message = {};
+			message.msg_iov = &vector;
+			message.msg_iovlen = 1;
+			message.msg_control = control;
+			message.msg_controllen = CMSG_SPACE(sizeof(int) * room);
+
+#if defined(__linux__)
+			const int status = (int)recvmsg(_socket, &message, (int)flags | MSG_CMSG_CLOEXEC);
+#else
+			const int status = (int)recvmsg(_socket, &message, (int)flags);
+#endif
+			count = 0;
+			if (status < 0)
+				return status;
+
+			for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+			{
+				if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+					continue;
+
+				const size_t received = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+				for (size_t i = 0; i < received; ++i)
+				{
+					int descriptor;
+					std::memcpy(&descriptor, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+
+					if (count < room)
+						descriptors[count++] = descriptor;
+					else
+						close(descriptor);
+				}
+			}
+
+			return status;
+		}
+#endif
+
 		/**
 		 * @brief Ends communication on this socket.
 		 *
@@ -262,12 +1108,128 @@ namespace netstack
             return status != SOCKET_ERROR;
 		}
 
+		/**
+		 * @brief Sets an option of the socket. The value must have the type of the option.
+		 * 
+		 * @param {const SocketOption&} option - The option to set (e.g. options::NO_DELAY).
+		 * @param {T} value - The value to set the option to.
+		 * @returns {bool} - True if the option was set.
+		 */
+		template <typename T, OptionAccess A, typename U, typename = EnableIfOptionValue<T, U>>
+		bool SetOption(const SocketOption<T, A>& option, const U& value)
+		{
+			return netstack::SetOption(_socket, option, value);
+		}
+
+		/**
+		 * @brief Reads an option of the socket.
+		 * 
+		 * @param {const SocketOption&} option - The option to read (e.g. options::RECEIVE_BUFFER).
+		 * @param {T&} value - Receives the value of the option.
+		 * @returns {bool} - True if the option was read.
+		 */
+		template <typename T, OptionAccess A, typename U, typename = EnableIfOptionValue<T, U>>
+		bool GetOption(const SocketOption<T, A>& option, U& value) const
+		{
+			return netstack::GetOption(_socket, option, value);
+		}
+
+		/**
+		 * @brief Sets every option of a profile, such as profiles::LOW_LATENCY or profiles::THROUGHPUT.
+		 * 
+		 * @param {const OptionProfile&} profile - The options and values to set.
+		 * @returns {bool} - True if every option was set. Options that could not be set do not stop the others.
+		 */
+		template <typename... Settings>
+		bool ApplyProfile(const OptionProfile<Settings...>& profile)
+		{
+			return profile.Apply(_socket);
+		}
+
+		/**
+		 * @brief Switches a SOCKET handle between blocking and non-blocking mode.
+		 *
+		 * @param {SOCKET} socket - The handle, which need not belong to a Socket.
+		 * @param {bool} blocking - Whether operations on the handle should block until they can complete.
+		 * @returns {bool} - True if the mode was changed.
+		 */
+		static bool SetBlocking(const SOCKET socket, const bool blocking)
+		{
+#if defined(_WIN32)
+			u_long mode = blocking ? 0 : 1;
+
+			return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+			const int flags = fcntl(socket, F_GETFL, 0);
+			if (flags < 0)
+				return false;
+
+			return fcntl(socket, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK)) == 0;
+#endif
+		}
+
+		/**
+		 * @brief Switches the socket between blocking and non-blocking mode.
+		 * 
+		 * @param {bool} blocking - Whether operations on the socket should block until they can complete.
+		 * @returns {bool} - True if the mode was changed.
+		 */
+		bool SetBlocking(const bool blocking)
+		{
+			return SetBlocking(_socket, blocking);
+		}
+
+		/**
+		 * @brief Returns the underlying SOCKET handle.
+		 * 
+		 * @return {SOCKET} The SOCKET handle.
+		 */
+		SOCKET handle() const
+		{
+			return _socket;
+		}
+
+		/**
+		 * @brief Returns whether the socket owns a valid handle.
+		 */
+		explicit operator bool() const
+		{
+			return nsIsValidSocket(_socket);
+		}
+
+		/**
+		 * @brief Gives up ownership of the handle without closing it, leaving the socket empty.
+		 *
+		 * @return {SOCKET} The handle, which the caller must now close.
+		 */
+		SOCKET release()
+		{
+			const SOCKET socket = _socket;
+			_socket = INVALID;
+
+			return socket;
+		}
+
+		/**
+		 * @brief Closes the handle of the socket and takes ownership of another.
+		 *
+		 * @param {SOCKET} socket - The handle to own. Defaults to INVALID, which just closes the socket.
+		 */
+		void reset(const SOCKET socket = INVALID)
+		{
+			if (nsIsValidSocket(_socket) && _socket != socket)
+				nsCloseSocket(_socket);
+
+			_socket = socket;
+		}
+
 		/**
 		 * @brief Destroys the instance of the socket by closing the underlying socket.
 		 */
 		~Socket()
 		{
-			nsCloseSocket(_socket);
+			if (nsIsValidSocket(_socket))
+				nsCloseSocket(_socket);
 		}
     };
 } // namespace netstack
@@ -0,0 +1,203 @@
+#ifndef CPP_TABLE_HPP
+#define CPP_TABLE_HPP
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "netstack.h"
+#include "socket.hpp"
+
+namespace netstack
+{
+	/**
+	 * @brief A fixed number of sockets held in one array and addressed by index, for the connections of an event loop.
+	 *
+	 * The array is allocated once and never moves, so a socket in the table can stay registered with a Reactor for as
+	 * long as it is held, and the index of a socket handed to a Handler is found from its address without a lookup.
+	 * Freed slots are reused most recent first, so the slots in use stay warm in the cache. The per-connection state
+	 * of a server can live in its own array of the same capacity, under the same index.
+	 *
+	 * Sockets leave the table through Remove or Erase, never by being released or moved out in place.
+	 */
+	class SocketTable
+	{
+	private:
+		std::unique_ptr<Socket[]> sockets_;	///< The slots, empty when free.
+		std::vector<uint32_t> free_;		///< The free slots, the most recently freed last.
+		size_t capacity_;					///< The number of slots.
+
+	public:
+		static constexpr size_t NONE = SIZE_MAX;	///< The index returned when a socket could not be inserted.
+
+		/**
+		 * @brief Creates a table with all of its slots free.
+		 *
+		 * @param {size_t} capacity - The most sockets the table holds at once.
+		 */
+		explicit SocketTable(const size_t capacity) : sockets_(new Socket[capacity]), capacity_(capacity)
+		{
+			free_.reserve(capacity);
+
+			for (size_t i = capacity; i > 0; --i)
+				free_.push_back((uint32_t)(i - 1));
+		}
+
+		SocketTable(const SocketTable&) = delete;
+		SocketTable& operator=(const SocketTable&) = delete;
+
+		/**
+		 * @brief Moves a socket into a free slot.
+		 *
+		 * @param {Socket&&} socket - The socket, which is left untouched if it is not inserted.
+		 * @return {size_t} The index of the slot, or NONE if the table is full or the socket is empty.
+		 */
+		size_t Insert(Socket&& socket)
+		{
+			if (free_.empty() || !socket)
+				return NONE;
+
+			const size_t index = free_.back();
+			free_.pop_back();
+			sockets_[index] = std::move(socket);
+
+			return index;
+		}
+
+		/**
+		 * @brief Moves the socket out of a slot, freeing the slot. It must be removed from any Reactor first.
+		 *
+		 * @param {size_t} index - The index of the slot.
+		 * @return {Socket} The socket, which is empty if the slot was free.
+		 */
+		Socket Remove(const size_t index)
+		{
+			if (!contains(index))
+				return Socket();
+
+			free_.push_back((uint32_t)index);
+
+			return std::move(sockets_[index]);
+		}
+
+		/**
+		 * @brief Closes the socket in a slot, freeing the slot. It must be removed from any Reactor first.
+		 *
+		 * @param {size_t} index - The index of the slot.
+		 * @returns {bool} - True if the slot held a socket.
+		 */
+		bool Erase(const size_t index)
+		{
+			if (!contains(index))
+				return false;
+
+			sockets_[index].reset();
+			free_.push_back((uint32_t)index);
+
+			return true;
+		}
+
+		/**
+		 * @brief Closes every socket in the table.
+		 */
+		void Clear()
+		{
+			free_.clear();
+
+			for (size_t i = capacity_; i > 0; --i)
+			{
+				sockets_[i - 1].reset();
+				free_.push_back((uint32_t)(i - 1));
+			}
+		}
+
+		/**
+		 * @brief Calls a function with the index and socket of every slot in use, in order of index.
+		 *
+		 * @param {Function} function - Called as function(size_t index, Socket& socket). It must not insert or remove sockets.
+		 */
+		template <typename Function>
+		void ForEach(Function function)
+		{
+			for (size_t i = 0; i < capacity_; ++i)
+				if (sockets_[i])
+					function(i, sockets_[i]);
+		}
+
+		/**
+		 * @brief Returns the socket in a slot, which is empty if the slot is free.
+		 *
+		 * @param {size_t} index - The index of the slot, below the capacity.
+		 * @return {Socket&} The socket.
+		 */
+		Socket& operator[](const size_t index)
+		{
+			return sockets_[index];
+		}
+
+		const Socket& operator[](const size_t index) const
+		{
+			return sockets_[index];
+		}
+
+		/**
+		 * @brief Returns the index of a socket held by the table, such as one passed to a Handler.
+		 *
+		 * @param {const Socket&} socket - The socket.
+		 * @return {size_t} The index of its slot, or NONE if the socket is not in the table.
+		 */
+		size_t index(const Socket& socket) const
+		{
+			const std::uintptr_t offset = (std::uintptr_t)&socket - (std::uintptr_t)sockets_.get();
+			if (offset % sizeof(Socket) != 0 || offset / sizeof(Socket) >= capacity_)
+				return NONE;
+
+			return offset / sizeof(Socket);
+		}
+
+		/**
+		 * @brief Returns whether a slot holds a socket.
+		 *
+		 * @param {size_t} index - The index of the slot.
+		 * @return {bool} True if the index is in range and its slot is in use.
+		 */
+		bool contains(const size_t index) const
+		{
+			return index < capacity_ && (bool)sockets_[index];
+		}
+
+		/**
+		 * @brief Returns the number of sockets held.
+		 *
+		 * @return {size_t} The number of slots in use.
+		 */
+		size_t size() const
+		{
+			return capacity_ - free_.size();
+		}
+
+		/**
+		 * @brief Returns the number of slots.
+		 *
+		 * @return {size_t} The most sockets the table holds at once.
+		 */
+		size_t capacity() const
+		{
+			return capacity_;
+		}
+
+		/**
+		 * @brief Returns whether every slot is in use.
+		 *
+		 * @return {bool} True if Insert would fail.
+		 */
+		bool full() const
+		{
+			return free_.empty();
+		}
+	};
+} // namespace netstack
+
+#endif // CPP_TABLE_HPP
@@ -0,0 +1,371 @@
+#ifndef CPP_TEXT_HPP
+#define CPP_TEXT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#ifndef NS_HAS_SSE2
+#define NS_HAS_SSE2 1
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace netstack
+{
+	/**
+	 * @brief The longest IPv4 address in text, "255.255.255.255", without the terminating null.
+	 */
+	constexpr size_t MAX_IPV4_TEXT = 15;
+
+	/**
+	 * @brief The longest IPv6 address in text, including an embedded IPv4 address, without the terminating null.
+	 */
+	constexpr size_t MAX_IPV6_TEXT = 45;
+
+	/**
+	 * @brief Classifies the characters of an address in text a block at a time, so the parsers find separators
+	 * and reject stray characters with a few vector compares instead of a branch per character.
+	 */
+	class TextMasks
+	{
+	private:
+		static constexpr size_t BLOCK = 48;	///< The longest text classified, rounded up to whole vectors.
+
+		char text_[BLOCK];	///< The text, padded with zeros.
+
+#if defined(NS_HAS_SSE2)
+		template <typename Classify>
+		uint64_t Mask(Classify classify) const
+		{
+			uint64_t mask = 0;
+			for (size_t i = 0; i < BLOCK; i += 16)
+			{
+				const __m128i block = _mm_loadu_si128((const __m128i*)(text_ + i));
+				mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(classify(block)) << i;
+			}
+
+			return mask;
+		}
+
+		static __m128i InRange(const __m128i block, const char low, const char high)
+		{
+			return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8(high + 1)));
+		}
+#else
+		template <typename Classify>
+		uint64_t Mask(Classify classify) const
+		{
+			uint64_t mask = 0;
+			for (size_t i = 0; i < BLOCK; ++i)
+				mask |= (uint64_t)classify(text_[i]) << i;
+
+			return mask;
+		}
+#endif
+
+	public:
+		uint64_t valid;		///< A bit for every character of the text.
+		uint64_t digits;	///< The decimal digits.
+		uint64_t hex;		///< The hexadecimal digits, either case.
+		uint64_t dots;		///< The '.' separators.
+		uint64_t colons;	///< The ':' separators.
+
+		/**
+		 * @brief Classifies a text of at most 48 characters.
+		 */
+		TextMasks(const char* text, const size_t length) : text_()
+		{
+			std::memcpy(text_, text, length);
+			valid = (1ull << length) - 1;
+
+#if defined(NS_HAS_SSE2)
+			digits = Mask([](const __m128i block) { return InRange(block, '0', '9'); });
+			hex = digits | Mask([](const __m128i block) { return _mm_or_si128(InRange(block, 'a', 'f'), InRange(block, 'A', 'F')); });
+			dots = Mask([](const __m128i block) { return _mm_cmpeq_epi8(block, _mm_set1_epi8('.')); });
+			colons = Mask([](const __m128i block) { return _mm_cmpeq_epi8(block, _mm_set1_epi8(':')); });
+#else
+			digits = Mask([](const char c) { return c >= '0' && c <= '9'; });
+			hex = digits | Mask([](const char c) { return (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); });
+			dots = Mask([](const char c) { return c == '.'; });
+			colons = Mask([](const char c) { return c == ':'; });
+#endif
+		}
+
+		/**
+		 * @brief Returns the position of the first separator at or after a position, or the length of the text.
+		 */
+		static size_t Next(const uint64_t mask, const size_t position, const size_t length)
+		{
+			const uint64_t after = position >= 64 ? 0 : mask >> position;
+			if (after == 0)
+				return length;
+
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, after);
+
+			return position + index;
+#else
+			return position + (size_t)__builtin_ctzll(after);
+#endif
+		}
+	};
+
+	/**
+	 * @brief Parses an IPv4 address in dotted decimal, accepting exactly what inet_pton accepts.
+	 *
+	 * @param {const char*} text - The text, which does not need to be null terminated.
+	 * @param {size_t} length - The length of the text.
+	 * @param {uint8_t*} address - Receives the 4 bytes of the address, in network order.
+	 * @return {bool} True if the text is a valid address.
+	 */
+	inline bool ParseIPv4(const char* text, const size_t length, uint8_t* address)
+	{
+		if (length < 7 || length > MAX_IPV4_TEXT)
+			return false;
+
+		const TextMasks masks(text, length);
+		if (((masks.digits | masks.dots) & masks.valid) != masks.valid)
+			return false;
+
+		size_t position = 0;
+		for (size_t field = 0; field < 4; ++field)
+		{
+			const size_t end = TextMasks::Next(masks.dots, position, length);
+			const size_t digits = end - position;
+
+			// Every field is 1 to 3 digits with no leading zero, and the last one ends the text.
+			if (digits == 0 || digits > 3 || (digits > 1 && text[position] == '0') || (field == 3) != (end == length))
+				return false;
+
+			unsigned value = 0;
+			for (size_t i = position; i < end; ++i)
+				value = value * 10 + (unsigned)(text[i] - '0');
+
+			if (value > 255)
+				return false;
+
+			address[field] = (uint8_t)value;
+			position = end + 1;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief Parses an IPv6 address, with "::" compression and an optional embedded IPv4 address, accepting exactly
+	 * what inet_pton accepts.
+	 *
+	 * @param {const char*} text - The text, which does not need to be null terminated.
+	 * @param {size_t} length - The length of the text.
+	 * @param {uint8_t*} address - Receives the 16 bytes of the address, in network order.
+	 * @return {bool} True if the text is a valid address.
+	 */
+	inline bool ParseIPv6(const char* text, const size_t length, uint8_t* address)
+	{
+		if (length < 2 || length > MAX_IPV6_TEXT)
+			return false;
+
+		const TextMasks masks(text, length);
+		if (((masks.hex | masks.colons | masks.dots) & masks.valid) != masks.valid)
+			return false;
+
+		static constexpr uint8_t NIBBLES[] = {
+			0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0, 0, 0, 0, 0, 0, 10, 11, 12, 13, 14, 15, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 11, 12, 13, 14, 15 };
+
+		uint8_t bytes[16] = {};
+		size_t count = 0;	// The bytes parsed.
+		int gap = -1;		// Where "::" stands, in bytes.
+		size_t position = 0;
+
+		if (text[0] == ':')
+		{
+			if (text[1] != ':')
+				return false;
+
+			gap = 0;
+			position = 2;
+		}
+
+		while (position < length)
+		{
+			const size_t end = TextMasks::Next(masks.colons, position, length);
+			const size_t digits = end - position;
+
+			if (digits == 0)
+			{
+				// The second colon of "::", which may only appear once.
+				if (gap >= 0)
+					return false;
+
+				gap = (int)count;
+				position = end + 1;
+				continue;
+			}
+
+			const uint64_t field = (masks.valid >> position) & ((1ull << digits) - 1);
+			if (((masks.dots >> position) & field) != 0)
+			{
+				// An embedded IPv4 address ends the text and fills the last 4 bytes.
+				if (end != length || count > 12 || !ParseIPv4(text + position, digits, bytes + count))
+					return false;
+
+				count += 4;
+				break;
+			}
+
+			if (digits > 4 || count == 16)
+				return false;
+
+			unsigned value = 0;
+			for (size_t i = position; i < end; ++i)
+				value = value << 4 | NIBBLES[(unsigned char)text[i] - '0'];
+
+			bytes[count++] = (uint8_t)(value >> 8);
+			bytes[count++] = (uint8_t)value;
+
+			// A single colon may not end the text.
+			if (end + 1 == length)
+				return false;
+
+			position = end + 1;
+		}
+
+		if (gap >= 0)
+		{
+			// "::" stands for at least one group of zeros.
+			if (count == 16)
+				return false;
+
+			const size_t tail = count - gap;
+			std::memmove(bytes + 16 - tail, bytes + gap, tail);
+			std::memset(bytes + gap, 0, 16 - tail - gap);
+		}
+		else if (count != 16)
+		{
+			return false;
+		}
+
+		std::memcpy(address, bytes, 16);
+
+		return true;
+	}
+
+	/**
+	 * @brief Writes an IPv4 address in dotted decimal.
+	 *
+	 * @param {const uint8_t*} address - The 4 bytes of the address, in network order.
+	 * @param {char*} text - Receives the text, at least MAX_IPV4_TEXT characters, without a terminating null.
+	 * @return {size_t} The length of the text.
+	 */
+	inline size_t FormatIPv4(const uint8_t* address, char* text)
+	{
+		char* out = text;
+
+		for (size_t i = 0; i < 4; ++i)
+		{
+			const unsigned value = address[i];
+
+			if (value >= 100)
+				*out++ = (char)('0' + value / 100);
+			if (value >= 10)
+				*out++ = (char)('0' + value / 10 % 10);
+			*out++ = (char)('0' + value % 10);
+
+			if (i != 3)
+				*out++ = '.';
+		}
+
+		return (size_t)(out - text);
+	}
+
+	/**
+	 * @brief Writes an IPv6 address in the form inet_ntop produces: lowercase, without leading zeros, with the
+	 * longest run of two or more zero groups compressed to "::", and IPv4-mapped and IPv4-compatible addresses
+	 * ending in dotted decimal.
+	 *
+	 * @param {const uint8_t*} address - The 16 bytes of the address, in network order.
+	 * @param {char*} text - Receives the text, at least MAX_IPV6_TEXT characters, without a terminating null.
+	 * @return {size_t} The length of the text.
+	 */
+	inline size_t FormatIPv6(const uint8_t* address, char* text)
+	{
+		static constexpr char HEX[] = "0123456789abcdef";
+
+		// A bit for every zero group.
+#if defined(NS_HAS_SSE2)
+		const __m128i groups = _mm_loadu_si128((const __m128i*)address);
+		const uint32_t bytes = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(groups, _mm_setzero_si128()));
+		uint32_t zeros = 0;
+		for (size_t i = 0; i < 8; ++i)
+			zeros |= ((bytes >> (i * 2)) & 1) << i;
+#else
+		uint32_t zeros = 0;
+		for (size_t i = 0; i < 8; ++i)
+			zeros |= (uint32_t)(address[i * 2] == 0 && address[i * 2 + 1] == 0) << i;
+#endif
+
+		// The first of the longest runs of zero groups, if it spans two or more.
+		size_t best = 8, bestLength = 1;
+		for (size_t i = 0; i < 8; )
+		{
+			size_t run = 0;
+			while (i + run < 8 && (zeros >> (i + run) & 1))
+				++run;
+
+			if (run > bestLength)
+			{
+				best = i;
+				bestLength = run;
+			}
+
+			i += run == 0 ? 1 : run;
+		}
+
+		char* out = text;
+		for (size_t i = 0; i < 8; ++i)
+		{
+			if (i == best)
+			{
+				*out++ = ':';
+				if (best + bestLength == 8)
+					*out++ = ':';
+				i += bestLength - 1;
+				continue;
+			}
+
+			if (i != 0)
+				*out++ = ':';
+
+			// "::a.b.c.d" and "::ffff:a.b.c.d" keep the embedded IPv4 address readable.
+			if (i == 6 && best == 0 && (bestLength == 6 || (bestLength == 5 && address[10] == 0xff && address[11] == 0xff)))
+			{
+				out += FormatIPv4(address + 12, out);
+				break;
+			}
+
+			const unsigned value = (unsigned)address[i * 2] << 8 | address[i * 2 + 1];
+			bool leading = true;
+			for (int shift = 12; shift >= 0; shift -= 4)
+			{
+				const unsigned nibble = value >> shift & 0xf;
+				if (leading && nibble == 0 && shift != 0)
+					continue;
+
+				leading = false;
+				*out++ = HEX[nibble];
+			}
+		}
+
+		return (size_t)(out - text);
+	}
+} // namespace netstack
+
+#endif // CPP_TEXT_HPP
@@ -0,0 +1,388 @@
+#ifndef CPP_TIMER_HPP
+#define CPP_TIMER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace netstack
+{
+	class TimerWheel;
+
+	/**
+	 * @brief A node of the intrusive lists a TimerWheel keeps its timers in.
+	 */
+	struct TimerLink
+	{
+		TimerLink* prev;	///< The previous node, or the list itself.
+		TimerLink* next;	///< The next node, or the list itself.
+	};
+
+	/**
+	 * @brief A timeout armed on a TimerWheel, such as a read deadline, an idle timeout or a retransmit timer.
+	 *
+	 * Timers are intrusive, so arming, re-arming and cancelling one never allocates. A timer is cancelled when it
+	 * is destroyed, and may be re-armed from within its own OnExpire.
+	 */
+	class Timer : private TimerLink
+	{
+		friend class TimerWheel;
+	private:
+		TimerWheel* wheel_;		///< The wheel the timer is armed on, or null.
+		uint64_t expiry_;		///< The tick the timer expires at.
+		uint32_t slot_;			///< The slot of the wheel holding the timer.
+
+	public:
+		Timer() : TimerLink{ nullptr, nullptr }, wheel_(nullptr), expiry_(0), slot_(0) {}
+
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+
+		/**
+		 * @brief Cancels the timer.
+		 */
+		virtual ~Timer();
+
+		/**
+		 * @brief Called by TimerWheel::Advance once the timer has expired. The timer is no longer armed.
+		 */
+		virtual void OnExpire() = 0;
+
+		/**
+		 * @brief Disarms the timer if it is armed.
+		 */
+		void Cancel();
+
+		/**
+		 * @brief Returns whether the timer is armed.
+		 *
+		 * @return {bool} True if the timer has been scheduled and has neither expired nor been cancelled.
+		 */
+		bool armed() const
+		{
+			return wheel_ != nullptr;
+		}
+
+		/**
+		 * @brief Returns the tick the timer expires at, if it is armed.
+		 *
+		 * @return {uint64_t} The expiry of the timer.
+		 */
+		uint64_t expiry() const
+		{
+			return expiry_;
+		}
+	};
+
+	/**
+	 * @brief A timer that forwards its expiry to a callable.
+	 */
+	template <typename Callback>
+	class CallbackTimer : public Timer
+	{
+	private:
+		Callback callback_;	///< Invoked when the timer expires.
+
+	public:
+		/**
+		 * @brief Creates a disarmed timer.
+		 *
+		 * @param {Callback} callback - Invoked when the timer expires.
+		 */
+		CallbackTimer(Callback callback) : callback_(std::move(callback)) {}
+
+		void OnExpire() override
+		{
+			callback_();
+		}
+	};
+
+	/**
+	 * @brief A hierarchical timing wheel.
+	 *
+	 * Time is measured in ticks, whose length is up to the owner. Each level has 64 slots, each slot of a level
+	 * spanning a whole turn of the level below, and timers far in the future wait in the coarse levels until they
+	 * are cascaded into finer ones. Arming, re-arming and cancelling are O(1), expiring is O(1) per timer, and
+	 * every timer costs a single small intrusive node with no allocation by the wheel.
+	 */
+	class TimerWheel
+	{
+		friend class Timer;
+	private:
+		static constexpr uint32_t SLOT_BITS = 6;						///< The log2 of the number of slots per level.
+		static constexpr uint32_t SLOTS = 1u << SLOT_BITS;				///< The number of slots per level.
+		static constexpr uint32_t LEVELS = 6;							///< The number of levels.
+		static constexpr uint64_t RANGE = 1ull << (SLOT_BITS * LEVELS);	///< The furthest a timer is placed ahead, longer ones are cascaded again.
+
+		TimerLink slots_[LEVELS][SLOTS];	///< The timers of each slot, as circular lists.
+		uint64_t occupied_[LEVELS];			///< A bit for each slot holding timers.
+		uint64_t now_;						///< The next tick to expire.
+		size_t count_;						///< The number of armed timers.
+
+		/**
+		 * @brief Returns the index of the lowest set bit of a non-zero value.
+		 */
+		static uint32_t LowestBit(const uint64_t value)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+
+			return index;
+#else
+			return (uint32_t)__builtin_ctzll(value);
+#endif
+		}
+
+		/**
+		 * @brief Links a timer into the slot its expiry falls in, relative to the current tick.
+		 */
+		void Insert(Timer& timer)
+		{
+			const uint64_t delta = timer.expiry_ - now_;
+			const uint64_t expiry = delta < RANGE ? timer.expiry_ : now_ + RANGE - 1;
+
+			uint32_t level = 0;
+			while (level + 1 < LEVELS && delta >= (1ull << (SLOT_BITS * (level + 1))))
+				++level;
+
+			const uint32_t slot = (uint32_t)(expiry >> (SLOT_BITS * level)) & (SLOTS - 1);
+			TimerLink& list = slots_[level][slot];
+
+			timer.slot_ = level * SLOTS + slot;
+			timer.prev = list.prev;
+			timer.next = &list;
+			list.prev->next = &timer;
+			list.prev = &timer;
+			occupied_[level] |= 1ull << slot;
+		}
+
+		/**
+		 * @brief Unlinks a timer from its slot or from the list being expired.
+		 */
+		void Unlink(Timer& timer)
+		{
+			timer.prev->next = timer.next;
+			timer.next->prev = timer.prev;
+
+			if (timer.slot_ < LEVELS * SLOTS)
+			{
+				const uint32_t level = timer.slot_ / SLOTS;
+				const uint32_t slot = timer.slot_ % SLOTS;
+				if (slots_[level][slot].next == &slots_[level][slot])
+					occupied_[level] &= ~(1ull << slot);
+			}
+		}
+
+		/**
+		 * @brief Moves every timer of a slot onto another list, leaving the slot empty.
+		 */
+		void Detach(const uint32_t level, const uint32_t slot, TimerLink& list)
+		{
+			TimerLink& source = slots_[level][slot];
+			if (source.next == &source)
+			{
+				list.prev = list.next = &list;
+				return;
+			}
+
+			list.next = source.next;
+			list.prev = source.prev;
+			list.next->prev = &list;
+			list.prev->next = &list;
+			source.prev = source.next = &source;
+			occupied_[level] &= ~(1ull << slot);
+		}
+
+		/**
+		 * @brief Moves the timers of the coarse slots starting at the current tick down to finer levels.
+		 */
+		void Cascade()
+		{
+			for (uint32_t level = 1; level < LEVELS; ++level)
+			{
+				const uint32_t shift = SLOT_BITS * level;
+				if ((now_ & ((1ull << shift) - 1)) != 0)
+					break;
+
+				TimerLink list;
+				Detach(level, (uint32_t)(now_ >> shift) & (SLOTS - 1), list);
+
+				while (list.next != &list)
+				{
+					Timer& timer = static_cast<Timer&>(*list.next);
+					list.next = timer.next;
+					Insert(timer);
+				}
+			}
+		}
+
+	public:
+		/**
+		 * @brief Creates an empty wheel.
+		 *
+		 * @param {uint64_t} now - The current tick. Defaults to 0 if not specified.
+		 */
+		TimerWheel(const uint64_t now = 0) : occupied_(), now_(now), count_(0)
+		{
+			for (auto& level : slots_)
+				for (TimerLink& list : level)
+					list.prev = list.next = &list;
+		}
+
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		/**
+		 * @brief Disarms every timer still armed.
+		 */
+		~TimerWheel()
+		{
+			for (auto& level : slots_)
+				for (TimerLink& list : level)
+					while (list.next != &list)
+						static_cast<Timer&>(*list.next).Cancel();
+		}
+
+		/**
+		 * @brief Arms a timer, or moves it if it is already armed.
+		 *
+		 * @param {Timer&} timer - The timer, which must stay alive or be cancelled before it is destroyed.
+		 * @param {uint64_t} expiry - The tick to expire the timer at. Ticks already passed expire on the next Advance.
+		 */
+		void Schedule(Timer& timer, const uint64_t expiry)
+		{
+			if (timer.wheel_ != nullptr)
+				timer.Cancel();
+
+			timer.wheel_ = this;
+			timer.expiry_ = expiry < now_ ? now_ : expiry;
+			Insert(timer);
+			++count_;
+		}
+
+		/**
+		 * @brief Expires every timer due at or before a tick, in order of expiry.
+		 *
+		 * Empty stretches of the wheel are skipped rather than stepped through, so the cost does not depend on how
+		 * far time has moved. Timers armed by callbacks for ticks already passed expire before Advance returns.
+		 *
+		 * @param {uint64_t} now - The current tick.
+		 * @return {size_t} The number of timers expired.
+		 */
+		size_t Advance(const uint64_t now)
+		{
+			size_t expired = 0;
+
+			while (count_ != 0)
+			{
+				const uint64_t next = NextExpiry();
+				if (next > now)
+					break;
+
+				now_ = next;
+				Cascade();
+
+				TimerLink list;
+				Detach(0, (uint32_t)now_ & (SLOTS - 1), list);
+				++now_;
+
+				// Callbacks may cancel any timer still on the list, so it is unlinked before each one is invoked.
+				while (list.next != &list)
+				{
+					Timer& timer = static_cast<Timer&>(*list.next);
+					timer.slot_ = UINT32_MAX;
+					Unlink(timer);
+					timer.wheel_ = nullptr;
+					--count_;
+					++expired;
+
+					timer.OnExpire();
+				}
+			}
+
+			if (now_ <= now)
+				now_ = now + 1;
+
+			return expired;
+		}
+
+		/**
+		 * @brief Returns the earliest tick a timer may expire at.
+		 *
+		 * The result is exact for timers due within 64 ticks. Timers further ahead are reported at the tick their
+		 * coarse slot is cascaded, which is never later than their expiry.
+		 *
+		 * @return {uint64_t} The tick to call Advance at, or UINT64_MAX if no timer is armed.
+		 */
+		uint64_t NextExpiry() const
+		{
+			uint64_t next = UINT64_MAX;
+
+			for (uint32_t level = 0; level < LEVELS; ++level)
+			{
+				const uint64_t bits = occupied_[level];
+				if (bits == 0)
+					continue;
+
+				const uint32_t shift = SLOT_BITS * level;
+				const uint64_t block = now_ >> shift;
+				const uint32_t current = (uint32_t)block & (SLOTS - 1);
+
+				// The slot of the current tick has not been expired or cascaded yet only at the start of its block.
+				if ((now_ & ((1ull << shift) - 1)) == 0 && (bits >> current) & 1)
+					return now_;
+
+				const uint32_t rotation = (current + 1) & (SLOTS - 1);
+				const uint64_t rotated = rotation == 0 ? bits : (bits >> rotation) | (bits << (SLOTS - rotation));
+				const uint64_t start = (block + LowestBit(rotated) + 1) << shift;
+
+				if (start < next)
+					next = start;
+			}
+
+			return next;
+		}
+
+		/**
+		 * @brief Returns the next tick Advance will expire.
+		 *
+		 * @return {uint64_t} The current tick of the wheel.
+		 */
+		uint64_t now() const
+		{
+			return now_;
+		}
+
+		/**
+		 * @brief Returns the number of armed timers.
+		 *
+		 * @return {size_t} The number of armed timers.
+		 */
+		size_t size() const
+		{
+			return count_;
+		}
+	};
+
+	inline Timer::~Timer()
+	{
+		Cancel();
+	}
+
+	inline void Timer::Cancel()
+	{
+		if (wheel_ == nullptr)
+			return;
+
+		wheel_->Unlink(*this);
+		--wheel_->count_;
+		wheel_ = nullptr;
+	}
+} // namespace netstack
+
+#endif // CPP_TIMER_HPP
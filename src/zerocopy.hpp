@@ -0,0 +1,329 @@
+#ifndef CPP_ZEROCOPY_HPP
+#define CPP_ZEROCOPY_HPP
+
+#include <deque>
+#include <cstdint>
+
+#include "netstack.h"
+#include "buffer.hpp"
+#include "option.hpp"
+#include "socket.hpp"
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <poll.h>
+#include <linux/errqueue.h>
+
+#define NS_HAS_ZEROCOPY 1
+
+namespace netstack
+{
+	/**
+	 * @brief Releases a buffer sent without copying, once the kernel no longer references its pages.
+	 *
+	 * Completions are intrusive, so tracking a send never allocates. A completion usually lives alongside the buffer
+	 * it releases, and both must stay alive until OnComplete is called.
+	 */
+	class ZeroCopyCompletion
+	{
+		friend class ZeroCopySocket;
+	private:
+		ZeroCopyCompletion* next_;	///< The next completion waiting on the same socket.
+		uint32_t last_;				///< The last send of the buffer, as counted by the kernel.
+
+	public:
+		ZeroCopyCompletion() : next_(nullptr), last_(0) {}
+
+		virtual ~ZeroCopyCompletion() = default;
+
+		/**
+		 * @brief Called once the kernel is finished with the buffer, which may then be reused or freed.
+		 *
+		 * @param {bool} copied - Whether the kernel copied the data after all, for example over loopback or to a
+		 * device without scatter-gather, in which case zero-copy only added overhead for this route.
+		 */
+		virtual void OnComplete(bool copied) = 0;
+	};
+
+	/**
+	 * @brief A completion that forwards to a callable.
+	 */
+	template <typename Callback>
+	class CallbackZeroCopyCompletion : public ZeroCopyCompletion
+	{
+	private:
+		Callback callback_;	///< Invoked with whether the data was copied.
+
+	public:
+		/**
+		 * @brief Creates a completion.
+		 *
+		 * @param {Callback} callback - Invoked once the kernel is finished with the buffer.
+		 */
+		CallbackZeroCopyCompletion(Callback callback) : callback_(std::move(callback)) {}
+
+		void OnComplete(const bool copied) override
+		{
+			callback_(copied);
+		}
+	};
+
+	/**
+	 * @brief A socket that sends large buffers with MSG_ZEROCOPY, pinning their pages instead of copying them.
+	 *
+	 * The kernel reports when it has released the pages of each send through the error queue of the socket, which
+	 * Reap reads. With a Reactor the queue shows up as an error event, so Reap belongs in Handler::OnError. Buffers
+	 * below the threshold are copied as usual, since pinning pages costs more than copying a few kilobytes.
+	 *
+	 * @extends Socket
+	 */
+	class ZeroCopySocket : public Socket
+	{
+	private:
+		/**
+		 * @brief The state of a send counted by the kernel.
+		 */
+		enum class SendState : uint8_t
+		{
+			PENDING,	///< The kernel still references the pages.
+			DONE,		///< The pages have been released.
+			COPIED,		///< The pages have been released, and the data was copied anyway.
+		};
+
+		size_t threshold_;				///< The smallest buffer sent without copying.
+		bool enabled_;					///< Whether SO_ZEROCOPY could be enabled.
+		uint32_t sequence_;				///< The counter of the next send, which the kernel keeps in step.
+		uint32_t released_;				///< The counter of the oldest send not yet released.
+		std::deque<SendState> sends_;	///< The state of every send from released_ on.
+		bool copied_;					///< Whether any send of the completion at the head was copied.
+		ZeroCopyCompletion* head_;		///< The oldest completion waiting.
+		ZeroCopyCompletion* tail_;		///< The newest completion waiting.
+		size_t waiting_;				///< The number of completions waiting.
+
+		void Enable()
+		{
+			enabled_ = SetOption(options::ZERO_COPY, true);
+		}
+
+		/**
+		 * @brief Marks a range of sends as released, then completes every buffer whose sends have all been released.
+		 */
+		size_t Release(const uint32_t first, const uint32_t last, const bool copied)
+		{
+			for (uint32_t sequence = first; sequence - first <= last - first; ++sequence)
+			{
+				const uint32_t index = sequence - released_;
+				if (index < sends_.size())
+					sends_[index] = copied ? SendState::COPIED : SendState::DONE;
+			}
+
+			size_t completed = 0;
+			while (!sends_.empty() && sends_.front() != SendState::PENDING)
+			{
+				copied_ |= sends_.front() == SendState::COPIED;
+				sends_.pop_front();
+
+				// The completion is unlinked first, since its callback may free it or send again.
+				const uint32_t released = released_++;
+				if (head_ != nullptr && head_->last_ == released)
+				{
+					ZeroCopyCompletion* completion = head_;
+					head_ = completion->next_;
+					if (head_ == nullptr)
+						tail_ = nullptr;
+					--waiting_;
+					++completed;
+
+					const bool wasCopied = copied_;
+					copied_ = false;
+					completion->OnComplete(wasCopied);
+				}
+			}
+
+			return completed;
+		}
+
+	public:
+		/**
+		 * @brief Creates a socket and enables zero-copy sends on it.
+		 *
+		 * @param {AddressFamily} af - The address family to use for the socket (e.g. INET, INET6).
+		 * @param {SocketType} type - The type of socket to create (e.g. STREAM, DATAGRAM).
+		 * @param {SocketProtocol} protocol - The protocol to use with the socket (e.g. TCP, UDP).
+		 * @param {size_t} threshold - The smallest buffer to send without copying. Defaults to 16 KiB if not specified.
+		 */
+		ZeroCopySocket(const AddressFamily af, const SocketType type, const SocketProtocol protocol, const size_t threshold = 16 * 1024) :
+			Socket(af, type, protocol), threshold_(threshold), enabled_(false), sequence_(0), released_(0), copied_(false),
+			head_(nullptr), tail_(nullptr), waiting_(0)
+		{
+			Enable();
+		}
+
+		/**
+		 * @brief Takes over the specified SOCKET handle, which must not have sent with MSG_ZEROCOPY before.
+		 *
+		 * @param {SOCKET} socket - The SOCKET handle to use.
+		 * @param {size_t} threshold - The smallest buffer to send without copying. Defaults to 16 KiB if not specified.
+		 */
+		ZeroCopySocket(const SOCKET socket, const size_t threshold = 16 * 1024) :
+			Socket(socket), threshold_(threshold), enabled_(false), sequence_(0), released_(0), copied_(false),
+			head_(nullptr), tail_(nullptr), waiting_(0)
+		{
+			Enable();
+		}
+
+		/**
+		 * @brief Sends a buffer without copying it, and calls the completion once the kernel has released it.
+		 *
+		 * Partial writes are resumed until everything has been sent, the socket would block, or the kernel runs out
+		 * of memory to pin pages with (ENOBUFS), in which case Reap should be called before sending the rest. If
+		 * anything was sent the buffer must stay untouched until the completion is called. Buffers below the
+		 * threshold, or any buffer when zero-copy is not supported, are copied and completed before returning.
+		 *
+		 * @param {ConstBuffer} buffer - The buffer of data to send.
+		 * @param {ZeroCopyCompletion&} completion - Called once the buffer may be reused.
+		 * @param {SendFlags} flags - The flags to use for the send operation. Defaults to NONE if not specified.
+		 * @return {int} The number of bytes sent, or SOCKET_ERROR if nothing could be sent and the completion was not queued.
+		 */
+		int SendZeroCopy(const ConstBuffer buffer, ZeroCopyCompletion& completion, const SendFlags flags = SendFlags::NONE)
+		{
+			const bool zeroCopy = enabled_ && buffer.size() >= threshold_;
+			const int zeroCopyFlag = zeroCopy ? MSG_ZEROCOPY : 0;
+			size_t sent = 0;
+
+			while (sent < buffer.size())
+			{
+				const ssize_t status = send(_socket, buffer.data() + sent, buffer.size() - sent, (int)flags | zeroCopyFlag | MSG_NOSIGNAL);
+				if (status < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					break;
+				}
+
+				// Every successful zero-copy send is counted by the kernel, and released on its own.
+				if (zeroCopy)
+				{
+					++sequence_;
+					sends_.push_back(SendState::PENDING);
+				}
+
+				sent += (size_t)status;
+			}
+
+			if (sent == 0 && buffer.size() != 0)
+				return -1;
+
+			if (!zeroCopy)
+			{
+				completion.OnComplete(true);
+				return (int)sent;
+			}
+
+			completion.next_ = nullptr;
+			completion.last_ = sequence_ - 1;
+			(tail_ != nullptr ? tail_->next_ : head_) = &completion;
+			tail_ = &completion;
+			++waiting_;
+
+			return (int)sent;
+		}
+
+		/**
+		 * @brief Reads every notification on the error queue without blocking, completing the buffers released.
+		 *
+		 * @return {int} The number of completions called, or SOCKET_ERROR if the error queue could not be read.
+		 */
+		int Reap()
+		{
+			size_t completed = 0;
+
+			for (;;)
+			{
+				char control[128];
+				msghdr message = {};
+				message.msg_control = control;
+				message.msg_controllen = sizeof(control);
+
+				if (recvmsg(_socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+				{
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+						break;
+					if (errno == EINTR)
+						continue;
+
+					return -1;
+				}
+
+				for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+				{
+					if (!((header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+						(header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR)))
+						continue;
+
+					const sock_extended_err* error = (const sock_extended_err*)CMSG_DATA(header);
+					if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+						continue;
+
+					completed += Release(error->ee_info, error->ee_data, (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+				}
+			}
+
+			return (int)completed;
+		}
+
+		/**
+		 * @brief Waits until every queued completion has been called, such as before closing the socket.
+		 *
+		 * @param {int} timeout - The longest to wait for each notification in milliseconds, or -1 to wait indefinitely.
+		 * @return {bool} True if no completion is left waiting.
+		 */
+		bool Flush(const int timeout = -1)
+		{
+			while (waiting_ != 0)
+			{
+				// A pending error queue is reported as POLLERR whatever events are requested.
+				pollfd descriptor = { _socket, 0, 0 };
+				const int ready = poll(&descriptor, 1, timeout);
+				if (ready < 0 && errno != EINTR)
+					return false;
+				if (ready == 0)
+					return false;
+
+				const int reaped = Reap();
+				if (reaped < 0 || (reaped == 0 && (descriptor.revents & (POLLHUP | POLLNVAL))))
+					return false;
+
+				// Any other error than a notification would be reported forever, so it ends the wait.
+				int error = 0;
+				if (reaped == 0 && GetOption(options::PENDING_ERROR, error) && error != 0)
+					return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Returns whether the kernel accepted SO_ZEROCOPY for this socket.
+		 *
+		 * @return {bool} True if large buffers are sent without copying.
+		 */
+		bool enabled() const
+		{
+			return enabled_;
+		}
+
+		/**
+		 * @brief Returns the number of completions waiting for the kernel.
+		 *
+		 * @return {size_t} The number of buffers still pinned.
+		 */
+		size_t pending() const
+		{
+			return waiting_;
+		}
+	};
+} // namespace netstack
+
+#endif // __linux__ && SO_ZEROCOPY && MSG_ZEROCOPY
+
+#endif // CPP_ZEROCOPY_HPP
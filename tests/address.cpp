@@ -0,0 +1,106 @@
+#include <catch2/catch_test_macros.hpp>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+TEST_CASE("Construct addresses from socket addresses", "[Address]") {
+    const Address original(AddressFamily::INET6, "2001:db8::1", 443);
+    REQUIRE(original);
+
+    const Address copy(original.name(), original.size());
+    REQUIRE(copy);
+    REQUIRE(copy.size() == sizeof(sockaddr_in6));
+    REQUIRE(((sockaddr_in6*)copy.name())->sin6_port == htons(443));
+
+    REQUIRE_FALSE(Address(original.name(), 0));
+}
+
+TEST_CASE("Compact addresses round trip and key tables", "[CompactAddress]") {
+    const CompactAddress v4(Address(AddressFamily::INET, "192.0.2.7", 5000));
+    const CompactAddress v6(Address(AddressFamily::INET6, "2001:db8::7", 5000));
+
+    SECTION("Family, address and port are kept") {
+        REQUIRE(v4);
+        REQUIRE(v4.family() == AF_INET);
+        REQUIRE(v4.port() == 5000);
+        REQUIRE(v4.bytes()[0] == 192);
+        REQUIRE(v4.bytes()[3] == 7);
+        REQUIRE(v4.bytes()[4] == 0);
+
+        REQUIRE(v6.family() == AF_INET6);
+        REQUIRE(v6.bytes()[0] == 0x20);
+        REQUIRE(v6.bytes()[15] == 7);
+
+        REQUIRE_FALSE(CompactAddress());
+        REQUIRE_FALSE(CompactAddress(Address()));
+    }
+
+    SECTION("Converting back gives an equal socket address") {
+        const Address address = v6.ToAddress();
+        REQUIRE(address);
+        REQUIRE(address.size() == sizeof(sockaddr_in6));
+        REQUIRE(CompactAddress(address) == v6);
+
+        const Address address4 = v4.ToAddress();
+        REQUIRE(address4.size() == sizeof(sockaddr_in));
+        REQUIRE(((sockaddr_in*)address4.name())->sin_port == htons(5000));
+        REQUIRE(CompactAddress(address4) == v4);
+
+        REQUIRE_FALSE(CompactAddress().ToAddress());
+    }
+
+    SECTION("Equality and ordering follow family, address, port and scope") {
+        const CompactAddress otherPort(Address(AddressFamily::INET, "192.0.2.7", 5001));
+        const CompactAddress otherHost(Address(AddressFamily::INET, "192.0.2.8", 80));
+
+        REQUIRE(v4 == CompactAddress(Address(AddressFamily::INET, "192.0.2.7", 5000)));
+        REQUIRE(v4 != otherPort);
+        REQUIRE(v4 < otherPort);
+        REQUIRE(otherPort < otherHost);
+        REQUIRE(v4 < v6);
+        REQUIRE(v6 >= v4);
+#if defined(__cpp_impl_three_way_comparison)
+        REQUIRE(std::is_lt(v4 <=> otherPort));
+        REQUIRE(std::is_eq(v4 <=> v4));
+#endif
+
+        const std::set<CompactAddress> ordered = { otherHost, v6, v4, otherPort };
+        REQUIRE(*ordered.begin() == v4);
+        REQUIRE(*ordered.rbegin() == v6);
+    }
+
+    SECTION("Hashes spread neighbouring peers across buckets") {
+        std::unordered_map<CompactAddress, int> peers;
+        std::unordered_set<size_t> buckets;
+
+        for (int port = 0; port < 4096; ++port)
+        {
+            const CompactAddress peer(Address(AddressFamily::INET, "10.0.0.1", (unsigned short)port));
+            peers[peer] = port;
+            buckets.insert(peer.hash() & 1023);
+        }
+
+        REQUIRE(peers.size() == 4096);
+        REQUIRE(peers[CompactAddress(Address(AddressFamily::INET, "10.0.0.1", 1234))] == 1234);
+
+        // A uniform hash leaves about 1024 / e^4 of the low-bit buckets empty.
+        REQUIRE(buckets.size() > 960);
+    }
+}
+
+TEST_CASE("Look up addresses with getaddrinfo", "[Address][GetAddressInfo]") {
+    std::vector<Address> addresses;
+
+    REQUIRE(Address::GetAddressInfo("127.0.0.1", 8080, addresses) == 0);
+    REQUIRE(addresses.size() >= 1);
+    REQUIRE(CompactAddress(addresses[0]) == CompactAddress(Address(AddressFamily::INET, "127.0.0.1", 8080)));
+
+    REQUIRE(Address::GetAddressInfo("::1", 443, addresses, AddressFamily::INET6) == 0);
+    REQUIRE(CompactAddress(addresses[0]).port() == 443);
+    REQUIRE(addresses[0].name()->sa_family == AF_INET6);
+
+    REQUIRE(Address::GetAddressInfo("::1", 443, addresses, AddressFamily::INET) != 0);
+}
@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+// Binds a UDP socket to an ephemeral loopback port and stores the bound address.
+static SOCKET BindUdp(Address& address)
+{
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    address = Address(AddressFamily::INET, "127.0.0.1", 0);
+    socklen_t length = sizeof(sockaddr_in);
+
+    bind(handle, address.name(), length);
+    getsockname(handle, address.name(), &length);
+
+    return handle;
+}
+
+TEST_CASE("Capture loopback frames from the ring and write them as pcap", "[CaptureSocket][PcapWriter]") {
+    CaptureSocket capture("lo", 64 * 1024, 8, 5);
+    if (!capture)
+    {
+        WARN("Capturing requires CAP_NET_RAW, skipping");
+        return;
+    }
+
+    Address receiverAddress, senderAddress;
+    Socket receiver(BindUdp(receiverAddress));
+    Socket sender(BindUdp(senderAddress));
+
+    const std::string marker = "netstack-capture-marker";
+    for (int i = 0; i < 10; ++i)
+        REQUIRE(sender.SendTo(marker, SendFlags::NONE, &receiverAddress) == (int)marker.size());
+
+    char path[] = "/tmp/netstack-capture-XXXXXX";
+    const int descriptor = mkstemp(path);
+    REQUIRE(descriptor >= 0);
+    close(descriptor);
+
+    size_t matched = 0;
+    {
+        PcapWriter writer(path);
+        REQUIRE(writer);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (matched < 10 && std::chrono::steady_clock::now() < deadline)
+        {
+            CaptureBlock block = capture.Next(100);
+            if (!block)
+                continue;
+
+            for (const CapturedFrame frame : block)
+            {
+                REQUIRE(frame.length <= frame.wireLength);
+
+                // Ethernet, IPv4 and UDP headers precede the payload.
+                const std::string bytes(frame.data, frame.length);
+                if (bytes.size() == 14 + 20 + 8 + marker.size() && bytes.compare(42, marker.size(), marker) == 0)
+                    ++matched;
+            }
+
+            REQUIRE(writer.Write(block));
+            capture.Release(block);
+            REQUIRE_FALSE(block);
+        }
+
+        REQUIRE(matched >= 10);
+        REQUIRE(writer.frames() >= matched);
+        REQUIRE(writer.Flush());
+    }
+
+    CaptureStatistics statistics = {};
+    REQUIRE(capture.Statistics(statistics));
+    REQUIRE(statistics.packets >= matched);
+
+    // The file starts with the nanosecond pcap header for Ethernet frames.
+    std::FILE* file = std::fopen(path, "rb");
+    REQUIRE(file != nullptr);
+    uint32_t header[6] = {};
+    REQUIRE(std::fread(header, sizeof(header), 1, file) == 1);
+    std::fclose(file);
+    std::remove(path);
+
+    REQUIRE(header[0] == 0xa1b23c4d);
+    REQUIRE(header[1] == (2u | (4u << 16)));
+    REQUIRE(header[5] == 1);
+}
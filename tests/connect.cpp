@@ -0,0 +1,139 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+using Clock = std::chrono::steady_clock;
+
+// A listener whose accept queue is full and never drained, so further SYNs are dropped as if blackholed.
+struct DeadEndpoint
+{
+    Socket listener;
+    std::deque<Socket> clients;
+    Address address;
+
+    DeadEndpoint(const AddressFamily family, const char* ip) : listener(family, SocketType::STREAM, SocketProtocol::TCP)
+    {
+        listener.Bind(Address(family, ip, 0));
+        listener.Listen(0);
+        address = listener.GetLocalAddress();
+
+        for (int i = 0; i < 4; ++i)
+        {
+            clients.emplace_back(family, SocketType::STREAM, SocketProtocol::TCP);
+            clients.back().SetBlocking(false);
+            clients.back().Connect(address);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+};
+
+// A port with nothing listening, which refuses connections at once.
+static Address RefusedEndpoint(const AddressFamily family, const char* ip)
+{
+    Socket unused(family, SocketType::STREAM, SocketProtocol::TCP);
+    unused.Bind(Address(family, ip, 0));
+
+    return unused.GetLocalAddress();
+}
+
+static long Milliseconds(const Clock::time_point start)
+{
+    return (long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+TEST_CASE("Interleave addresses by family", "[ConnectFirst]") {
+    const Address v6a(AddressFamily::INET6, "2001:db8::1", 80), v6b(AddressFamily::INET6, "2001:db8::2", 80);
+    const Address v4a(AddressFamily::INET, "192.0.2.1", 80), v4b(AddressFamily::INET, "192.0.2.2", 80), v4c(AddressFamily::INET, "192.0.2.3", 80);
+
+    const std::vector<Address> ordered = InterleaveAddresses({ v6a, v6b, v4a, v4b, v4c });
+    const std::vector<CompactAddress> expected = { CompactAddress(v6a), CompactAddress(v4a), CompactAddress(v6b), CompactAddress(v4b), CompactAddress(v4c) };
+
+    REQUIRE(ordered.size() == expected.size());
+    for (size_t i = 0; i < ordered.size(); ++i)
+        REQUIRE(CompactAddress(ordered[i]) == expected[i]);
+
+    // The family of the first address goes first.
+    REQUIRE(CompactAddress(InterleaveAddresses({ v4a, v6a, v4b })[1]) == CompactAddress(v6a));
+    REQUIRE(InterleaveAddresses({}).empty());
+}
+
+TEST_CASE("Race connection attempts across addresses", "[ConnectFirst]") {
+    Socket server(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    REQUIRE(server.Bind(Address(AddressFamily::INET, "127.0.0.1", 0)));
+    REQUIRE(server.Listen());
+    const Address live = server.GetLocalAddress();
+
+    DeadEndpoint dead(AddressFamily::INET6, "::1");
+
+    ConnectOptions options;
+    options.attemptDelay = 100;
+    options.timeout = 2000;
+
+    SECTION("A blackholed family costs one attempt delay") {
+        Address peer;
+        const auto start = Clock::now();
+        Socket connection(ConnectFirst({ dead.address, live }, &peer, options));
+        const long elapsed = Milliseconds(start);
+
+        REQUIRE(nsIsValidSocket(connection.handle()));
+        REQUIRE(CompactAddress(peer) == CompactAddress(live));
+        REQUIRE(elapsed >= 90);
+        REQUIRE(elapsed < 1000);
+
+        // The winner is blocking and usable.
+        Socket accepted(server.Accept());
+        REQUIRE(connection.Send("ping", 4) == 4);
+        char buffer[4];
+        REQUIRE(accepted.Receive(buffer, 4) == 4);
+    }
+
+    SECTION("A refused address hands over without waiting") {
+        options.attemptDelay = 1000;
+
+        Address peer;
+        const auto start = Clock::now();
+        Socket connection(ConnectFirst({ RefusedEndpoint(AddressFamily::INET, "127.0.0.1"), live }, &peer, options));
+
+        REQUIRE(nsIsValidSocket(connection.handle()));
+        REQUIRE(CompactAddress(peer) == CompactAddress(live));
+        REQUIRE(Milliseconds(start) < 500);
+    }
+
+    SECTION("The first address wins when it answers in time") {
+        Address peer;
+        Socket connection(ConnectFirst({ live, dead.address }, &peer, options));
+
+        REQUIRE(nsIsValidSocket(connection.handle()));
+        REQUIRE(CompactAddress(peer) == CompactAddress(live));
+    }
+
+    SECTION("Dead endpoints time out with the overall deadline") {
+        options.timeout = 300;
+
+        const auto start = Clock::now();
+        const Socket connection = ConnectFirst({ dead.address, RefusedEndpoint(AddressFamily::INET, "127.0.0.1") }, nullptr, options);
+        const int error = nsSocketError();
+        const long elapsed = Milliseconds(start);
+
+        REQUIRE_FALSE(connection);
+        REQUIRE(error == ETIMEDOUT);
+        REQUIRE(elapsed >= 290);
+        REQUIRE(elapsed < 1000);
+    }
+
+    SECTION("Refused endpoints fail fast with their error") {
+        const auto start = Clock::now();
+        const Socket connection = ConnectFirst({ RefusedEndpoint(AddressFamily::INET6, "::1"), RefusedEndpoint(AddressFamily::INET, "127.0.0.1") }, nullptr, options);
+        const int error = nsSocketError();
+
+        REQUIRE_FALSE(connection);
+        REQUIRE(error == ECONNREFUSED);
+        REQUIRE(Milliseconds(start) < 500);
+    }
+}
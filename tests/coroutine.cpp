@@ -0,0 +1,169 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+static bool countAllocations = false;
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (countAllocations)
+        ++allocations;
+
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+static Task<int> Add(int left, int right)
+{
+    co_return left + right;
+}
+
+static Task<void> Sum(int& result)
+{
+    result = co_await Add(1, 2) + co_await Add(3, 4);
+}
+
+static Task<void> Serve(AsyncSocket& listener, Reactor& reactor, int& served)
+{
+    const int handle = co_await listener.AsyncAccept();
+    if (handle < 0)
+        co_return;
+
+    AsyncSocket connection(reactor, handle);
+    char buffer[64];
+    int received;
+
+    while ((received = co_await connection.AsyncReceive(buffer, sizeof(buffer))) > 0)
+        co_await connection.AsyncSend(buffer, received);
+
+    ++served;
+}
+
+static Task<void> Request(Reactor& reactor, const Address& address, std::string& reply)
+{
+    AsyncSocket client(reactor, AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    if (co_await client.AsyncConnect(address) != 0)
+        co_return;
+
+    co_await client.AsyncSend("ping", 4);
+
+    char buffer[4];
+    const int received = co_await client.AsyncReceive(buffer, sizeof(buffer));
+    if (received > 0)
+        reply.assign(buffer, received);
+}
+
+TEST_CASE("Await nested tasks", "[Task]") {
+    int result = 0;
+    Spawn(Sum(result));
+
+    REQUIRE(result == 10);
+}
+
+TEST_CASE("Straight-line request and response over coroutines", "[AsyncSocket]") {
+    Reactor reactor;
+
+    AsyncSocket listener(reactor, AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    Address address(AddressFamily::INET, "127.0.0.1", 0);
+    socklen_t length = sizeof(sockaddr_in);
+    REQUIRE(bind(listener.handle(), address.name(), length) == 0);
+    REQUIRE(listen(listener.handle(), 8) == 0);
+    REQUIRE(getsockname(listener.handle(), address.name(), &length) == 0);
+
+    int served = 0;
+
+    for (int round = 0; round < 3; ++round)
+    {
+        std::string reply;
+
+        // Frames of earlier rounds are recycled, so later rounds allocate nothing for their coroutines.
+        countAllocations = round > 0;
+        allocations = 0;
+        Spawn(Serve(listener, reactor, served));
+        Spawn(Request(reactor, address, reply));
+        countAllocations = false;
+
+        for (int i = 0; i < 100 && served == round; ++i)
+            reactor.RunOnce(100);
+
+        REQUIRE(reply == "ping");
+        REQUIRE(served == round + 1);
+
+        if (round > 0)
+            REQUIRE(allocations == 0);
+    }
+}
+
+TEST_CASE("Connect reports refused connections", "[AsyncSocket]") {
+    Reactor reactor;
+    Address address(AddressFamily::INET, "127.0.0.1", 1);
+    int result = 1;
+
+    auto connect = [](Reactor& reactor, const Address& address, int& result) -> Task<void> {
+        AsyncSocket client(reactor, AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        result = co_await client.AsyncConnect(address);
+    };
+
+    Spawn(connect(reactor, address, result));
+    for (int i = 0; i < 100 && result == 1; ++i)
+        reactor.RunOnce(100);
+
+    REQUIRE(result == -ECONNREFUSED);
+}
+
+TEST_CASE("Receive times out after the receive timeout", "[AsyncSocket]") {
+    SOCKET pair[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+
+    Reactor reactor;
+    AsyncSocket local(reactor, pair[0]);
+    Socket remote(pair[1]);
+    local.SetReceiveTimeout(20);
+
+    int result = 1;
+    auto receive = [](AsyncSocket& socket, int& result) -> Task<void> {
+        char buffer[4];
+        result = co_await socket.AsyncReceive(buffer, sizeof(buffer));
+    };
+
+    SECTION("No data arrives before the deadline") {
+        const uint64_t start = Reactor::Now();
+        Spawn(receive(local, result));
+        REQUIRE(reactor.timers() == 1);
+
+        for (int i = 0; i < 100 && result == 1; ++i)
+            reactor.RunOnce(100);
+
+        REQUIRE(result == -ETIMEDOUT);
+        REQUIRE(Reactor::Now() - start >= 20);
+        REQUIRE(reactor.timers() == 0);
+    }
+
+    SECTION("Data arriving in time cancels the deadline") {
+        Spawn(receive(local, result));
+        remote.Send("ping");
+
+        for (int i = 0; i < 100 && result == 1; ++i)
+            reactor.RunOnce(100);
+
+        REQUIRE(result == 4);
+        REQUIRE(reactor.timers() == 0);
+    }
+}
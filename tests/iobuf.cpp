@@ -0,0 +1,201 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <string>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+TEST_CASE("Build a chain in place", "[IOBuf]") {
+    SECTION("Headers are written into the headroom") {
+        IOBuf buffer = IOBuf::Create(256, 16);
+        REQUIRE(buffer.empty());
+        REQUIRE(buffer.segments() == 1);
+        REQUIRE(buffer.headroom() == 16);
+        REQUIRE(buffer.tailroom() == 240);
+
+        std::memcpy(buffer.Append(5), "hello", 5);
+        std::memcpy(buffer.Prepend(4), "LEN5", 4);
+
+        REQUIRE(buffer.segments() == 1);
+        REQUIRE(buffer.headroom() == 12);
+        REQUIRE(buffer.tailroom() == 235);
+        REQUIRE(buffer.ToString() == "LEN5hello");
+    }
+
+    SECTION("Running out of room chains on a new segment") {
+        IOBuf buffer = IOBuf::Copy("abc", 3);
+        REQUIRE(buffer.headroom() == 0);
+        REQUIRE(buffer.tailroom() == 0);
+
+        buffer.Append("def", 3);
+        std::memcpy(buffer.Prepend(2), "<<", 2);
+
+        REQUIRE(buffer.segments() == 3);
+        REQUIRE(buffer.size() == 8);
+        REQUIRE(buffer.ToString() == "<<abcdef");
+    }
+
+    SECTION("Appending a chain takes over its segments") {
+        IOBuf front = IOBuf::Copy("head", 4);
+        IOBuf back = IOBuf::Copy("tail", 4);
+        front.Append(std::move(back));
+
+        REQUIRE(back.empty());
+        REQUIRE(back.segments() == 0);
+        REQUIRE(front.segments() == 2);
+        REQUIRE(front.ToString() == "headtail");
+    }
+}
+
+TEST_CASE("Split and clone without copying", "[IOBuf][Split][Clone]") {
+    IOBuf buffer = IOBuf::Copy("0123456789", 10);
+    const char* data = buffer.buffers()[0].data();
+
+    SECTION("A split shares the block it cuts") {
+        IOBuf front = buffer.Split(4);
+        REQUIRE(front.ToString() == "0123");
+        REQUIRE(buffer.ToString() == "456789");
+        REQUIRE(front.buffers()[0].data() == data);
+        REQUIRE(buffer.buffers()[0].data() == data + 4);
+
+        // Shared blocks are never written in place.
+        REQUIRE(front.tailroom() == 0);
+        std::memcpy(buffer.Prepend(1), "x", 1);
+        REQUIRE(buffer.segments() == 2);
+        REQUIRE(front.ToString() == "0123");
+        REQUIRE(buffer.ToString() == "x456789");
+    }
+
+    SECTION("A split on a segment boundary moves whole segments") {
+        buffer.Append("abc", 3);
+        IOBuf front = buffer.Split(10);
+        REQUIRE(front.segments() == 1);
+        REQUIRE(buffer.segments() == 1);
+        REQUIRE(buffer.ToString() == "abc");
+
+        IOBuf rest = buffer.Split(100);
+        REQUIRE(rest.ToString() == "abc");
+        REQUIRE(buffer.empty());
+    }
+
+    SECTION("A clone outlives the original") {
+        IOBuf clone = buffer.Clone();
+        buffer.clear();
+        REQUIRE(clone.buffers()[0].data() == data);
+        REQUIRE(clone.ToString() == "0123456789");
+    }
+
+    SECTION("Trimming drops bytes from either end") {
+        buffer.Append("abc", 3);
+        buffer.TrimFront(2);
+        buffer.TrimBack(4);
+        REQUIRE(buffer.segments() == 1);
+        REQUIRE(buffer.ToString() == "2345678");
+    }
+}
+
+TEST_CASE("Coalesce on demand", "[IOBuf][Gather][Coalesce]") {
+    IOBuf buffer = IOBuf::Copy("ab", 2, 8);
+    buffer.Append(IOBuf::Copy("cd", 2));
+    buffer.Append(IOBuf::Copy("efgh", 4));
+    REQUIRE(buffer.segments() == 3);
+
+    SECTION("Gathering a header copies only the segments it spans") {
+        const char* tail = buffer.buffers()[2].data();
+        REQUIRE(buffer.Gather(3) != nullptr);
+        REQUIRE(std::string(buffer.Gather(3), 4) == "abcd");
+        REQUIRE(buffer.segments() == 2);
+        REQUIRE(buffer.buffers()[1].data() == tail);
+        REQUIRE(buffer.headroom() == 8);
+
+        REQUIRE(buffer.Gather(9) == nullptr);
+    }
+
+    SECTION("Coalescing makes the whole chain contiguous") {
+        REQUIRE(std::string(buffer.Coalesce(), 8) == "abcdefgh");
+        REQUIRE(buffer.segments() == 1);
+        REQUIRE(buffer.ToString() == "abcdefgh");
+    }
+}
+
+TEST_CASE("Wrap a pooled buffer", "[IOBuf][BufferPool]") {
+    BufferPool pool(1024, 4);
+
+    PooledBuffer pooled = pool.Acquire();
+    std::memcpy(pooled.data(), "pooled", 6);
+    pooled.resize(6);
+    const char* data = pooled.data();
+
+    IOBuf buffer = IOBuf::Wrap(std::move(pooled));
+    REQUIRE(pool.used() == 1);
+    REQUIRE(buffer.ToString() == "pooled");
+    REQUIRE(buffer.buffers()[0].data() == data);
+    REQUIRE(buffer.tailroom() == 1024 - 6);
+
+    IOBuf clone = buffer.Clone();
+    buffer.clear();
+    REQUIRE(pool.used() == 1);
+    clone.clear();
+    REQUIRE(pool.used() == 0);
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Forward framed messages between sockets", "[IOBuf][SendV][ReceiveV]") {
+    SOCKET inbound[2];
+    SOCKET outbound[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, inbound) == 0);
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, outbound) == 0);
+
+    Socket upstream(inbound[0]);
+    Socket proxyIn(inbound[1]);
+    Socket proxyOut(outbound[0]);
+    Socket downstream(outbound[1]);
+
+    SECTION("Receives fill the tailroom before growing the chain") {
+        REQUIRE(upstream.Send("abcdef", 6) == 6);
+
+        IOBuf buffer = IOBuf::Create(4);
+        REQUIRE(proxyIn.ReceiveV(buffer, 6) == 6);
+        REQUIRE(buffer.segments() == 2);
+        REQUIRE(buffer.ToString() == "abcdef");
+
+        REQUIRE(upstream.Send("gh", 2) == 2);
+        REQUIRE(proxyIn.ReceiveV(buffer, 1024) == 2);
+        REQUIRE(buffer.size() == 8);
+        REQUIRE(buffer.ToString() == "abcdefgh");
+    }
+
+    SECTION("Frames are split off and re-sent with a new header") {
+        // Two frames, each a one byte length followed by the payload.
+        REQUIRE(upstream.Send("\x05hello\x05world", 12) == 12);
+
+        IOBuf received = IOBuf::Create(4096);
+        REQUIRE(proxyIn.ReceiveV(received) == 12);
+        const char* block = received.buffers()[0].data();
+
+        IOBuf forward;
+        while (received.Gather(1) != nullptr)
+        {
+            const size_t length = (unsigned char)*received.Gather(1);
+            received.TrimFront(1);
+
+            IOBuf frame = received.Split(length);
+            std::memcpy(frame.Prepend(2), "->", 2);
+            forward.Append(std::move(frame));
+        }
+
+        // Every payload still points into the block it was received into.
+        REQUIRE(forward.segments() == 4);
+        REQUIRE(forward.buffers()[1].data() == block + 1);
+        REQUIRE(forward.buffers()[3].data() == block + 7);
+
+        REQUIRE(proxyOut.SendV(forward) == 14);
+
+        std::string result;
+        while (result.size() < 14)
+            REQUIRE(downstream.Receive(result) > 0);
+
+        REQUIRE(result == "->hello->world");
+    }
+}
+#endif
@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+static bool Readable(TcpListener& listener, const int timeout)
+{
+    pollfd descriptor = { listener.socket().handle(), POLLIN, 0 };
+
+    return poll(&descriptor, 1, timeout) == 1;
+}
+
+// Accepts until the expected number of connections arrived or a second passed.
+static size_t AcceptAll(TcpListener& listener, std::vector<AcceptedConnection>& connections, const size_t expected)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+    while (connections.size() < expected && std::chrono::steady_clock::now() < deadline)
+        if (Readable(listener, 100))
+            listener.AcceptBatch(connections);
+
+    return connections.size();
+}
+
+static_assert(!std::is_convertible<TcpListener, bool>::value, "Listeners only test as bool, like the Socket they wrap.");
+
+TEST_CASE("Accept connections in batches", "[TcpListener]") {
+    TcpListener listener;
+    REQUIRE_FALSE(listener);
+    REQUIRE(listener.Listen(Address(AddressFamily::INET, "127.0.0.1", 0)));
+    REQUIRE(listener);
+    REQUIRE(((sockaddr_in*)listener.address().name())->sin_port != 0);
+    REQUIRE((fcntl(listener.socket().handle(), F_GETFL) & O_NONBLOCK) != 0);
+    REQUIRE((fcntl(listener.socket().handle(), F_GETFD) & FD_CLOEXEC) != 0);
+
+    std::vector<AcceptedConnection> connections;
+    connections.reserve(16);
+
+    // An empty queue ends the batch with EAGAIN.
+    REQUIRE(listener.AcceptBatch(connections) == 0);
+    REQUIRE((nsSocketError() == EAGAIN || nsSocketError() == EWOULDBLOCK));
+
+    std::vector<Socket> clients;
+    std::set<unsigned short> ports;
+    for (int i = 0; i < 10; ++i)
+    {
+        clients.emplace_back(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        REQUIRE(clients.back().Connect(listener.address()));
+        ports.insert(((sockaddr_in*)clients.back().GetLocalAddress().name())->sin_port);
+    }
+
+    SECTION("A batch drains the queue") {
+        REQUIRE(AcceptAll(listener, connections, 10) == 10);
+
+        for (const AcceptedConnection& connection : connections)
+        {
+            REQUIRE(connection.socket);
+            REQUIRE((fcntl(connection.socket.handle(), F_GETFL) & O_NONBLOCK) != 0);
+            REQUIRE((fcntl(connection.socket.handle(), F_GETFD) & FD_CLOEXEC) != 0);
+            REQUIRE(ports.erase(((sockaddr_in*)connection.peer.name())->sin_port) == 1);
+        }
+
+        REQUIRE(ports.empty());
+        REQUIRE(listener.AcceptBatch(connections) == 0);
+    }
+
+    SECTION("A batch stops at its limit") {
+        REQUIRE(Readable(listener, 1000));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        REQUIRE(listener.AcceptBatch(connections, 4) == 4);
+        REQUIRE(connections.size() == 4);
+        REQUIRE(AcceptAll(listener, connections, 10) == 10);
+    }
+
+    SECTION("Closing refuses further connections") {
+        const Address address = listener.address();
+        listener.Close();
+        REQUIRE_FALSE(listener);
+
+        Socket late(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        REQUIRE_FALSE(late.Connect(address));
+    }
+}
+
+TEST_CASE("Listener options", "[TcpListener]") {
+    SECTION("The backlog is applied") {
+        ListenerOptions options;
+        options.backlog = 7;
+
+        TcpListener listener;
+        REQUIRE(listener.Listen(Address(AddressFamily::INET, "127.0.0.1", 0), options));
+
+        // Linux reports the backlog of a listening socket in tcpi_sacked.
+        tcp_info info = {};
+        socklen_t length = sizeof(info);
+        REQUIRE(getsockopt(listener.socket().handle(), IPPROTO_TCP, TCP_INFO, &info, &length) == 0);
+        REQUIRE(info.tcpi_sacked == 7);
+    }
+
+    SECTION("Deferred connections are accepted once they have data") {
+        ListenerOptions options;
+        options.deferAccept = 5;
+
+        TcpListener listener;
+        REQUIRE(listener.Listen(Address(AddressFamily::INET, "127.0.0.1", 0), options));
+
+        int deferred = 0;
+        REQUIRE(listener.socket().GetOption(options::DEFER_ACCEPT, deferred));
+        REQUIRE(deferred > 0);
+
+        Socket client(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        REQUIRE(client.Connect(listener.address()));
+        REQUIRE_FALSE(Readable(listener, 100));
+
+        REQUIRE(client.Send("x", 1) == 1);
+        REQUIRE(Readable(listener, 1000));
+
+        std::vector<AcceptedConnection> connections;
+        REQUIRE(listener.AcceptBatch(connections) == 1);
+
+        char data = 0;
+        REQUIRE(connections[0].socket.Receive(&data, 1) == 1);
+        REQUIRE(data == 'x');
+    }
+
+    SECTION("Several listeners share a port") {
+        ListenerOptions options;
+        options.reusePort = true;
+
+        TcpListener first, second;
+        REQUIRE(first.Listen(Address(AddressFamily::INET, "127.0.0.1", 0), options));
+        REQUIRE(second.Listen(first.address(), options));
+
+        TcpListener exclusive;
+        REQUIRE_FALSE(exclusive.Listen(first.address()));
+    }
+}
@@ -0,0 +1,133 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+static bool countAllocations = false;
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (countAllocations)
+        ++allocations;
+
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+TEST_CASE("Draw buffers from a pool and return them", "[BufferPool]") {
+    BufferPool pool(1000, 16);
+    REQUIRE(pool.bufferSize() == 1024);
+    REQUIRE(pool.capacity() == 0);
+
+    SECTION("Occupancy follows the buffers in use") {
+        std::vector<PooledBuffer> buffers;
+        for (int i = 0; i < 20; ++i)
+        {
+            buffers.push_back(pool.Acquire());
+            REQUIRE(buffers.back());
+            REQUIRE(buffers.back().capacity() == 1024);
+        }
+
+        REQUIRE(pool.slabs() == 2);
+        REQUIRE(pool.capacity() == 32);
+        REQUIRE(pool.used() == 20);
+        REQUIRE(pool.occupancy() == 20.0 / 32);
+
+        buffers.resize(5);
+        REQUIRE(pool.used() == 5);
+
+        PooledBuffer moved = std::move(buffers[0]);
+        REQUIRE_FALSE(buffers[0]);
+        moved.reset();
+        REQUIRE_FALSE(moved);
+        REQUIRE(pool.used() == 4);
+    }
+
+    SECTION("A limited pool runs out") {
+        BufferPool limited(4096, 2, false, 1);
+        PooledBuffer first = limited.Acquire();
+        PooledBuffer second = limited.Acquire();
+
+        REQUIRE(first);
+        REQUIRE(second);
+        REQUIRE(first.data() != second.data());
+        REQUIRE_FALSE(limited.Acquire());
+
+        first.reset();
+        REQUIRE(limited.Acquire());
+    }
+
+#if !defined(_WIN32)
+    SECTION("Steady state receives allocate nothing") {
+        SOCKET pair[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+        Socket writer(pair[0]);
+        Socket reader(pair[1]);
+        const std::string message = "replicated";
+
+        // Warms up the pool and the free list of this thread.
+        pool.Acquire();
+
+        countAllocations = true;
+        allocations = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            PooledBuffer buffer = pool.Acquire();
+            writer.Send(message.data(), (int)message.size(), 0);
+            REQUIRE(reader.Receive(buffer) == (int)message.size());
+            REQUIRE(buffer.size() == message.size());
+        }
+        countAllocations = false;
+
+        REQUIRE(allocations == 0);
+        REQUIRE(pool.used() == 0);
+        REQUIRE(pool.slabs() == 1);
+    }
+#endif
+
+    SECTION("Buffers can be released on another thread") {
+        std::vector<PooledBuffer> buffers;
+        for (int round = 0; round < 10; ++round)
+        {
+            for (int i = 0; i < 100; ++i)
+                buffers.push_back(pool.Acquire());
+
+            std::thread releaser([&buffers]() { buffers.clear(); });
+            releaser.join();
+        }
+
+        // Buffers released by the other thread flow back through the shared list instead of growing the pool.
+        REQUIRE(pool.used() == 0);
+        REQUIRE(pool.capacity() <= 16 * 14);
+    }
+}
+
+TEST_CASE("Huge page pools fall back to regular pages", "[BufferPool]") {
+    BufferPool pool(64 * 1024, 32, true);
+    PooledBuffer buffer = pool.Acquire();
+
+    REQUIRE(buffer);
+    REQUIRE(pool.slabs() == 1);
+    REQUIRE(pool.capacity() >= 32);
+    REQUIRE(pool.hugeSlabs() <= 1);
+
+    buffer.data()[buffer.capacity() - 1] = 1;
+}
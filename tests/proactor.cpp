@@ -0,0 +1,171 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+struct RecordingOperation : Operation
+{
+    int result = 0;
+    int completions = 0;
+
+    void OnComplete(const int value) override
+    {
+        result = value;
+        ++completions;
+    }
+};
+
+static void RunUntil(Proactor& proactor, const RecordingOperation& operation)
+{
+    for (int i = 0; i < 100 && operation.completions == 0; ++i)
+        proactor.RunOnce(100);
+}
+
+static void TestBackend(const bool allowIoUring)
+{
+    Proactor proactor(64, 8, allowIoUring);
+    if (!allowIoUring)
+        REQUIRE_FALSE(proactor.UsingIoUring());
+
+    SECTION("Receive and send complete with byte counts") {
+        SOCKET pair[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+        Socket local(pair[0]);
+        Socket remote(pair[1]);
+
+        char buffer[16] = {};
+        RecordingOperation receive;
+        REQUIRE(proactor.Receive(local, buffer, sizeof(buffer), receive));
+        REQUIRE(proactor.size() == 1);
+
+        proactor.RunOnce(0);
+        REQUIRE(receive.completions == 0);
+
+        RecordingOperation send;
+        REQUIRE(proactor.Send(remote, "hello", 5, send));
+
+        RunUntil(proactor, receive);
+        RunUntil(proactor, send);
+        REQUIRE(send.result == 5);
+        REQUIRE(receive.result == 5);
+        REQUIRE(std::string(buffer, 5) == "hello");
+        REQUIRE(proactor.size() == 0);
+    }
+
+    SECTION("Registered sockets and buffers") {
+        SOCKET pair[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+        Socket local(pair[0]);
+        Socket remote(pair[1]);
+
+        char storage[64] = {};
+        MutableBuffer registered(storage);
+        REQUIRE(proactor.RegisterBuffers(&registered, 1));
+        REQUIRE(proactor.RegisterSocket(local));
+        REQUIRE(proactor.RegisterSocket(remote));
+
+        std::memcpy(storage, "fixed", 5);
+        RecordingOperation send, receive;
+        REQUIRE(proactor.SendFixed(remote, 0, storage, 5, send));
+        REQUIRE(proactor.ReceiveFixed(local, 0, storage + 32, 32, receive));
+
+        RunUntil(proactor, send);
+        RunUntil(proactor, receive);
+        REQUIRE(send.result == 5);
+        REQUIRE(receive.result == 5);
+        REQUIRE(std::string(storage + 32, 5) == "fixed");
+
+        proactor.UnregisterSocket(local);
+        proactor.UnregisterSocket(remote);
+    }
+
+    SECTION("Accept and connect over loopback") {
+        Socket listener(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        Address address(AddressFamily::INET, "127.0.0.1", 0);
+        socklen_t length = sizeof(sockaddr_in);
+        REQUIRE(bind(listener.handle(), address.name(), length) == 0);
+        REQUIRE(listen(listener.handle(), 4) == 0);
+        REQUIRE(getsockname(listener.handle(), address.name(), &length) == 0);
+        *address.ptr() = length;
+
+        Address peer;
+        RecordingOperation accept, connect;
+        REQUIRE(proactor.Accept(listener, accept, &peer));
+
+        Socket client(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        REQUIRE(proactor.Connect(client, address, connect));
+
+        RunUntil(proactor, connect);
+        RunUntil(proactor, accept);
+        REQUIRE(connect.result == 0);
+        REQUIRE(accept.result >= 0);
+        REQUIRE(peer.size() == sizeof(sockaddr_in));
+
+        Socket server(accept.result);
+    }
+
+    SECTION("Connect reports refused connections") {
+        Address address(AddressFamily::INET, "127.0.0.1", 1);
+        *address.ptr() = sizeof(sockaddr_in);
+
+        Socket client(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        RecordingOperation connect;
+        REQUIRE(proactor.Connect(client, address, connect));
+
+        RunUntil(proactor, connect);
+        REQUIRE(connect.result == -ECONNREFUSED);
+    }
+
+    SECTION("Stop interrupts a blocking run from another thread") {
+        std::thread stopper([&proactor]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            proactor.Stop();
+        });
+
+        proactor.Run();
+        stopper.join();
+    }
+}
+
+TEST_CASE("Complete operations with io_uring", "[Proactor]") {
+    TestBackend(true);
+}
+
+TEST_CASE("Complete operations with the fallback reactor", "[Proactor]") {
+    TestBackend(false);
+}
+
+TEST_CASE("Operations beyond the submission queue are submitted, not overwritten", "[Proactor]") {
+    Proactor proactor(4);
+
+    SOCKET pair[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    Socket local(pair[0]);
+    Socket remote(pair[1]);
+
+    // Every send past the fourth finds the queue full and has to submit the others first.
+    RecordingOperation sends[32];
+    for (RecordingOperation& send : sends)
+        REQUIRE(proactor.Send(local, "x", 1, send));
+
+    for (RecordingOperation& send : sends)
+    {
+        RunUntil(proactor, send);
+        REQUIRE(send.result == 1);
+    }
+
+    char buffer[64];
+    size_t received = 0;
+    while (received < 32)
+    {
+        const int count = remote.Receive(buffer, sizeof(buffer));
+        REQUIRE(count > 0);
+        received += (size_t)count;
+    }
+
+    REQUIRE(received == 32);
+    REQUIRE(proactor.size() == 0);
+}
@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+#include <functional>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+struct CountingHandler : Handler
+{
+    int readable = 0;
+    int writable = 0;
+    int errors = 0;
+
+    void OnReadable(Socket&) override { ++readable; }
+    void OnWritable(Socket&) override { ++writable; }
+    void OnError(Socket&) override { ++errors; }
+};
+
+TEST_CASE("Dispatch readiness with the reactor", "[Reactor]") {
+    SOCKET pair[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+
+    Socket local(pair[0]);
+    Socket remote(pair[1]);
+    REQUIRE(local.SetBlocking(false));
+
+    Reactor reactor;
+    REQUIRE(reactor);
+
+    CountingHandler handler;
+
+    SECTION("Level triggered reads are reported until drained") {
+        REQUIRE(reactor.Add(local, handler, Interest::READ));
+        REQUIRE_FALSE(reactor.Add(local, handler, Interest::READ));
+        REQUIRE(reactor.size() == 1);
+
+        REQUIRE(reactor.RunOnce(0) == 0);
+
+        remote.Send("ping");
+        REQUIRE(reactor.RunOnce(100) == 1);
+        REQUIRE(reactor.RunOnce(0) == 1);
+        REQUIRE(handler.readable == 2);
+
+        std::string buffer;
+        REQUIRE(local.Receive(buffer) == 4);
+        REQUIRE(reactor.RunOnce(0) == 0);
+    }
+
+    SECTION("Edge triggered reads are reported once per arrival") {
+        REQUIRE(reactor.Add(local, handler, Interest::READ, Trigger::EDGE));
+
+        remote.Send("ping");
+        REQUIRE(reactor.RunOnce(100) == 1);
+        REQUIRE(reactor.RunOnce(0) == 0);
+
+        remote.Send("pong");
+        REQUIRE(reactor.RunOnce(100) == 1);
+        REQUIRE(handler.readable == 2);
+    }
+
+    SECTION("Writable and error callbacks") {
+        REQUIRE(reactor.Add(local, handler, Interest::READ_WRITE));
+        REQUIRE(reactor.RunOnce(0) == 1);
+        REQUIRE(handler.writable == 1);
+
+        REQUIRE(reactor.Modify(local, Interest::NONE));
+        remote.Shutdown();
+        REQUIRE(reactor.RunOnce(100) == 1);
+        REQUIRE(handler.errors == 1);
+    }
+
+    SECTION("Handlers can remove their own registration") {
+        struct RemovingHandler : Handler
+        {
+            Reactor& reactor;
+            int calls = 0;
+
+            RemovingHandler(Reactor& reactor) : reactor(reactor) {}
+
+            void OnReadable(Socket& socket) override { ++calls; reactor.Remove(socket); }
+            void OnWritable(Socket&) override { ++calls; }
+        } removing(reactor);
+
+        REQUIRE(reactor.Add(local, removing, Interest::READ_WRITE));
+        remote.Send("ping");
+
+        REQUIRE(reactor.RunOnce(100) == 1);
+        REQUIRE(removing.calls == 1);
+        REQUIRE(reactor.size() == 0);
+        REQUIRE(reactor.RunOnce(0) == 0);
+    }
+
+    SECTION("Stop interrupts a blocking run from another thread") {
+        std::thread stopper([&reactor]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            reactor.Stop();
+        });
+
+        reactor.Run();
+        stopper.join();
+    }
+
+    SECTION("Timers expire on the reactor and idle timeouts can be pushed back") {
+        int retransmits = 0;
+        bool idle = false;
+
+        CallbackTimer<std::function<void()>> retransmit([&]() { ++retransmits; });
+        CallbackTimer<std::function<void()>> reaper([&]() { idle = true; });
+
+        reactor.Schedule(retransmit, 10);
+        reactor.Schedule(reaper, 40);
+        REQUIRE(reactor.timers() == 2);
+
+        // Activity keeps the connection from being reaped.
+        for (int i = 0; i < 4; ++i)
+        {
+            reactor.RunOnce(20);
+            reactor.Schedule(reaper, 40);
+        }
+
+        REQUIRE(retransmits == 1);
+        REQUIRE_FALSE(idle);
+
+        for (int i = 0; i < 100 && !idle; ++i)
+            reactor.RunOnce();
+
+        REQUIRE(idle);
+        REQUIRE(reactor.timers() == 0);
+    }
+}
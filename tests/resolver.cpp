@@ -0,0 +1,373 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+// A name server on loopback answering from a fixed zone, counting the queries it receives.
+class StubServer
+{
+public:
+    struct Zone
+    {
+        std::vector<std::string> a;     // Addresses in text.
+        std::vector<std::string> aaaa;
+        uint32_t ttl = 60;
+        std::string alias;              // Answered as a CNAME to the zone of this name.
+        bool missing = false;           // Answered with NXDOMAIN and an SOA record.
+        uint32_t minimum = 60;          // The negative TTL in the SOA record.
+        bool drop = false;              // Never answered.
+        int delay = 0;                  // Milliseconds to wait before answering.
+    };
+
+private:
+    Socket socket_;
+    Address address_;
+    std::map<std::string, Zone> zones_;
+    std::map<std::string, int> counts_;
+    std::mutex mutex_;
+    std::atomic<bool> stopping_;
+    std::thread thread_;
+
+    static void Put16(std::string& out, const uint16_t value)
+    {
+        out += (char)(value >> 8);
+        out += (char)value;
+    }
+
+    static void Put32(std::string& out, const uint32_t value)
+    {
+        Put16(out, (uint16_t)(value >> 16));
+        Put16(out, (uint16_t)value);
+    }
+
+    static std::string Encode(const std::string& name)
+    {
+        std::string out;
+        size_t start = 0;
+        while (start < name.size())
+        {
+            size_t end = name.find('.', start);
+            if (end == std::string::npos)
+                end = name.size();
+
+            out += (char)(end - start);
+            out += name.substr(start, end - start);
+            start = end + 1;
+        }
+
+        return out + '\0';
+    }
+
+    static void Record(std::string& out, const std::string& owner, const uint16_t type, const uint32_t ttl, const std::string& data)
+    {
+        out += owner;
+        Put16(out, type);
+        Put16(out, 1);
+        Put32(out, ttl);
+        Put16(out, (uint16_t)data.size());
+        out += data;
+    }
+
+    static std::string Bytes(const std::string& text, const int family)
+    {
+        uint8_t bytes[16];
+        inet_pton(family, text.c_str(), bytes);
+
+        return std::string((const char*)bytes, family == AF_INET ? 4 : 16);
+    }
+
+    std::string Answer(const char* query, const size_t length)
+    {
+        // The question follows the header, its name in plain labels.
+        size_t offset = 12;
+        std::string name;
+        while (offset < length && query[offset] != 0)
+        {
+            const size_t label = (uint8_t)query[offset];
+            if (!name.empty())
+                name += '.';
+            name.append(query + offset + 1, label);
+            offset += label + 1;
+        }
+
+        const size_t end = offset + 5;
+        const uint16_t type = (uint16_t)((uint8_t)query[offset + 1] << 8 | (uint8_t)query[offset + 2]);
+
+        Zone zone;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++counts_[name + (type == 1 ? "/A" : "/AAAA")];
+
+            const auto found = zones_.find(name);
+            zone = found == zones_.end() ? Zone{ {}, {}, 60, "", true, 60, false, 0 } : found->second;
+        }
+
+        if (zone.drop)
+            return std::string();
+
+        if (zone.delay != 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(zone.delay));
+
+        std::string answers;
+        uint16_t count = 0;
+        std::string owner = "\xc0\x0c";
+
+        if (!zone.alias.empty())
+        {
+            Record(answers, owner, 5, zone.ttl, Encode(zone.alias));
+            ++count;
+
+            // The addresses belong to the target of the alias, written out in full.
+            owner = Encode(zone.alias);
+            std::lock_guard<std::mutex> lock(mutex_);
+            zone = zones_[zone.alias];
+        }
+
+        for (const std::string& address : type == 1 ? zone.a : zone.aaaa)
+        {
+            Record(answers, owner, type, zone.ttl, Bytes(address, type == 1 ? AF_INET : AF_INET6));
+            ++count;
+        }
+
+        std::string authority;
+        if (zone.missing || count == 0)
+        {
+            std::string soa = Encode("ns.test") + Encode("admin.test");
+            Put32(soa, 1);
+            Put32(soa, 3600);
+            Put32(soa, 600);
+            Put32(soa, 86400);
+            Put32(soa, zone.minimum);
+            Record(authority, Encode("test"), 6, 3600, soa);
+        }
+
+        std::string out(query, 2);
+        Put16(out, zone.missing ? 0x8183 : 0x8180);
+        Put16(out, 1);
+        Put16(out, count);
+        Put16(out, authority.empty() ? 0 : 1);
+        Put16(out, 0);
+        out.append(query + 12, end - 12);
+
+        return out + answers + authority;
+    }
+
+    void Run()
+    {
+        char query[1500];
+
+        while (!stopping_.load())
+        {
+            Address from;
+            const int length = socket_.ReceiveFrom(query, sizeof(query), from);
+            if (length < 17 || stopping_.load())
+                continue;
+
+            const std::string answer = Answer(query, (size_t)length);
+            if (!answer.empty())
+                socket_.SendTo(answer.data(), (int)answer.size(), 0, from.name(), from.size());
+        }
+    }
+
+public:
+    StubServer() : socket_(AddressFamily::INET, SocketType::DATAGRAM, SocketProtocol::UDP), stopping_(false)
+    {
+        socket_.Bind(Address(AddressFamily::INET, "127.0.0.1", 0));
+        address_ = socket_.GetLocalAddress();
+        thread_ = std::thread([this]() { Run(); });
+    }
+
+    ~StubServer()
+    {
+        stopping_.store(true);
+
+        Socket waker(AddressFamily::INET, SocketType::DATAGRAM, SocketProtocol::UDP);
+        waker.SendTo("x", 1, 0, address_.name(), address_.size());
+        thread_.join();
+    }
+
+    const Address& address() const
+    {
+        return address_;
+    }
+
+    void Add(const std::string& name, const Zone& zone)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        zones_[name] = zone;
+    }
+
+    int count(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return counts_[key];
+    }
+};
+
+struct Result
+{
+    int error;
+    std::vector<std::string> addresses;    // Formatted with their ports.
+};
+
+static std::future<Result> Lookup(Resolver& resolver, const char* host, const unsigned short port, const AddressFamily family = AddressFamily::UNSPEC)
+{
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+
+    resolver.Resolve(host, port, [promise](const int error, const std::vector<Address>& addresses) {
+        Result result{ error, {} };
+        for (const Address& address : addresses)
+        {
+            char text[MAX_ADDRESS_TEXT];
+            FormatAddress(CompactAddress(address), text);
+            result.addresses.push_back(text);
+        }
+
+        promise->set_value(result);
+    }, family);
+
+    return future;
+}
+
+static ResolverOptions Fast()
+{
+    ResolverOptions options;
+    options.timeout = 100;
+    options.attempts = 2;
+
+    return options;
+}
+
+TEST_CASE("Resolve names through a stub name server", "[Resolver]") {
+    StubServer server;
+    server.Add("www.example.test", { { "192.0.2.1", "192.0.2.2" }, { "2001:db8::1" }, 1, "" });
+    server.Add("alias.example.test", { {}, {}, 60, "www.example.test" });
+    server.Add("v4only.example.test", { { "192.0.2.9" }, {}, 60, "" });
+    server.Add("missing.example.test", { {}, {}, 60, "", true, 1 });
+
+    Resolver resolver({ server.address() }, Fast());
+    REQUIRE(resolver);
+
+    SECTION("Answers are cached for their TTL") {
+        Result result = Lookup(resolver, "www.example.test", 443).get();
+        REQUIRE(result.error == 0);
+        REQUIRE(result.addresses == std::vector<std::string>{ "[2001:db8::1]:443", "192.0.2.1:443", "192.0.2.2:443" });
+        REQUIRE(server.count("www.example.test/A") == 1);
+        REQUIRE(server.count("www.example.test/AAAA") == 1);
+
+        // A cached answer is delivered before Resolve returns, with the port of the new caller.
+        std::future<Result> cached = Lookup(resolver, "WWW.Example.Test.", 80);
+        REQUIRE(cached.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        REQUIRE(cached.get().addresses[1] == "192.0.2.1:80");
+        REQUIRE(server.count("www.example.test/A") == 1);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+        REQUIRE(Lookup(resolver, "www.example.test", 443).get().addresses.size() == 3);
+        REQUIRE(server.count("www.example.test/A") == 2);
+    }
+
+    SECTION("Aliases are followed and families can be asked for alone") {
+        Result result = Lookup(resolver, "alias.example.test", 53, AddressFamily::INET).get();
+        REQUIRE(result.error == 0);
+        REQUIRE(result.addresses == std::vector<std::string>{ "192.0.2.1:53", "192.0.2.2:53" });
+        REQUIRE(server.count("alias.example.test/AAAA") == 0);
+
+        result = Lookup(resolver, "alias.example.test", 53, AddressFamily::INET6).get();
+        REQUIRE(result.addresses == std::vector<std::string>{ "[2001:db8::1]:53" });
+    }
+
+    SECTION("Missing names and records are cached for the SOA minimum") {
+        REQUIRE(Lookup(resolver, "missing.example.test", 80).get().error == EAI_NONAME);
+        REQUIRE(Lookup(resolver, "missing.example.test", 80).get().error == EAI_NONAME);
+        REQUIRE(server.count("missing.example.test/A") == 1);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+        REQUIRE(Lookup(resolver, "missing.example.test", 80).get().error == EAI_NONAME);
+        REQUIRE(server.count("missing.example.test/A") == 2);
+
+        // A name without AAAA records still has its A records.
+        Result result = Lookup(resolver, "v4only.example.test", 80).get();
+        REQUIRE(result.error == 0);
+        REQUIRE(result.addresses == std::vector<std::string>{ "192.0.2.9:80" });
+        REQUIRE(Lookup(resolver, "v4only.example.test", 80, AddressFamily::INET6).get().error == EAI_NONAME);
+    }
+
+    SECTION("Numeric addresses and localhost need no query") {
+        REQUIRE(Lookup(resolver, "198.51.100.7", 25).get().addresses == std::vector<std::string>{ "198.51.100.7:25" });
+        REQUIRE(Lookup(resolver, "::1", 25).get().addresses == std::vector<std::string>{ "[::1]:25" });
+        REQUIRE(Lookup(resolver, "198.51.100.7", 25, AddressFamily::INET6).get().error == EAI_NONAME);
+        REQUIRE(Lookup(resolver, "localhost", 8080, AddressFamily::INET).get().addresses == std::vector<std::string>{ "127.0.0.1:8080" });
+        REQUIRE(Lookup(resolver, "bad..name", 80).get().error == EAI_NONAME);
+        REQUIRE(resolver.queries() == 0);
+    }
+}
+
+TEST_CASE("Concurrent lookups of a name share one query", "[Resolver]") {
+    StubServer server;
+    server.Add("slow.example.test", { { "192.0.2.5" }, {}, 60, "", false, 60, false, 300 });
+
+    Resolver resolver({ server.address() }, ResolverOptions());
+
+    std::vector<std::future<Result>> results;
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < 4; ++j)
+            {
+                std::future<Result> result = Lookup(resolver, "slow.example.test", (unsigned short)(1000 + i * 4 + j), AddressFamily::INET);
+                std::lock_guard<std::mutex> lock(mutex);
+                results.push_back(std::move(result));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (std::future<Result>& result : results)
+    {
+        Result value = result.get();
+        REQUIRE(value.error == 0);
+        REQUIRE(value.addresses.size() == 1);
+    }
+
+    REQUIRE(results.size() == 32);
+    REQUIRE(server.count("slow.example.test/A") == 1);
+    REQUIRE(resolver.queries() == 1);
+}
+
+TEST_CASE("Unanswered lookups fail without being cached", "[Resolver]") {
+    StubServer server;
+    server.Add("drop.example.test", { { "192.0.2.5" }, {}, 60, "", false, 60, true });
+
+    Resolver resolver({ server.address() }, Fast());
+
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(Lookup(resolver, "drop.example.test", 80, AddressFamily::INET).get().error == EAI_AGAIN);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(200));
+    REQUIRE(server.count("drop.example.test/A") == 2);
+    REQUIRE(resolver.cached() == 0);
+
+    // Lookups still in flight when the resolver is destroyed fail too.
+    std::future<Result> pending;
+    {
+        Resolver other({ server.address() }, ResolverOptions());
+        pending = Lookup(other, "drop.example.test", 80);
+    }
+
+    REQUIRE(pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    REQUIRE(pending.get().error == EAI_AGAIN);
+}
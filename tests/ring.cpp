@@ -0,0 +1,263 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+// Offers a ring on one end of a socket pair and accepts it on the other.
+static void Connect(RingSocket& offered, RingSocket& accepted, const size_t capacity)
+{
+    Socket a, b;
+    REQUIRE(Socket::Pair(SocketType::STREAM, a, b));
+
+    offered = RingSocket::Offer(a, capacity);
+    accepted = RingSocket::Accept(b);
+}
+
+TEST_CASE("Ring sockets carry data both ways", "[RingSocket]") {
+    RingSocket a, b;
+    Connect(a, b, 1000);
+    REQUIRE(a);
+    REQUIRE(b);
+    REQUIRE(a.capacity() == 4096);
+    REQUIRE(b.capacity() == 4096);
+
+    REQUIRE(a.Send("ping", 4) == 4);
+    REQUIRE(b.Send(std::string("pong")) == 4);
+
+    char buffer[8];
+    REQUIRE(b.Receive(buffer, sizeof(buffer), MSG_PEEK) == 4);
+    REQUIRE(b.Receive(buffer, sizeof(buffer)) == 4);
+    REQUIRE(std::string(buffer, 4) == "ping");
+
+    std::string received;
+    REQUIRE(a.Receive(received) == 4);
+    REQUIRE(received == "pong");
+}
+
+TEST_CASE("Ring sockets stream more than their capacity", "[RingSocket]") {
+    RingSocket a, b;
+    Connect(a, b, 4096);
+
+    std::string sent(1 << 20, '\0');
+    for (size_t i = 0; i < sent.size(); ++i)
+        sent[i] = (char)(i * 31 + i / 4096);
+
+    std::thread producer([&]() {
+        // Odd sizes make writes wrap around the end of the ring.
+        for (size_t offset = 0; offset < sent.size(); offset += 3001)
+            a.Send(sent.data() + offset, (int)std::min<size_t>(3001, sent.size() - offset));
+    });
+
+    std::string received;
+    char buffer[1500];
+    while (received.size() < sent.size())
+    {
+        const int count = b.Receive(buffer, sizeof(buffer));
+        REQUIRE(count > 0);
+        received.append(buffer, count);
+    }
+
+    producer.join();
+    REQUIRE(received == sent);
+}
+
+TEST_CASE("Non-blocking ring sockets", "[RingSocket]") {
+    RingSocket a, b;
+    Connect(a, b, 4096);
+    a.SetBlocking(false);
+    b.SetBlocking(false);
+
+    char buffer[4096];
+    REQUIRE(b.Receive(buffer, sizeof(buffer)) == -1);
+    REQUIRE(errno == EAGAIN);
+
+    // A full ring takes what fits, then nothing.
+    const std::string data(5000, 'x');
+    REQUIRE(a.Send(data) == 4096);
+    REQUIRE(a.Send(data) == -1);
+    REQUIRE(errno == EAGAIN);
+
+    REQUIRE(b.Receive(buffer, 100) == 100);
+    REQUIRE(a.Send(data) == 100);
+}
+
+TEST_CASE("Closing a ring socket", "[RingSocket]") {
+    RingSocket a, b;
+    Connect(a, b, 4096);
+
+    SECTION("Data sent before closing is delivered, then end of stream") {
+        REQUIRE(a.Send("last", 4) == 4);
+        a.Close();
+        REQUIRE_FALSE(a);
+
+        char buffer[8];
+        REQUIRE(b.Receive(buffer, sizeof(buffer)) == 4);
+        REQUIRE(b.Receive(buffer, sizeof(buffer)) == 0);
+        REQUIRE(b.Send("late", 4) == -1);
+        REQUIRE(errno == EPIPE);
+    }
+
+    SECTION("Closing wakes a blocked receiver") {
+        std::thread closer([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            a.Close();
+        });
+
+        char buffer[8];
+        REQUIRE(b.Receive(buffer, sizeof(buffer)) == 0);
+        closer.join();
+    }
+
+    SECTION("Closed sockets are not connected") {
+        a.Close();
+        REQUIRE(a.Send("x", 1) == -1);
+        REQUIRE(errno == ENOTCONN);
+    }
+}
+
+TEST_CASE("Ring sockets between processes", "[RingSocket]") {
+    Socket control, other;
+    REQUIRE(Socket::Pair(SocketType::STREAM, control, other));
+
+    const pid_t child = fork();
+    REQUIRE(child >= 0);
+
+    if (child == 0)
+    {
+        // Echoes everything back until the parent closes.
+        control.reset();
+        RingSocket ring = RingSocket::Accept(other);
+        char buffer[256];
+        int count;
+
+        while ((count = ring.Receive(buffer, sizeof(buffer))) > 0)
+            ring.Send(buffer, count);
+
+        _exit(ring ? 0 : 1);
+    }
+
+    other.reset();
+    RingSocket ring = RingSocket::Offer(control, 4096);
+    REQUIRE(ring);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::string message = "message " + std::to_string(i);
+        REQUIRE(ring.Send(message) == (int)message.size());
+
+        std::string reply;
+        while (reply.size() < message.size())
+            REQUIRE(ring.Receive(reply) > 0);
+
+        REQUIRE(reply == message);
+    }
+
+    ring.Close();
+
+    int status = 0;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
+
+TEST_CASE("Ring negotiation rejects bad offers", "[RingSocket]") {
+    Socket a, b;
+    REQUIRE(Socket::Pair(SocketType::STREAM, a, b));
+
+    SECTION("Data without memory") {
+        REQUIRE(a.Send("R", 1) == 1);
+        REQUIRE_FALSE(RingSocket::Accept(b));
+    }
+
+    SECTION("Memory that is not a ring") {
+        int pipe[2];
+        REQUIRE(::pipe(pipe) == 0);
+        REQUIRE(a.SendDescriptors("R", 1, pipe, 1) == 1);
+        REQUIRE_FALSE(RingSocket::Accept(b));
+
+        close(pipe[0]);
+        close(pipe[1]);
+    }
+
+    SECTION("A closed peer") {
+        REQUIRE(a.Shutdown());
+        REQUIRE_FALSE(RingSocket::Accept(b));
+    }
+}
+
+TEST_CASE("Ring sockets reject a corrupted peer", "[RingSocket]") {
+    Socket a, b;
+    REQUIRE(Socket::Pair(SocketType::STREAM, a, b));
+    RingSocket ring = RingSocket::Offer(a, 4096);
+    REQUIRE(ring);
+
+    // Maps the offered memory as a peer would, without going through Accept.
+    char tag;
+    int memory = -1;
+    size_t count = 1;
+    REQUIRE(b.ReceiveDescriptors(&tag, 1, &memory, count) == 1);
+    REQUIRE(count == 1);
+
+    const size_t size = 4096 + 4096 * 2;
+    char* mapping = (char*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    close(memory);
+    REQUIRE(mapping != MAP_FAILED);
+
+    // The ring back to the offering side follows the header line and the three cache lines of the first ring.
+    uint64_t* head = (uint64_t*)(mapping + 64 + 3 * 64);
+    *head = 1 << 20;
+
+    char buffer[64];
+    REQUIRE(ring.Receive(buffer, sizeof(buffer)) == -1);
+    REQUIRE(errno == ECONNRESET);
+    REQUIRE(ring.Send("x", 1) == -1);
+    REQUIRE(errno == ECONNRESET);
+
+    munmap(mapping, size);
+}
+
+TEST_CASE("Ring memory cannot be resized by the peer", "[RingSocket]") {
+    Socket a, b;
+    REQUIRE(Socket::Pair(SocketType::STREAM, a, b));
+
+    SECTION("Offered memory is sealed") {
+        RingSocket ring = RingSocket::Offer(a, 4096);
+        REQUIRE(ring);
+
+        char tag;
+        int memory = -1;
+        size_t count = 1;
+        REQUIRE(b.ReceiveDescriptors(&tag, 1, &memory, count) == 1);
+
+        REQUIRE(ftruncate(memory, 0) == -1);
+        REQUIRE(errno == EPERM);
+        REQUIRE(ftruncate(memory, 1 << 20) == -1);
+        REQUIRE(fcntl(memory, F_ADD_SEALS, F_SEAL_WRITE) == -1);
+        close(memory);
+
+        // The ring is still usable.
+        REQUIRE(ring.capacity() == 4096);
+    }
+
+    SECTION("Memory that could be shrunk is refused") {
+        // A well-formed ring, but without seals.
+        const int memory = memfd_create("unsealed", MFD_CLOEXEC);
+        REQUIRE(memory >= 0);
+        const size_t size = 4096 + 4096 * 2;
+        REQUIRE(ftruncate(memory, (off_t)size) == 0);
+
+        const uint32_t header[4] = { 0x52494e47, 1, 4096, 0 };
+        REQUIRE(pwrite(memory, header, sizeof(header), 0) == sizeof(header));
+
+        REQUIRE(a.SendDescriptors("R", 1, &memory, 1) == 1);
+        close(memory);
+        REQUIRE_FALSE(RingSocket::Accept(b));
+    }
+}
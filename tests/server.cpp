@@ -0,0 +1,191 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+static constexpr size_t SHARDS = 4;
+
+struct EchoHandler : Handler
+{
+    void OnReadable(Socket& socket) override
+    {
+        char buffer[64];
+        const int received = socket.Receive(buffer, sizeof(buffer));
+        if (received > 0)
+            socket.Send(buffer, received);
+    }
+};
+
+TEST_CASE("Shard connections across SO_REUSEPORT listeners", "[ShardedServer]") {
+    std::deque<Socket> connections[SHARDS];
+    EchoHandler handlers[SHARDS];
+    std::thread::id threads[SHARDS];
+    bool crossed = false;
+
+    ShardedServer server(SHARDS);
+    REQUIRE(server.size() == SHARDS);
+
+    const bool started = server.Start(Address(AddressFamily::INET, "127.0.0.1", 0), [&](Shard& shard, Socket connection, const Address& peer) {
+        const size_t index = shard.index();
+        if (threads[index] == std::thread::id())
+            threads[index] = std::this_thread::get_id();
+
+        crossed |= threads[index] != std::this_thread::get_id() || !peer;
+
+        connections[index].push_back(std::move(connection));
+        shard.reactor().Add(connections[index].back(), handlers[index], Interest::READ);
+    });
+    REQUIRE(started);
+    REQUIRE(((sockaddr_in*)server.address().name())->sin_port != 0);
+
+    const size_t clients = 200;
+    for (size_t i = 0; i < clients; ++i)
+    {
+        Socket client(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        REQUIRE(client.Connect(server.address()));
+        REQUIRE(client.Send("x") == 1);
+
+        char reply = 0;
+        REQUIRE(client.Receive(&reply, 1) == 1);
+        REQUIRE(reply == 'x');
+    }
+
+    REQUIRE(server.accepted() == clients);
+
+    size_t busy = 0;
+    for (size_t i = 0; i < SHARDS; ++i)
+        busy += server.shard(i).accepted() > 0;
+
+    REQUIRE(busy > 1);
+
+    server.Stop();
+    REQUIRE_FALSE(crossed);
+}
+
+TEST_CASE("Shards keep draining past connections reset while queued", "[ShardedServer]") {
+    std::atomic<bool> held(false), release(false);
+    std::mutex lock;
+    std::vector<uint16_t> ports;
+
+    ShardedServer server(1);
+    const bool started = server.Start(Address(AddressFamily::INET, "127.0.0.1", 0), [&](Shard&, Socket, const Address& peer) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            ports.push_back(ntohs(((const sockaddr_in*)peer.name())->sin_port));
+        }
+
+        // Holds the shard inside its first batch, so the connections behind it queue up.
+        if (!held.exchange(true))
+            while (!release.load())
+                std::this_thread::yield();
+    });
+    REQUIRE(started);
+
+    Socket first(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    REQUIRE(first.Connect(server.address()));
+    while (!held.load())
+        std::this_thread::yield();
+
+    // Closing with a reset aborts the connection while it waits in the queue.
+    Socket aborted(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    REQUIRE(aborted.Connect(server.address()));
+    REQUIRE(aborted.SetOption(options::LINGER, linger{ 1, 0 }));
+    aborted.reset();
+
+    std::vector<Socket> behind;
+    std::vector<uint16_t> expected;
+    for (int i = 0; i < 3; ++i)
+    {
+        behind.emplace_back(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        REQUIRE(behind.back().Connect(server.address()));
+        expected.push_back(ntohs(((const sockaddr_in*)behind.back().GetLocalAddress().name())->sin_port));
+    }
+
+    release = true;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (std::all_of(expected.begin(), expected.end(), [&](const uint16_t port) {
+                return std::find(ports.begin(), ports.end(), port) != ports.end();
+            }))
+                break;
+        }
+
+        REQUIRE(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    server.Stop();
+}
+
+TEST_CASE("Shards drop connections when out of descriptors", "[ShardedServer]") {
+    int pipe[2];
+    REQUIRE(::pipe(pipe) == 0);
+
+    const pid_t child = fork();
+    REQUIRE(child >= 0);
+
+    if (child == 0)
+    {
+        close(pipe[0]);
+        ShardedServer server(1);
+        if (!server.Start(Address(AddressFamily::INET, "127.0.0.1", 0), [](Shard&, Socket, const Address&) {}))
+            _exit(1);
+
+        const uint16_t port = ((const sockaddr_in*)server.address().name())->sin_port;
+        write(pipe[1], &port, sizeof(port));
+        close(pipe[1]);
+
+        // Lowers the limit and takes every descriptor left under it, so every accept fails with EMFILE.
+        rlimit limit;
+        getrlimit(RLIMIT_NOFILE, &limit);
+        limit.rlim_cur = 256;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        while (dup(0) >= 0)
+            ;
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (server.shard(0).dropped() < 3 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        _exit(server.shard(0).dropped() == 3 && server.accepted() == 0 ? 0 : 2);
+    }
+
+    close(pipe[1]);
+    uint16_t port = 0;
+    REQUIRE(read(pipe[0], &port, sizeof(port)) == sizeof(port));
+    close(pipe[0]);
+
+    // Each connection queued while the shard is out of descriptors is closed, not left to stall the queue.
+    Address address(AddressFamily::INET, "127.0.0.1", ntohs(port));
+    std::vector<Socket> clients;
+    for (int i = 0; i < 3; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        clients.emplace_back(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+        REQUIRE(clients.back().Connect(address));
+    }
+
+    int status = 0;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+
+    char byte;
+    for (Socket& client : clients)
+        REQUIRE(client.Receive(&byte, 1) <= 0);
+}
@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+static CompactAddress Peer(const uint32_t host, const uint16_t port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(host);
+    address.sin_port = htons(port);
+
+    return CompactAddress((const sockaddr*)&address);
+}
+
+TEST_CASE("Look up, insert and erase per-peer state", "[SessionTable]") {
+    SessionTable<std::string> table;
+    REQUIRE(table.size() == 0);
+    REQUIRE(table.capacity() == 16);
+
+    SECTION("Entries are created once and found again") {
+        auto created = table.Emplace(Peer(1, 80), 0, "first");
+        REQUIRE(created.second);
+        REQUIRE(*created.first == "first");
+
+        auto existing = table.Emplace(Peer(1, 80), 0, "second");
+        REQUIRE_FALSE(existing.second);
+        REQUIRE(*existing.first == "first");
+
+        REQUIRE(table.Find(Peer(1, 81)) == nullptr);
+        REQUIRE(table.Find(Peer(2, 80)) == nullptr);
+        REQUIRE(*table.Find(Peer(1, 80)) == "first");
+        REQUIRE(table.size() == 1);
+
+        REQUIRE(table.Erase(Peer(1, 80)));
+        REQUIRE_FALSE(table.Erase(Peer(1, 80)));
+        REQUIRE(table.Find(Peer(1, 80)) == nullptr);
+        REQUIRE(table.size() == 0);
+    }
+
+    SECTION("The table grows and matches an unordered_map throughout") {
+        std::unordered_map<CompactAddress, std::string> reference;
+
+        for (uint32_t i = 0; i < 20000; ++i)
+        {
+            const CompactAddress peer = Peer(0x0a000000 + i / 7, (uint16_t)(i % 7));
+            table.Emplace(peer, 0, std::to_string(i));
+            reference.emplace(peer, std::to_string(i));
+
+            // Erasing every third entry leaves deleted slots to reuse.
+            if (i % 3 == 0)
+            {
+                const CompactAddress victim = Peer(0x0a000000 + i / 14, (uint16_t)(i / 2 % 7));
+                REQUIRE(table.Erase(victim) == (reference.erase(victim) == 1));
+            }
+        }
+
+        REQUIRE(table.size() == reference.size());
+        REQUIRE(table.size() * 8 <= table.capacity() * 7);
+
+        for (const auto& entry : reference)
+        {
+            const std::string* value = table.Find(entry.first);
+            REQUIRE(value != nullptr);
+            REQUIRE(*value == entry.second);
+        }
+    }
+
+    SECTION("Churn without growth reuses the same slots") {
+        for (uint32_t round = 0; round < 100; ++round)
+        {
+            for (uint32_t i = 0; i < 10; ++i)
+                REQUIRE(table.Emplace(Peer(round, (uint16_t)i), 0, "x").second);
+            for (uint32_t i = 0; i < 10; ++i)
+                REQUIRE(table.Erase(Peer(round, (uint16_t)i)));
+        }
+
+        REQUIRE(table.size() == 0);
+        REQUIRE(table.capacity() == 16);
+    }
+}
+
+TEST_CASE("Expire idle peers a few slots at a time", "[SessionTable][Expire]") {
+    SessionTable<std::unique_ptr<int>> table(1000);
+    const size_t capacity = table.capacity();
+
+    for (uint32_t i = 0; i < 1000; ++i)
+        table.Emplace(Peer(i, 53), 0, new int(i));
+
+    // Half of the peers are seen again later.
+    for (uint32_t i = 0; i < 1000; i += 2)
+        REQUIRE(table.Find(Peer(i, 53), 50) != nullptr);
+
+    size_t expired = 0;
+    std::vector<int> values;
+    for (size_t swept = 0; swept < capacity; swept += 64)
+    {
+        expired += table.Expire(100, 60, 64, [&values](const CompactAddress& peer, std::unique_ptr<int>& value) {
+            REQUIRE(peer.port() == 53);
+            values.push_back(*value);
+        });
+    }
+
+    REQUIRE(expired == 500);
+    REQUIRE(values.size() == 500);
+    REQUIRE(table.size() == 500);
+    REQUIRE(table.Find(Peer(1, 53)) == nullptr);
+    REQUIRE(**table.Find(Peer(2, 53)) == 2);
+
+    for (const int value : values)
+        REQUIRE(value % 2 == 1);
+
+    REQUIRE(table.Expire(200, 60) == 500);
+    REQUIRE(table.size() == 0);
+}
@@ -0,0 +1,506 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#endif
+#include "netstack.hpp"
+
+using namespace netstack;
+
+static bool countAllocations = false;
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (countAllocations)
+        ++allocations;
+
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+// Kept out of line, or GCC sees the free matched against operator new and warns of a mismatch.
+[[gnu::noinline]] void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+// Binds a UDP socket to an ephemeral loopback port and stores the bound address.
+static SOCKET BindUdp(Address& address)
+{
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    address = Address(AddressFamily::INET, "127.0.0.1", 0);
+    socklen_t length = sizeof(sockaddr_in);
+
+    bind(handle, address.name(), length);
+    getsockname(handle, address.name(), &length);
+
+    return handle;
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Receive into a growable string", "[Socket][Receive]") {
+    SOCKET pair[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+
+    Socket writer(pair[0]);
+    Socket reader(pair[1]);
+
+    SECTION("Short read reports the true byte count") {
+        REQUIRE(writer.Send("hello") == 5);
+
+        std::string buffer = "> ";
+        REQUIRE(reader.Receive(buffer) == 5);
+        REQUIRE(buffer == "> hello");
+    }
+
+    SECTION("Large binary payload is received without garbage") {
+        std::string payload(100000, '\0');
+        for (size_t i = 0; i < payload.size(); ++i)
+            payload[i] = (char)(i * 31);
+
+        REQUIRE(writer.Send(payload) == (int)payload.size());
+
+        std::string buffer;
+        while (buffer.size() < payload.size())
+            REQUIRE(reader.Receive(buffer) > 0);
+
+        REQUIRE(buffer == payload);
+    }
+
+    SECTION("End of stream returns 0 and leaves the buffer untouched") {
+        writer.Shutdown(ShutdownFlags::SEND);
+
+        std::string buffer = "kept";
+        REQUIRE(reader.Receive(buffer) == 0);
+        REQUIRE(buffer == "kept");
+    }
+}
+#endif
+
+TEST_CASE("Receive datagrams into caller owned buffers", "[Socket][ReceiveFrom]") {
+    Address receiverAddress, senderAddress;
+    Socket receiver(BindUdp(receiverAddress));
+    Socket sender(BindUdp(senderAddress));
+
+    const char datagram[] = { 'a', '\0', 'b', '\0', '\0', 'c' };
+    REQUIRE(sender.SendTo(datagram, sizeof(datagram), 0, receiverAddress.name(), sizeof(sockaddr_in)) == sizeof(datagram));
+
+    SECTION("Binary datagram and peer address without heap allocations") {
+        char buffer[2048];
+        Address from;
+
+        countAllocations = true;
+        allocations = 0;
+        const int received = receiver.ReceiveFrom(buffer, sizeof(buffer), from);
+        countAllocations = false;
+
+        REQUIRE(allocations == 0);
+        REQUIRE(received == sizeof(datagram));
+        REQUIRE(std::memcmp(buffer, datagram, sizeof(datagram)) == 0);
+        REQUIRE(from);
+        REQUIRE(from.size() == sizeof(sockaddr_in));
+        REQUIRE(((sockaddr_in*)from.name())->sin_port == ((sockaddr_in*)senderAddress.name())->sin_port);
+    }
+
+    SECTION("String buffer keeps embedded NUL bytes") {
+        std::string buffer(2048, '\0');
+        Address from;
+
+        REQUIRE(receiver.ReceiveFrom(buffer, ReceiveFlags::NONE, &from) == sizeof(datagram));
+        REQUIRE(buffer == std::string(datagram, sizeof(datagram)));
+        REQUIRE(from.size() == sizeof(sockaddr_in));
+
+        // The contents are replaced, and sizing the buffer again does not allocate.
+        REQUIRE(sender.SendTo("xy", 2, 0, receiverAddress.name(), sizeof(sockaddr_in)) == 2);
+        countAllocations = true;
+        allocations = 0;
+        buffer.resize(2048);
+        const int received = receiver.ReceiveFrom(buffer, ReceiveFlags::NONE, &from);
+        countAllocations = false;
+
+        REQUIRE(allocations == 0);
+        REQUIRE(received == 2);
+        REQUIRE(buffer == "xy");
+    }
+}
+
+TEST_CASE("Send and receive datagrams in batches", "[Socket][ReceiveBatch][SendBatch]") {
+    Address receiverAddress, senderAddress;
+    Socket receiver(BindUdp(receiverAddress));
+    Socket sender(BindUdp(senderAddress));
+
+    MessageBatch outgoing(8, 64);
+    for (char i = 0; i < 5; ++i)
+    {
+        const char datagram[] = { 'n', i, '\0', i };
+        REQUIRE(outgoing.Push(datagram, sizeof(datagram), receiverAddress));
+    }
+
+    REQUIRE_FALSE(outgoing.Push(std::string(65, 'x').c_str(), 65, receiverAddress));
+    REQUIRE(sender.SendBatch(outgoing) == 5);
+
+    MessageBatch incoming(8, 64);
+    size_t received = 0;
+    while (received < 5)
+    {
+        const int count = receiver.ReceiveBatch(incoming);
+        REQUIRE(count > 0);
+        REQUIRE(incoming.size() == (size_t)count);
+
+        for (size_t i = 0; i < incoming.size(); ++i, ++received)
+        {
+            REQUIRE(incoming.length(i) == 4);
+            REQUIRE_FALSE(incoming.truncated(i));
+            REQUIRE(incoming.data(i)[1] == (char)received);
+            REQUIRE(incoming.data(i)[3] == (char)received);
+            REQUIRE(incoming.address(i).size() == sizeof(sockaddr_in));
+            REQUIRE(((sockaddr_in*)incoming.address(i).name())->sin_port == ((sockaddr_in*)senderAddress.name())->sin_port);
+        }
+    }
+
+    // A datagram larger than its slot is cut to fit and reported as truncated.
+    char large[100];
+    std::memset(large, 'y', sizeof(large));
+    REQUIRE(sender.SendTo(large, sizeof(large), 0, receiverAddress.name(), sizeof(sockaddr_in)) == sizeof(large));
+    REQUIRE(receiver.ReceiveBatch(incoming) == 1);
+    REQUIRE(incoming.length(0) == 64);
+    REQUIRE(incoming.truncated(0));
+}
+
+TEST_CASE("Segment datagrams on send and coalesce them on receive", "[Socket][SendSegmented][ReceiveSegmented]") {
+    Address receiverAddress, senderAddress;
+    Socket receiver(BindUdp(receiverAddress));
+    Socket sender(BindUdp(senderAddress));
+
+    // Ten datagrams of 1000 bytes and a shorter one, each filled with its index.
+    std::string payload;
+    for (char i = 0; i < 11; ++i)
+        payload.append(i < 10 ? 1000 : 300, i);
+
+    std::vector<char> buffer(64 * 1024);
+
+    SECTION("Without receive offload every datagram arrives on its own") {
+        REQUIRE(sender.SendSegmented(payload, 1000, &receiverAddress) == (int)payload.size());
+
+        for (char i = 0; i < 11; ++i)
+        {
+            DatagramSegments segments = {};
+            const int received = receiver.ReceiveSegmented({ buffer.data(), buffer.size() }, segments);
+            REQUIRE(received == (i < 10 ? 1000 : 300));
+            REQUIRE(segments.count() == 1);
+            REQUIRE(segments.length(0) == (size_t)received);
+            REQUIRE(buffer[0] == i);
+        }
+    }
+
+#if defined(__linux__) && defined(UDP_GRO)
+    SECTION("With receive offload the datagrams arrive in one run") {
+        REQUIRE(receiver.SetOption(options::RECEIVE_OFFLOAD, true));
+        REQUIRE(sender.SendSegmented(payload, 1000, &receiverAddress) == (int)payload.size());
+
+        DatagramSegments segments = {};
+        Address from;
+        REQUIRE(receiver.ReceiveSegmented({ buffer.data(), buffer.size() }, segments, ReceiveFlags::NONE, &from) == (int)payload.size());
+        REQUIRE(((sockaddr_in*)from.name())->sin_port == ((sockaddr_in*)senderAddress.name())->sin_port);
+        REQUIRE(segments.segmentSize == 1000);
+        REQUIRE(segments.count() == 11);
+        REQUIRE(segments.length(10) == 300);
+
+        for (size_t i = 0; i < segments.count(); ++i)
+            REQUIRE(std::string(buffer.data() + segments.offset(i), segments.length(i)) == std::string(segments.length(i), (char)i));
+    }
+#endif
+
+    SECTION("A buffer no larger than a segment is a single datagram") {
+        REQUIRE(sender.SendSegmented(payload.substr(0, 500), 1000, &receiverAddress) == 500);
+
+        DatagramSegments segments = {};
+        REQUIRE(receiver.ReceiveSegmented({ buffer.data(), buffer.size() }, segments) == 500);
+        REQUIRE(segments.count() == 1);
+    }
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Scatter and gather with vectored send and receive", "[Socket][SendV][ReceiveV]") {
+    SOCKET pair[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+
+    Socket writer(pair[0]);
+    Socket reader(pair[1]);
+
+    SECTION("Header and payload go out in one call and scatter back") {
+        const std::string header = "LEN5";
+        const std::string payload = "hello";
+
+        REQUIRE(writer.SendV({ header, payload }) == 9);
+
+        char head[4];
+        std::string body(5, '\0');
+        REQUIRE(reader.ReceiveV({ head, body }) == 9);
+        REQUIRE(std::string(head, 4) == header);
+        REQUIRE(body == payload);
+    }
+
+    SECTION("More buffers than a single call accepts are sent in order") {
+        std::vector<std::string> parts;
+        std::string expected;
+        for (int i = 0; i < 150; ++i)
+        {
+            parts.push_back(std::string(i % 7, (char)('a' + i % 26)));
+            expected += parts.back();
+        }
+
+        std::vector<ConstBuffer> buffers(parts.begin(), parts.end());
+        REQUIRE(writer.SendV(buffers) == (int)expected.size());
+
+        std::string received;
+        while (received.size() < expected.size())
+            REQUIRE(reader.Receive(received) > 0);
+
+        REQUIRE(received == expected);
+    }
+
+    SECTION("Partial writes report the bytes that made it out") {
+        fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+
+        const std::string block(1024 * 1024, 'z');
+        const int sent = writer.SendV({ block, block, block });
+        REQUIRE(sent > 0);
+        REQUIRE(sent < (int)block.size() * 3);
+    }
+}
+#endif
+
+TEST_CASE("Bind, listen, connect and accept", "[Socket][Bind][Listen][Accept][Connect]") {
+    Socket listener(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    REQUIRE(listener.Bind(Address(AddressFamily::INET, "127.0.0.1", 0)));
+    REQUIRE(listener.Listen());
+
+    const Address local = listener.GetLocalAddress();
+    REQUIRE(local);
+    REQUIRE(local.size() == sizeof(sockaddr_in));
+    REQUIRE(((sockaddr_in*)local.name())->sin_port != 0);
+
+    Socket client(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    REQUIRE(client.Connect(local));
+
+    Address peer;
+    Socket server(listener.Accept(&peer));
+    REQUIRE(nsIsValidSocket(server.handle()));
+    REQUIRE(peer);
+    REQUIRE(((sockaddr_in*)peer.name())->sin_port == ((sockaddr_in*)client.GetLocalAddress().name())->sin_port);
+}
+
+// Whether a handle still refers to an open socket.
+static bool IsOpen(const SOCKET handle)
+{
+    int type = 0;
+
+    return GetOption(handle, options::TYPE, type);
+}
+
+TEST_CASE("Move ownership of a socket", "[Socket][Move]") {
+    static_assert(!std::is_copy_constructible<Socket>::value, "Sockets own their handle");
+    static_assert(std::is_nothrow_move_constructible<Socket>::value, "Sockets move into containers without copying");
+
+    Socket first(AddressFamily::INET, SocketType::DATAGRAM, SocketProtocol::UDP);
+    const SOCKET handle = first.handle();
+    REQUIRE(first);
+
+    // Moving leaves the source empty, so only the destination closes the handle.
+    Socket second(std::move(first));
+    REQUIRE_FALSE(first);
+    REQUIRE(first.handle() == Socket::INVALID);
+    REQUIRE(second.handle() == handle);
+
+    std::vector<Socket> sockets;
+    sockets.push_back(std::move(second));
+    sockets.emplace_back(AddressFamily::INET, SocketType::DATAGRAM, SocketProtocol::UDP);
+    sockets.emplace_back(AddressFamily::INET, SocketType::DATAGRAM, SocketProtocol::UDP);
+    REQUIRE(sockets[0].handle() == handle);
+    REQUIRE(IsOpen(handle));
+
+    // Assigning closes the handle that was held.
+    const SOCKET replaced = sockets[1].handle();
+    sockets[1] = std::move(sockets[2]);
+    REQUIRE_FALSE(IsOpen(replaced));
+
+    const SOCKET released = sockets[0].release();
+    REQUIRE(released == handle);
+    REQUIRE_FALSE(sockets[0]);
+    sockets.clear();
+    REQUIRE(IsOpen(handle));
+
+    Socket adopted;
+    REQUIRE_FALSE(adopted);
+    adopted.reset(released);
+    REQUIRE(adopted.handle() == handle);
+    adopted.reset();
+    REQUIRE_FALSE(adopted);
+    REQUIRE_FALSE(IsOpen(handle));
+}
+
+// Whether SetOption and GetOption accept a value of the given type for an option.
+template <typename Option, typename Value, typename = void>
+struct CanSetOption : std::false_type {};
+
+template <typename Option, typename Value>
+struct CanSetOption<Option, Value, std::void_t<decltype(std::declval<Socket&>().SetOption(std::declval<Option&>(), std::declval<Value>()))>>
+    : std::true_type {};
+
+template <typename Option, typename Value, typename = void>
+struct CanGetOption : std::false_type {};
+
+template <typename Option, typename Value>
+struct CanGetOption<Option, Value, std::void_t<decltype(std::declval<Socket&>().GetOption(std::declval<Option&>(), std::declval<Value&>()))>>
+    : std::true_type {};
+
+static_assert(CanSetOption<decltype(options::RECEIVE_BUFFER), int>::value, "Options take values of their own type.");
+static_assert(CanSetOption<decltype(options::LINGER), linger>::value, "Options take values of their own type.");
+static_assert(!CanSetOption<decltype(options::RECEIVE_BUFFER), double>::value, "Values must not be narrowed.");
+static_assert(!CanSetOption<decltype(options::RECEIVE_BUFFER), bool>::value, "Booleans must not pass as sizes.");
+static_assert(!CanSetOption<decltype(options::NO_DELAY), int>::value, "Integers must not pass as booleans.");
+static_assert(CanGetOption<decltype(options::PENDING_ERROR), int>::value, "Options are read into their own type.");
+static_assert(!CanGetOption<decltype(options::RECEIVE_BUFFER), long>::value, "Options are read into their own type only.");
+
+TEST_CASE("Set and read typed socket options", "[Socket][SetOption][GetOption]") {
+    Socket socket(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+
+    SECTION("Values round trip through their native representation") {
+        bool noDelay = false;
+        REQUIRE(socket.SetOption(options::NO_DELAY, true));
+        REQUIRE(socket.GetOption(options::NO_DELAY, noDelay));
+        REQUIRE(noDelay);
+
+        std::chrono::milliseconds timeout(0);
+        REQUIRE(socket.SetOption(options::RECEIVE_TIMEOUT, std::chrono::milliseconds(1500)));
+        REQUIRE(socket.GetOption(options::RECEIVE_TIMEOUT, timeout));
+        REQUIRE(timeout == std::chrono::milliseconds(1500));
+
+        linger reset{};
+        REQUIRE(socket.SetOption(options::LINGER, linger{ 1, 0 }));
+        REQUIRE(socket.GetOption(options::LINGER, reset));
+        REQUIRE(reset.l_onoff != 0);
+        REQUIRE(reset.l_linger == 0);
+
+        int type = 0;
+        REQUIRE(socket.GetOption(options::TYPE, type));
+        REQUIRE(type == SOCK_STREAM);
+    }
+
+    SECTION("Profiles apply every option they hold") {
+        REQUIRE(socket.ApplyProfile(profiles::THROUGHPUT));
+
+        int size = 0;
+        bool noDelay = true;
+        REQUIRE(socket.GetOption(options::RECEIVE_BUFFER, size));
+        REQUIRE(socket.GetOption(options::NO_DELAY, noDelay));
+        REQUIRE(size > 64 * 1024);
+        REQUIRE_FALSE(noDelay);
+
+        REQUIRE(socket.ApplyProfile(profiles::LOW_LATENCY));
+        REQUIRE(socket.GetOption(options::NO_DELAY, noDelay));
+        REQUIRE(noDelay);
+    }
+
+    SECTION("Options of invalid handles fail") {
+        int error = 0;
+        REQUIRE_FALSE(SetOption(-1, options::KEEP_ALIVE, true));
+        REQUIRE_FALSE(GetOption(-1, options::PENDING_ERROR, error));
+    }
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Send a file and resume from the offset", "[Socket][SendFile]") {
+    char path[] = "/tmp/netstack-sendfile-XXXXXX";
+    const int file = mkstemp(path);
+    REQUIRE(file >= 0);
+    unlink(path);
+
+    std::string contents(300 * 1024, '\0');
+    for (size_t i = 0; i < contents.size(); ++i)
+        contents[i] = (char)('a' + i % 26);
+    REQUIRE(write(file, contents.data(), contents.size()) == (ssize_t)contents.size());
+
+    SOCKET pair[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    Socket writer(pair[0]);
+    Socket reader(pair[1]);
+
+    // The first transfer starts part way in and stops short, the second resumes from the advanced offset.
+    int64_t offset = 1000;
+    std::string received;
+
+    REQUIRE(writer.SendFile(file, offset, 4000) == 4000);
+    REQUIRE(offset == 5000);
+
+    std::thread drain([&]() {
+        while (received.size() < contents.size() - 1000 && reader.Receive(received) > 0) {}
+    });
+
+    REQUIRE(writer.SendFile(file, offset, contents.size()) == (int64_t)(contents.size() - 5000));
+    REQUIRE(offset == (int64_t)contents.size());
+    REQUIRE(writer.SendFile(file, offset, 100) == 0);
+
+    drain.join();
+    REQUIRE(received == contents.substr(1000));
+
+    close(file);
+}
+#endif
+
+#if defined(__linux__)
+TEST_CASE("Forward between sockets through a pipe", "[Socket][Splice]") {
+    SOCKET inbound[2], outbound[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, inbound) == 0);
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, outbound) == 0);
+
+    Socket source(inbound[0]), proxyIn(inbound[1]);
+    Socket proxyOut(outbound[0]), sink(outbound[1]);
+
+    SplicePipe pipe(64 * 1024);
+    REQUIRE(pipe);
+    REQUIRE(pipe.capacity() >= 64 * 1024);
+
+    const std::string payload(200 * 1024, 'p');
+    int produced = 0;
+    std::thread producer([&]() {
+        produced = source.Send(payload);
+        source.Shutdown(ShutdownFlags::SEND);
+    });
+
+    std::string received;
+    std::thread consumer([&]() {
+        while (received.size() < payload.size() && sink.Receive(received) > 0) {}
+    });
+
+    int64_t forwarded = 0;
+    int64_t status;
+    while ((status = proxyIn.Splice(proxyOut, pipe, 1024 * 1024)) > 0)
+        forwarded += status;
+
+    REQUIRE(status == 0);
+    REQUIRE(pipe.pending() == 0);
+    REQUIRE(forwarded == (int64_t)payload.size());
+
+    producer.join();
+    consumer.join();
+    REQUIRE(produced == (int)payload.size());
+    REQUIRE(received == payload);
+}
+#endif
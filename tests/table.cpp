@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+#include <set>
+#include <utility>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+static Socket Udp()
+{
+    return Socket(AddressFamily::INET, SocketType::DATAGRAM, SocketProtocol::UDP);
+}
+
+TEST_CASE("Hold sockets in a fixed table", "[SocketTable]") {
+    SocketTable table(3);
+    REQUIRE(table.capacity() == 3);
+    REQUIRE(table.size() == 0);
+
+    Socket socket = Udp();
+    const SOCKET handle = socket.handle();
+    const size_t first = table.Insert(std::move(socket));
+    REQUIRE(first == 0);
+    REQUIRE_FALSE(socket);
+    REQUIRE(table[first].handle() == handle);
+    REQUIRE(table.contains(first));
+
+    const size_t second = table.Insert(Udp());
+    const size_t third = table.Insert(Udp());
+    REQUIRE(second == 1);
+    REQUIRE(third == 2);
+    REQUIRE(table.full());
+
+    // A full table leaves the socket with the caller.
+    Socket extra = Udp();
+    REQUIRE(table.Insert(std::move(extra)) == SocketTable::NONE);
+    REQUIRE(extra);
+    REQUIRE(table.Insert(Socket()) == SocketTable::NONE);
+
+    // Sockets are found from their address, as a Handler is given them.
+    REQUIRE(table.index(table[second]) == second);
+    REQUIRE(table.index(extra) == SocketTable::NONE);
+
+    Socket removed = table.Remove(first);
+    REQUIRE(removed.handle() == handle);
+    REQUIRE_FALSE(table.contains(first));
+    REQUIRE(table.size() == 2);
+    REQUIRE_FALSE(table.Remove(first));
+
+    REQUIRE(table.Erase(third));
+    REQUIRE_FALSE(table.Erase(third));
+    REQUIRE_FALSE(table.contains(3));
+
+    // The most recently freed slot is reused first.
+    REQUIRE(table.Insert(std::move(extra)) == third);
+    REQUIRE(table.Insert(std::move(removed)) == first);
+
+    std::set<size_t> visited;
+    table.ForEach([&](const size_t index, Socket& held) {
+        REQUIRE(table.index(held) == index);
+        visited.insert(index);
+    });
+    REQUIRE(visited == std::set<size_t>{ first, second, third });
+
+    table.Clear();
+    REQUIRE(table.size() == 0);
+    REQUIRE_FALSE(table.contains(second));
+}
@@ -0,0 +1,174 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+// Parses with both implementations and checks they agree on validity and on the bytes.
+static void CompareParse(const std::string& text)
+{
+    uint8_t expected4[4], actual4[4];
+    const bool valid4 = inet_pton(AF_INET, text.c_str(), expected4) == 1;
+    INFO("IPv4 \"" << text << "\"");
+    REQUIRE(ParseIPv4(text.data(), text.size(), actual4) == valid4);
+    if (valid4)
+        REQUIRE(std::memcmp(expected4, actual4, 4) == 0);
+
+    uint8_t expected6[16], actual6[16];
+    const bool valid6 = inet_pton(AF_INET6, text.c_str(), expected6) == 1;
+    INFO("IPv6 \"" << text << "\"");
+    REQUIRE(ParseIPv6(text.data(), text.size(), actual6) == valid6);
+    if (valid6)
+        REQUIRE(std::memcmp(expected6, actual6, 16) == 0);
+}
+
+static void CompareFormat(const uint8_t* bytes)
+{
+    char expected[INET6_ADDRSTRLEN];
+    char actual[MAX_IPV6_TEXT + 1];
+
+    REQUIRE(inet_ntop(AF_INET6, bytes, expected, sizeof(expected)) != nullptr);
+    const size_t length = FormatIPv6(bytes, actual);
+    REQUIRE(std::string(actual, length) == expected);
+
+    REQUIRE(inet_ntop(AF_INET, bytes, expected, sizeof(expected)) != nullptr);
+    const size_t length4 = FormatIPv4(bytes, actual);
+    REQUIRE(std::string(actual, length4) == expected);
+}
+
+TEST_CASE("Parse addresses exactly like inet_pton", "[ParseIPv4][ParseIPv6]") {
+    SECTION("Hand picked edge cases") {
+        const char* cases[] = {
+            "0.0.0.0", "255.255.255.255", "1.2.3.4", "01.2.3.4", "1.2.3.04", "256.1.1.1", "1.2.3", "1.2.3.4.5",
+            "1..2.3", ".1.2.3", "1.2.3.", "1.2.3.4 ", " 1.2.3.4", "1.2.3.-4", "1.2.3.4a", "999.1.1.1", "1.2.3.1000",
+            "::", "::1", "1::", "1::2", ":::", "1:::2", ":1::2", "1::2:", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8:9",
+            "1:2:3:4:5:6:7::", "::2:3:4:5:6:7:8", "1:2:3:4:5:6:7::8", "1::2::3", "12345::", "abcd:EF01::",
+            "g::1", "::ffff:1.2.3.4", "::1.2.3.4", "1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:1.2.3.4",
+            "::1.2.3", "::1.2.3.4:5", "::ffff:01.2.3.4", "1.2.3.4::", "fe80::1%1", "[::1]", "", ":", "1", "::0000:1",
+            "0000:0000:0000:0000:0000:ffff:255.255.255.255", "0000:0000:0000:0000:0000:ffff:255.255.255.2555",
+            "1:2:3:4:5::1.2.3.4", "1:2:3:4:5:6::1.2.3.4",
+        };
+
+        for (const char* text : cases)
+            CompareParse(text);
+    }
+
+    SECTION("Random strings over the address alphabet") {
+        std::mt19937 random(7);
+        const char alphabet[] = "0123456789abcdefABCDEF:.:.::0001fx";
+
+        for (int i = 0; i < 200000; ++i)
+        {
+            std::string text(random() % 24, '\0');
+            for (char& c : text)
+                c = alphabet[random() % (sizeof(alphabet) - 1)];
+
+            CompareParse(text);
+        }
+    }
+
+    SECTION("Formatted random addresses parse back") {
+        std::mt19937 random(11);
+        char text[INET6_ADDRSTRLEN];
+
+        for (int i = 0; i < 100000; ++i)
+        {
+            uint8_t bytes[16];
+            for (uint8_t& byte : bytes)
+                byte = random() % 4 == 0 ? (uint8_t)random() : 0;
+
+            inet_ntop(AF_INET6, bytes, text, sizeof(text));
+            CompareParse(text);
+
+            inet_ntop(AF_INET, bytes, text, sizeof(text));
+            CompareParse(text);
+        }
+    }
+}
+
+TEST_CASE("Format addresses exactly like inet_ntop", "[FormatIPv4][FormatIPv6]") {
+    SECTION("Zero runs, embedded IPv4 and corner values") {
+        std::vector<std::vector<uint8_t>> cases = {
+            std::vector<uint8_t>(16, 0),
+            std::vector<uint8_t>(16, 0xff),
+            { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+            { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 1, 2, 3, 4 },
+            { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4 },
+            { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xfe, 1, 2, 3, 4 },
+            { 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0 },
+            { 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1 },
+            { 0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 },
+            { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1 },
+        };
+
+        for (const std::vector<uint8_t>& bytes : cases)
+            CompareFormat(bytes.data());
+    }
+
+    SECTION("Random addresses with frequent zero groups") {
+        std::mt19937 random(13);
+
+        for (int i = 0; i < 200000; ++i)
+        {
+            uint8_t bytes[16];
+            for (size_t group = 0; group < 8; ++group)
+            {
+                const bool zero = random() % 2 == 0;
+                bytes[group * 2] = zero ? 0 : (uint8_t)(random() % 3 == 0 ? random() : 0);
+                bytes[group * 2 + 1] = zero ? 0 : (uint8_t)random();
+            }
+
+            if (i % 16 == 0)
+            {
+                std::memset(bytes, 0, 10);
+                bytes[10] = bytes[11] = 0xff;
+            }
+
+            CompareFormat(bytes);
+        }
+    }
+}
+
+TEST_CASE("Parse and format addresses with ports", "[ParseAddress][FormatAddress]") {
+    CompactAddress address;
+    char text[MAX_ADDRESS_TEXT];
+
+    REQUIRE(ParseAddress("192.0.2.1:8080", 14, address));
+    REQUIRE(address.family() == AF_INET);
+    REQUIRE(address.port() == 8080);
+    REQUIRE(FormatAddress(address, text) == 14);
+    REQUIRE(std::string(text) == "192.0.2.1:8080");
+    REQUIRE(FormatAddress(address, text, false) == 9);
+    REQUIRE(std::string(text) == "192.0.2.1");
+
+    REQUIRE(ParseAddress("192.0.2.1", 9, address));
+    REQUIRE(address.port() == 0);
+
+    REQUIRE(ParseAddress("2001:db8::1", 11, address));
+    REQUIRE(address.family() == AF_INET6);
+    REQUIRE(address.port() == 0);
+
+    const std::string scoped = "[fe80::1%4]:65535";
+    REQUIRE(ParseAddress(scoped.data(), scoped.size(), address));
+    REQUIRE(address.scope() == 4);
+    REQUIRE(address.port() == 65535);
+    REQUIRE(FormatAddress(address, text) == scoped.size());
+    REQUIRE(std::string(text) == scoped);
+
+    const char* invalid[] = { "", "1.2.3.4:", "1.2.3.4:65536", "1.2.3.4:8x", "[::1]:", "[::1", "[::1]x", "::1%", "[::1%x]:1", "1.2.3:80" };
+    for (const char* text : invalid)
+        REQUIRE_FALSE(ParseAddress(text, std::strlen(text), address));
+
+    // The largest text fits the buffer.
+    const std::string longest = "[0000:0000:0000:0000:0000:ffff:255.255.255.255%4294967295]:65535";
+    REQUIRE(ParseAddress(longest.data(), longest.size(), address));
+    REQUIRE(FormatAddress(address, text) < MAX_ADDRESS_TEXT);
+    REQUIRE(longest.size() < MAX_ADDRESS_TEXT);
+
+    // Address itself now parses with the same code.
+    REQUIRE(Address(AddressFamily::INET6, "::ffff:10.0.0.1", 1));
+    REQUIRE_FALSE(Address(AddressFamily::INET, "10.0.0.01", 1));
+}
@@ -0,0 +1,116 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+struct RecordingTimer : Timer
+{
+    TimerWheel* wheel = nullptr;
+    uint64_t expiredAt = 0;
+    int expirations = 0;
+
+    void OnExpire() override
+    {
+        // The wheel moves past a tick before expiring its timers.
+        expiredAt = wheel->now() - 1;
+        ++expirations;
+    }
+};
+
+TEST_CASE("Expire timers at their exact tick", "[TimerWheel]") {
+    TimerWheel wheel(1000);
+    std::mt19937_64 random(42);
+
+    std::vector<RecordingTimer> timers(100000);
+    for (size_t i = 0; i < timers.size(); ++i)
+    {
+        // Spreads the delays over every level of the wheel, including past its range.
+        const uint64_t delay = random() % (1ull << (4 + random() % 40));
+        timers[i].wheel = &wheel;
+        wheel.Schedule(timers[i], 1000 + delay);
+    }
+
+    REQUIRE(wheel.size() == timers.size());
+
+    SECTION("Advancing in steps") {
+        uint64_t now = 1000;
+        size_t expired = 0;
+        while (wheel.size() != 0)
+        {
+            now += random() % (1ull << (random() % 36));
+            expired += wheel.Advance(now);
+        }
+
+        REQUIRE(expired == timers.size());
+        for (const RecordingTimer& timer : timers)
+        {
+            REQUIRE(timer.expirations == 1);
+            REQUIRE(timer.expiredAt == timer.expiry());
+        }
+    }
+
+    SECTION("Cancelling and re-arming") {
+        for (size_t i = 0; i < timers.size(); i += 2)
+            timers[i].Cancel();
+
+        for (size_t i = 1; i < timers.size(); i += 4)
+            wheel.Schedule(timers[i], 1500);
+
+        REQUIRE(wheel.size() == timers.size() / 2);
+
+        wheel.Advance(UINT64_MAX - 1);
+        REQUIRE(wheel.size() == 0);
+
+        for (size_t i = 0; i < timers.size(); ++i)
+        {
+            REQUIRE(timers[i].expirations == (i % 2 == 0 ? 0 : 1));
+            if (i % 4 == 1)
+                REQUIRE(timers[i].expiredAt == 1500);
+        }
+    }
+}
+
+TEST_CASE("Timers can be re-armed from their own expiry", "[TimerWheel]") {
+    TimerWheel wheel;
+    std::vector<uint64_t> expirations;
+
+    struct Periodic : Timer
+    {
+        TimerWheel& wheel;
+        std::vector<uint64_t>& expirations;
+
+        Periodic(TimerWheel& wheel, std::vector<uint64_t>& expirations) : wheel(wheel), expirations(expirations) {}
+
+        void OnExpire() override
+        {
+            expirations.push_back(wheel.now() - 1);
+            if (expirations.size() < 5)
+                wheel.Schedule(*this, wheel.now() - 1 + 100);
+        }
+    } periodic(wheel, expirations);
+
+    wheel.Schedule(periodic, 100);
+
+    REQUIRE(wheel.NextExpiry() <= 100);
+    REQUIRE(wheel.Advance(99) == 0);
+    REQUIRE(wheel.Advance(350) == 3);
+    REQUIRE(wheel.Advance(10000) == 2);
+    REQUIRE(expirations == std::vector<uint64_t>{ 100, 200, 300, 400, 500 });
+    REQUIRE(wheel.NextExpiry() == UINT64_MAX);
+}
+
+TEST_CASE("Destroying an armed timer cancels it", "[TimerWheel]") {
+    TimerWheel wheel;
+    {
+        RecordingTimer timer;
+        timer.wheel = &wheel;
+        wheel.Schedule(timer, 10);
+        REQUIRE(wheel.size() == 1);
+    }
+
+    REQUIRE(wheel.size() == 0);
+    REQUIRE(wheel.Advance(100) == 0);
+}
@@ -0,0 +1,136 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+TEST_CASE("UNIX addresses", "[Address][UNIX]") {
+    const Address file(AddressFamily::UNIX, "/tmp/netstack.sock", 0);
+    REQUIRE(file);
+    REQUIRE(file.path() == "/tmp/netstack.sock");
+    REQUIRE(file.size() == offsetof(sockaddr_un, sun_path) + 19);
+
+    const Address abstract(AddressFamily::UNIX, "@netstack", 0);
+    REQUIRE(abstract);
+    REQUIRE(abstract.path() == "@netstack");
+    REQUIRE(abstract.size() == offsetof(sockaddr_un, sun_path) + 9);
+
+    REQUIRE_FALSE(Address(AddressFamily::UNIX, "", 0));
+    REQUIRE_FALSE(Address(AddressFamily::UNIX, std::string(sizeof(sockaddr_un::sun_path), 'x').c_str(), 0));
+    REQUIRE(Address(AddressFamily::INET, "127.0.0.1", 80).path().empty());
+}
+
+TEST_CASE("UNIX stream sockets", "[Socket][UNIX]") {
+    const std::string path = "/tmp/netstack-test-" + std::to_string(getpid()) + ".sock";
+    unlink(path.c_str());
+
+    Socket listener(AddressFamily::UNIX, SocketType::STREAM, SocketProtocol::DEFAULT);
+    REQUIRE(listener.Bind(Address(AddressFamily::UNIX, path.c_str(), 0)));
+    REQUIRE(listener.Listen());
+    REQUIRE(listener.GetLocalAddress().path() == path);
+
+    struct stat status;
+    REQUIRE(stat(path.c_str(), &status) == 0);
+    REQUIRE(S_ISSOCK(status.st_mode));
+
+    Socket client(AddressFamily::UNIX, SocketType::STREAM, SocketProtocol::DEFAULT);
+    REQUIRE(client.Connect(Address(AddressFamily::UNIX, path.c_str(), 0)));
+
+    Address peer;
+    Socket server(listener.Accept(&peer));
+    REQUIRE(nsIsValidSocket(server.handle()));
+    REQUIRE(peer.name()->sa_family == AF_UNIX);
+
+    REQUIRE(client.Send("hello", 5) == 5);
+    char buffer[16];
+    REQUIRE(server.Receive(buffer, sizeof(buffer)) == 5);
+    REQUIRE(std::string(buffer, 5) == "hello");
+
+    unlink(path.c_str());
+}
+
+TEST_CASE("UNIX datagram sockets in the abstract namespace", "[Socket][UNIX]") {
+    const std::string name = "@netstack-test-" + std::to_string(getpid());
+    const std::string other = name + "-client";
+
+    Socket server(AddressFamily::UNIX, SocketType::DATAGRAM, SocketProtocol::DEFAULT);
+    REQUIRE(server.Bind(Address(AddressFamily::UNIX, name.c_str(), 0)));
+    REQUIRE(server.GetLocalAddress().path() == name);
+
+    Socket client(AddressFamily::UNIX, SocketType::DATAGRAM, SocketProtocol::DEFAULT);
+    REQUIRE(client.Bind(Address(AddressFamily::UNIX, other.c_str(), 0)));
+
+    Address destination(AddressFamily::UNIX, name.c_str(), 0);
+    REQUIRE(client.SendTo("ping", 4, 0, destination.name(), destination.size()) == 4);
+
+    char buffer[16];
+    Address from;
+    REQUIRE(server.ReceiveFrom(buffer, sizeof(buffer), from) == 4);
+    REQUIRE(from.path() == other);
+
+    // The name is taken for as long as the socket is open.
+    Socket duplicate(AddressFamily::UNIX, SocketType::DATAGRAM, SocketProtocol::DEFAULT);
+    REQUIRE_FALSE(duplicate.Bind(Address(AddressFamily::UNIX, name.c_str(), 0)));
+}
+
+TEST_CASE("Socket pairs pass file descriptors", "[Socket][UNIX][Pair]") {
+    Socket a, b;
+
+    SECTION("Stream pairs carry data both ways") {
+        REQUIRE(Socket::Pair(SocketType::STREAM, a, b));
+
+        REQUIRE((fcntl(a.handle(), F_GETFD) & FD_CLOEXEC) != 0);
+        REQUIRE(a.Send("ab", 2) == 2);
+        REQUIRE(b.Send("cd", 2) == 2);
+
+        char buffer[2];
+        REQUIRE(b.Receive(buffer, 2) == 2);
+        REQUIRE(std::string(buffer, 2) == "ab");
+        REQUIRE(a.Receive(buffer, 2) == 2);
+        REQUIRE(std::string(buffer, 2) == "cd");
+    }
+
+    SECTION("SCM_RIGHTS hands over an open pipe") {
+        REQUIRE(Socket::Pair(SocketType::DATAGRAM, a, b));
+
+        int pipe[2];
+        REQUIRE(::pipe(pipe) == 0);
+
+        REQUIRE(a.SendDescriptors("p", 1, pipe, 2) == 1);
+        close(pipe[0]);
+        close(pipe[1]);
+
+        char buffer[4];
+        int received[4];
+        size_t count = 4;
+        REQUIRE(b.ReceiveDescriptors(buffer, sizeof(buffer), received, count) == 1);
+        REQUIRE(buffer[0] == 'p');
+        REQUIRE(count == 2);
+        REQUIRE((fcntl(received[0], F_GETFD) & FD_CLOEXEC) != 0);
+
+        // The received descriptors are the same pipe.
+        REQUIRE(write(received[1], "xyz", 3) == 3);
+        REQUIRE(read(received[0], buffer, sizeof(buffer)) == 3);
+        REQUIRE(std::string(buffer, 3) == "xyz");
+
+        // Descriptors beyond the room given are closed rather than leaked.
+        REQUIRE(a.SendDescriptors("q", 1, received, 2) == 1);
+        count = 1;
+        int kept;
+        REQUIRE(b.ReceiveDescriptors(buffer, sizeof(buffer), &kept, count) == 1);
+        REQUIRE(count == 1);
+
+        close(kept);
+        close(received[0]);
+        close(received[1]);
+
+        // Plain data arrives with no descriptors.
+        REQUIRE(a.Send("r", 1) == 1);
+        count = 4;
+        REQUIRE(b.ReceiveDescriptors(buffer, sizeof(buffer), received, count) == 1);
+        REQUIRE(count == 0);
+    }
+}
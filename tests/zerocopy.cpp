@@ -0,0 +1,67 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+#include <functional>
+#include <vector>
+#include "netstack.hpp"
+
+using namespace netstack;
+
+TEST_CASE("Zero-copy sends complete once the kernel releases them", "[ZeroCopySocket]") {
+    Socket listener(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    REQUIRE(listener.Bind(Address(AddressFamily::INET, "127.0.0.1", 0)));
+    REQUIRE(listener.Listen());
+
+    ZeroCopySocket sender(AddressFamily::INET, SocketType::STREAM, SocketProtocol::TCP);
+    REQUIRE(sender.Connect(listener.GetLocalAddress()));
+    Socket receiver(listener.Accept());
+
+    const std::string large(256 * 1024, 'z');
+    const std::string small(512, 's');
+    const size_t expected = large.size() * 4 + small.size();
+
+    std::string received;
+    std::thread reader([&]() {
+        while (received.size() < expected && receiver.Receive(received) > 0) {}
+    });
+
+    std::vector<int> order;
+    std::vector<bool> copies;
+    auto record = [&](const int index) {
+        return [&order, &copies, index](const bool copied) { order.push_back(index); copies.push_back(copied); };
+    };
+
+    std::vector<CallbackZeroCopyCompletion<std::function<void(bool)>>> completions;
+    completions.reserve(5);
+    for (int i = 0; i < 5; ++i)
+        completions.emplace_back(record(i));
+
+    SECTION("Buffers are released in order, and small ones right away") {
+        for (int i = 0; i < 2; ++i)
+            REQUIRE(sender.SendZeroCopy(large, completions[i]) == (int)large.size());
+
+        REQUIRE(sender.SendZeroCopy(small, completions[2]) == (int)small.size());
+        REQUIRE(order.back() == 2);
+
+        for (int i = 3; i < 5; ++i)
+            REQUIRE(sender.SendZeroCopy(large, completions[i]) == (int)large.size());
+
+        REQUIRE(sender.Flush(5000));
+        REQUIRE(sender.pending() == 0);
+        REQUIRE(order.size() == 5);
+
+        // The small buffer skips the queue, the large ones complete in the order they were sent.
+        std::vector<int> released;
+        for (const int index : order)
+            if (index != 2)
+                released.push_back(index);
+        REQUIRE(released == std::vector<int>{ 0, 1, 3, 4 });
+
+        // Loopback never keeps a reference to user pages, so it reports the data as copied.
+        for (const bool copied : copies)
+            REQUIRE(copied);
+    }
+
+    reader.join();
+    REQUIRE(received.size() == expected);
+}